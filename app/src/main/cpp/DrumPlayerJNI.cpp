@@ -14,6 +14,11 @@
  * limitations under the License.
  */
 
+#include <climits>
+#include <cstdint>
+#include <memory>
+#include <thread>
+
 #include <jni.h>
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -23,14 +28,19 @@
 #include <android/log.h>
 
 // parselib includes
+#include <stream/MappedInputStream.h>
 #include <stream/MemInputStream.h>
 #include <wav/WavStreamReader.h>
 
+#include <player/CompressedSampleBuffer.h>
 #include <player/OneShotSampleSource.h>
 #include <player/SimpleMultiPlayer.h>
 
 #include "minimp3.h"
 #include "minimp3_ex.h"
+#include "ParallelMp3Decoder.h"
+
+static_assert(sizeof(mp3d_sample_t) == sizeof(float), "minimp3 must be built with MINIMP3_FLOAT_OUTPUT");
 
 static const char* TAG = "DrumPlayerJNI";
 
@@ -44,6 +54,16 @@ using namespace parselib;
 
 static SimpleMultiPlayer sDTPlayer;
 
+/**
+ * Creates an (empty) SampleBuffer according to the storage settings of the session.
+ */
+static SampleBuffer* createSampleBuffer() {
+    if (sDTPlayer.getCompressSampleData()) {
+        return new CompressedSampleBuffer();
+    }
+    return new SampleBuffer(sDTPlayer.getSampleFormat());
+}
+
 /**
  * Native (JNI) implementation of DrumPlayer.setupAudioStreamNative()
  */
@@ -89,7 +109,7 @@ JNIEXPORT void JNICALL Java_com_stephanduechtel_multitrackplayer_PlayerViewModel
 
     reader.getNumChannels();
 
-    SampleBuffer* sampleBuffer = new SampleBuffer();
+    SampleBuffer* sampleBuffer = createSampleBuffer();
     sampleBuffer->loadSampleData(&reader);
 
     OneShotSampleSource* source = new OneShotSampleSource(sampleBuffer, pan);
@@ -98,30 +118,123 @@ JNIEXPORT void JNICALL Java_com_stephanduechtel_multitrackplayer_PlayerViewModel
     delete[] buf;
 }
 
+/**
+ * Native (JNI) implementation of PlayerViewModel.loadWavFdNative()
+ * Maps [offset, offset + length) of fd (e.g. from an AssetFileDescriptor of an uncompressed
+ * asset) instead of copying it through the Java heap. Float32 and 16-bit WAVs whose encoding
+ * matches the storage format are played straight from the mapping.
+ */
+JNIEXPORT jboolean JNICALL Java_com_stephanduechtel_multitrackplayer_PlayerViewModel_loadWavFdNative(
+        JNIEnv* env, jobject, jint fd, jlong offset, jlong length, jint index, jfloat pan) {
+    if (length <= 0) {
+        __android_log_print(ANDROID_LOG_ERROR, TAG, "Invalid WAV length: %lld", (long long) length);
+        return JNI_FALSE;
+    }
+
+    std::shared_ptr<MappedInputStream> stream =
+            std::make_shared<MappedInputStream>(fd, offset, length);
+    if (!stream->isValid()) {
+        return JNI_FALSE;
+    }
+
+    WavStreamReader reader(stream.get());
+    reader.parse();
+    if (reader.getNumChannels() <= 0 || reader.getNumSampleFrames() <= 0) {
+        __android_log_print(ANDROID_LOG_ERROR, TAG, "loadWavFdNative(): not a valid WAV");
+        return JNI_FALSE;
+    }
+
+    SampleBuffer* sampleBuffer = createSampleBuffer();
+    sampleBuffer->loadSampleData(&reader, stream);
+
+    OneShotSampleSource* source = new OneShotSampleSource(sampleBuffer, pan);
+    sDTPlayer.addSampleSource(source, sampleBuffer);
+    return JNI_TRUE;
+}
+
+/**
+ * Native (JNI) implementation of PlayerViewModel.loadWavBufferNative()
+ * Parses a direct ByteBuffer in place. The buffer belongs to the caller and may be released
+ * after this returns, so the samples are always copied (converted) out of it.
+ */
+JNIEXPORT jboolean JNICALL Java_com_stephanduechtel_multitrackplayer_PlayerViewModel_loadWavBufferNative(
+        JNIEnv* env, jobject, jobject wavBuffer, jint index, jfloat pan) {
+    unsigned char* buf = static_cast<unsigned char*>(env->GetDirectBufferAddress(wavBuffer));
+    jlong len = env->GetDirectBufferCapacity(wavBuffer);
+    if (buf == nullptr || len <= 0) {
+        __android_log_print(ANDROID_LOG_ERROR, TAG, "loadWavBufferNative() needs a direct ByteBuffer");
+        return JNI_FALSE;
+    }
+
+    MemInputStream stream(buf, len);
+
+    WavStreamReader reader(&stream);
+    reader.parse();
+    if (reader.getNumChannels() <= 0 || reader.getNumSampleFrames() <= 0) {
+        __android_log_print(ANDROID_LOG_ERROR, TAG, "loadWavBufferNative(): not a valid WAV");
+        return JNI_FALSE;
+    }
+
+    SampleBuffer* sampleBuffer = createSampleBuffer();
+    sampleBuffer->loadSampleData(&reader);
+
+    OneShotSampleSource* source = new OneShotSampleSource(sampleBuffer, pan);
+    sDTPlayer.addSampleSource(source, sampleBuffer);
+    return JNI_TRUE;
+}
+
 JNIEXPORT void JNICALL Java_com_stephanduechtel_multitrackplayer_PlayerViewModel_loadMp3AssetNative(
         JNIEnv *env, jobject, jstring filePath, jint index, jfloat pan) {
     const char *nativeFilePath = env->GetStringUTFChars(filePath, nullptr);
 
-    mp3dec_t mp3d;
-    mp3dec_file_info_t info;
-    mp3dec_init(&mp3d);
-
-    if (mp3dec_load(&mp3d, nativeFilePath, &info, NULL, NULL)) {
+    // decode on all cores, the result is the same as mp3dec_load()
+    ParallelMp3Decoder decoder(static_cast<int>(std::thread::hardware_concurrency()));
+    if (decoder.openFile(nativeFilePath) != 0 || decoder.getNumSamples() == 0
+            || decoder.getNumSamples() > INT32_MAX) {
         __android_log_print(ANDROID_LOG_ERROR, "SimpleMultiPlayer", "Failed to load MP3 file");
         env->ReleaseStringUTFChars(filePath, nativeFilePath);
         return;
     }
 
-    SampleBuffer* sampleBuffer = new SampleBuffer();
-    sampleBuffer->loadRawSampleData(info.buffer, info.samples / info.channels, info.channels, info.hz);
+    // float output goes straight into the sample storage
+    SampleBuffer* sampleBuffer = createSampleBuffer();
+    bool loaded = sampleBuffer->loadFloatSampleData(
+            static_cast<int32_t>(decoder.getNumSamples()), decoder.getChannelCount(), decoder.getSampleRate(),
+            [&decoder](float* data) { return static_cast<int32_t>(decoder.decode(data)); });
+    if (!loaded) {
+        __android_log_print(ANDROID_LOG_ERROR, "SimpleMultiPlayer", "Failed to decode MP3 file");
+        delete sampleBuffer;
+        env->ReleaseStringUTFChars(filePath, nativeFilePath);
+        return;
+    }
 
     OneShotSampleSource* source = new OneShotSampleSource(sampleBuffer, pan);
     sDTPlayer.addSampleSource(source, sampleBuffer);
 
-    free(info.buffer);
     env->ReleaseStringUTFChars(filePath, nativeFilePath);
 }
 
+/**
+ * Native (JNI) implementation of PlayerViewModel.setSampleFormatNative()
+ * format is one of the SampleFormat values (0: float32, 1: int16, 2: float16)
+ */
+JNIEXPORT void JNICALL Java_com_stephanduechtel_multitrackplayer_PlayerViewModel_setSampleFormatNative(
+        JNIEnv* env, jobject, jint format) {
+    if (format < static_cast<jint>(SampleFormat::Float32) || format > static_cast<jint>(SampleFormat::Float16)) {
+        __android_log_print(ANDROID_LOG_ERROR, TAG, "Invalid sample format: %d", format);
+        return;
+    }
+    sDTPlayer.setSampleFormat(static_cast<SampleFormat>(format));
+}
+
+/**
+ * Native (JNI) implementation of PlayerViewModel.setCompressSampleDataNative()
+ */
+JNIEXPORT void JNICALL Java_com_stephanduechtel_multitrackplayer_PlayerViewModel_setCompressSampleDataNative(
+        JNIEnv* env, jobject, jboolean compress) {
+    sDTPlayer.setCompressSampleData(compress);
+}
+
 /**
  * Native (JNI) implementation of DrumPlayer.unloadWavAssetsNative()
  */
@@ -204,6 +317,27 @@ JNIEXPORT void JNICALL Java_com_stephanduechtel_multitrackplayer_PlayerViewModel
     sDTPlayer.setCurrentTimeInSeconds(newTime);
 }
 
+// Scrubbing while the seek bar is dragged (see SimpleMultiPlayer::beginScrub())
+JNIEXPORT void JNICALL Java_com_stephanduechtel_multitrackplayer_PlayerViewModel_beginScrubNative(
+        JNIEnv*, jobject, jfloat targetSeconds) {
+    sDTPlayer.beginScrub(targetSeconds);
+}
+
+JNIEXPORT void JNICALL Java_com_stephanduechtel_multitrackplayer_PlayerViewModel_setScrubTargetNative(
+        JNIEnv*, jobject, jfloat targetSeconds) {
+    sDTPlayer.setScrubTarget(targetSeconds);
+}
+
+JNIEXPORT void JNICALL Java_com_stephanduechtel_multitrackplayer_PlayerViewModel_endScrubNative(
+        JNIEnv*, jobject) {
+    sDTPlayer.endScrub();
+}
+
+JNIEXPORT void JNICALL Java_com_stephanduechtel_multitrackplayer_PlayerViewModel_setLoopRegionNative(
+        JNIEnv *env, jobject thiz, jfloat startSeconds, jfloat endSeconds) {
+    sDTPlayer.setLoopRegion(startSeconds, endSeconds);
+}
+
 JNIEXPORT jfloat JNICALL Java_com_stephanduechtel_multitrackplayer_PlayerViewModel_getTotalLengthInSeconds(
         JNIEnv *env, jobject thiz, jint index) {
     return sDTPlayer.getTotalLengthInSeconds(index);
@@ -252,6 +386,69 @@ JNIEXPORT void JNICALL Java_com_stephanduechtel_multitrackplayer_PlayerViewModel
     env->ReleaseIntArrayElements(indexes, elements, 0);
 }
 
+// Detects the tempo of a loaded source, returns [bpm, beat positions in seconds...]
+JNIEXPORT jfloatArray JNICALL Java_com_stephanduechtel_multitrackplayer_PlayerViewModel_detectTempoNative(
+        JNIEnv* env, jobject, jint index) {
+    std::vector<float> result(1, 0.0f);
+    if (index < sDTPlayer.mNumSampleBuffers) {
+        std::vector<float> beats;
+        result[0] = sDTPlayer.detectTempo(index, &beats);
+        result.insert(result.end(), beats.begin(), beats.end());
+    }
+
+    jfloatArray array = env->NewFloatArray(static_cast<jsize>(result.size()));
+    if (array != nullptr) {
+        env->SetFloatArrayRegion(array, 0, static_cast<jsize>(result.size()), result.data());
+    }
+    return array;
+}
+
+// Waveform of a source between two times: [min, max, rms] for each of numBins bins
+JNIEXPORT jfloatArray JNICALL Java_com_stephanduechtel_multitrackplayer_PlayerViewModel_getPeaksNative(
+        JNIEnv* env, jobject, jint index, jfloat startSeconds, jfloat endSeconds, jint numBins) {
+    std::vector<float> peaks;
+    sDTPlayer.getPeaks(index, startSeconds, endSeconds, numBins, &peaks);
+
+    jfloatArray array = env->NewFloatArray(static_cast<jsize>(peaks.size()));
+    if (array != nullptr) {
+        env->SetFloatArrayRegion(array, 0, static_cast<jsize>(peaks.size()), peaks.data());
+    }
+    return array;
+}
+
+// Sets the stretch profile of a source (see StretchProfile.h), -1 = the detected one
+JNIEXPORT void JNICALL Java_com_stephanduechtel_multitrackplayer_PlayerViewModel_setStretchProfileNative(
+        JNIEnv*, jobject, jint index, jint profile) {
+    sDTPlayer.setStretchProfile(index, profile);
+}
+
+JNIEXPORT jint JNICALL Java_com_stephanduechtel_multitrackplayer_PlayerViewModel_getStretchProfileNative(
+        JNIEnv*, jobject, jint index) {
+    return sDTPlayer.getStretchProfile(index);
+}
+
+// Quality step of a source, 0 = full, raised while the device can't keep up (see QualityGovernor.h)
+JNIEXPORT jint JNICALL Java_com_stephanduechtel_multitrackplayer_PlayerViewModel_getQualityLevelNative(
+        JNIEnv*, jobject, jint index) {
+    return sDTPlayer.getQualityLevel(index);
+}
+
+// Mute/solo of a source, silenced sources stop processing (see SimpleMultiPlayer::setMute())
+JNIEXPORT void JNICALL Java_com_stephanduechtel_multitrackplayer_PlayerViewModel_setMuteNative(
+        JNIEnv*, jobject, jint index, jboolean muted) {
+    sDTPlayer.setMute(index, muted);
+}
+
+JNIEXPORT void JNICALL Java_com_stephanduechtel_multitrackplayer_PlayerViewModel_setSoloNative(
+        JNIEnv*, jobject, jint index, jboolean soloed) {
+    sDTPlayer.setSolo(index, soloed);
+}
+
+JNIEXPORT jboolean JNICALL Java_com_stephanduechtel_multitrackplayer_PlayerViewModel_isMutedNative(
+        JNIEnv*, jobject, jint index) {
+    return sDTPlayer.isMuted(index);
+}
+
 
 #ifdef __cplusplus
 }
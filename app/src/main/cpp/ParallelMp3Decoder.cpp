@@ -0,0 +1,308 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <android/log.h>
+
+#include "ParallelMp3Decoder.h"
+
+static const char *TAG = "ParallelMp3Decoder";
+
+// Bytes of main data the bit reservoir can reach back (main_data_begin is 9 bits)
+constexpr int32_t kReservoirBytes = 511;
+
+// Header fields (minimp3 keeps its HDR_* macros in the implementation)
+static int32_t headerFrameSamples(const uint8_t *header) {
+    if ((header[1] & 6) == 6) {
+        return 384;                                 // layer 1
+    }
+    return ((header[1] & 14) == 2) ? 576 : 1152;    // layer 3 MPEG2/2.5 : otherwise
+}
+
+static int32_t headerMainDataBytes(const uint8_t *header, int32_t frameBytes) {
+    bool mono = (header[3] & 0xC0) == 0xC0;
+    bool mpeg1 = (header[1] & 0x08) != 0;
+    bool crc = (header[1] & 1) == 0;
+    int32_t sideInfoBytes = mpeg1 ? (mono ? 17 : 32) : (mono ? 9 : 17);
+    return std::max(frameBytes - 4 - (crc ? 2 : 0) - sideInfoBytes, 0);
+}
+
+ParallelMp3Decoder::ParallelMp3Decoder(int numThreads)
+    : mNumThreads(std::max(numThreads, 1)), mBuffer(nullptr), mBufferSize(0),
+      mMapAddress(nullptr), mMapLength(0), mStartOffset(0), mBitrateSum(0), mUniform(true),
+      mFreeFormat(false), mSkipSamples(0), mNumSamples(0), mNumSegments(0),
+      mSerialSamples(nullptr) {
+    memset(&mInfo, 0, sizeof(mInfo));
+}
+
+ParallelMp3Decoder::~ParallelMp3Decoder() {
+    close();
+}
+
+void ParallelMp3Decoder::close() {
+    free(mSerialSamples);
+    mSerialSamples = nullptr;
+    if (mMapAddress != nullptr) {
+        munmap(mMapAddress, mMapLength);
+        mMapAddress = nullptr;
+        mMapLength = 0;
+    }
+    mBuffer = nullptr;
+    mBufferSize = 0;
+    mFrames.clear();
+    mFrameStart.clear();
+    mNumSamples = 0;
+    mNumSegments = 0;
+    memset(&mInfo, 0, sizeof(mInfo));
+}
+
+int ParallelMp3Decoder::indexFrame(void *userData, const uint8_t *frame, int frameSize,
+                                   int /*freeFormatBytes*/, size_t /*bufSize*/, uint64_t offset,
+                                   mp3dec_frame_info_t *info) {
+    ParallelMp3Decoder *decoder = static_cast<ParallelMp3Decoder *>(userData);
+    if (decoder->mFrames.empty()) {
+        decoder->mInfo.channels = info->channels;
+        decoder->mInfo.hz = info->hz;
+        decoder->mInfo.layer = info->layer;
+    } else if (info->channels != decoder->mInfo.channels || info->hz != decoder->mInfo.hz
+               || info->layer != decoder->mInfo.layer) {
+        decoder->mUniform = false;
+    }
+    if ((frame[2] & 0xF0) == 0) {
+        decoder->mFreeFormat = true;
+    }
+    decoder->mFrames.push_back({decoder->mStartOffset + static_cast<size_t>(offset), frameSize,
+                                headerFrameSamples(frame), headerMainDataBytes(frame, frameSize)});
+    decoder->mBitrateSum += info->bitrate_kbps;
+    return 0;
+}
+
+int ParallelMp3Decoder::open(const uint8_t *buf, size_t bufSize) {
+    if (buf == nullptr) {
+        return MP3D_E_PARAM;
+    }
+    free(mSerialSamples);
+    mSerialSamples = nullptr;
+    mBuffer = buf;
+    mBufferSize = bufSize;
+
+    // Start of the audio frames and the delay/padding of a Xing/Info tag
+    std::unique_ptr<mp3dec_ex_t> probe(new mp3dec_ex_t);
+    int result = mp3dec_ex_open_buf(probe.get(), buf, bufSize, MP3D_SEEK_TO_SAMPLE | MP3D_DO_NOT_SCAN);
+    mStartOffset = probe->start_offset;
+    mSkipSamples = probe->start_delay;
+    uint64_t detectedSamples = probe->detected_samples;
+    bool tagFound = probe->vbr_tag_found != 0;
+    mp3dec_ex_close(probe.get());
+
+    mFrames.clear();
+    mBitrateSum = 0;
+    mUniform = true;
+    mFreeFormat = false;
+    memset(&mInfo, 0, sizeof(mInfo));
+    if (result == 0 && mStartOffset < bufSize) {
+        result = mp3dec_iterate_buf(buf + mStartOffset, bufSize - mStartOffset, indexFrame, this);
+    }
+
+    mFrameStart.assign(mFrames.size() + 1, 0);
+    int channels = std::max(mInfo.channels, 1);
+    for (size_t frame = 0; frame < mFrames.size(); frame++) {
+        mFrameStart[frame + 1] = mFrameStart[frame] + static_cast<uint64_t>(mFrames[frame].numSamples) * channels;
+    }
+    uint64_t totalSamples = mFrameStart.back();
+    mNumSamples = (totalSamples > mSkipSamples) ? totalSamples - mSkipSamples : 0;
+    if (tagFound) {
+        mNumSamples = std::min(static_cast<uint64_t>(mNumSamples), detectedSamples);
+    }
+    mInfo.avg_bitrate_kbps = mFrames.empty() ? 0 : static_cast<int>(mBitrateSum / mFrames.size());
+
+    mNumSegments = std::min(static_cast<size_t>(mNumThreads), mFrames.size() / kMinFramesPerSegment);
+    if (result != 0 || !mUniform || mFreeFormat || mNumSegments < 2 || mNumSamples == 0
+            || (tagFound && detectedSamples == 0)) {
+        return decodeSerially();
+    }
+    return 0;
+}
+
+int ParallelMp3Decoder::openFile(const char *fileName) {
+    close();
+    int fd = ::open(fileName, O_RDONLY);
+    struct stat fileStat;
+    if (fd < 0 || fstat(fd, &fileStat) != 0 || fileStat.st_size <= 0) {
+        if (fd >= 0) {
+            ::close(fd);
+        }
+        return MP3D_E_IOERROR;
+    }
+
+    size_t size = static_cast<size_t>(fileStat.st_size);
+    void *address = mmap(nullptr, size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+    ::close(fd);
+    if (address == MAP_FAILED) {
+        return MP3D_E_IOERROR;
+    }
+    mMapAddress = address;
+    mMapLength = size;
+    return open(static_cast<const uint8_t *>(address), size);
+}
+
+/*
+ * Decodes the whole stream with mp3dec_load_buf() and takes the stream properties from it.
+ */
+int ParallelMp3Decoder::decodeSerially() {
+    mp3dec_t decoder;
+    mp3dec_init(&decoder);
+    mp3dec_file_info_t info;
+    memset(&info, 0, sizeof(info));
+    int result = mp3dec_load_buf(&decoder, mBuffer, mBufferSize, &info, nullptr, nullptr);
+    if (result != 0) {
+        free(info.buffer);
+        mNumSamples = 0;
+        mNumSegments = 0;
+        return result;
+    }
+    free(mSerialSamples);
+    mSerialSamples = info.buffer;
+    mNumSamples = info.samples;
+    mInfo = info;
+    mInfo.buffer = nullptr;
+    mNumSegments = 1;
+    return 0;
+}
+
+/*
+ * First frame to decode so that the state is complete at frame firstFrame,
+ * see mp3dec_ex_seek().
+ */
+size_t ParallelMp3Decoder::getPredecodeFrame(size_t firstFrame) const {
+    size_t frame = firstFrame - std::min(firstFrame, static_cast<size_t>(MINIMP3_PREDECODE_FRAMES));
+    if (mInfo.layer == 3) {
+        int32_t toFill = kReservoirBytes;
+        while (frame > 0 && toFill > 0) {
+            frame--;
+            toFill -= std::min(toFill, mFrames[frame].mainDataBytes);
+        }
+    }
+    return frame;
+}
+
+/*
+ * Decodes the frames [firstFrame, endFrame) of a segment into output. The output is the
+ * untrimmed serial output (see mFrameStart) shifted by mSkipSamples and cut at mNumSamples.
+ */
+void ParallelMp3Decoder::decodeSegment(Segment *segment, mp3d_sample_t *output) const {
+    std::unique_ptr<mp3dec_t> decoder(new mp3dec_t);
+    mp3dec_init(decoder.get());
+    std::unique_ptr<mp3d_sample_t[]> frameSamples(new mp3d_sample_t[MINIMP3_MAX_SAMPLES_PER_FRAME]);
+    const int channels = mInfo.channels;
+    const uint64_t skip = mSkipSamples;
+    const uint64_t numOutput = mNumSamples;
+
+    // The first segment starts where mp3dec_load_buf() starts (skipping junk as it does)
+    size_t position = mStartOffset;
+    size_t predecodeFrame = getPredecodeFrame(segment->firstFrame);
+    if (segment->firstFrame > 0) {
+        position = mFrames[predecodeFrame].offset;
+    }
+    for (size_t frame = predecodeFrame; frame < segment->endFrame; frame++) {
+        const Frame &expected = mFrames[frame];
+        uint64_t start = mFrameStart[frame];
+        uint64_t end = start + static_cast<uint64_t>(expected.numSamples) * channels;
+        bool predecode = frame < segment->firstFrame;
+        // Decode in place if the frame is inside the output with room for the largest
+        // possible frame, so a frame that does not decode as indexed (caught below, the
+        // serial fallback then rewrites everything) can not write past the output.
+        bool direct = !predecode && start >= skip && end - skip <= numOutput
+                && start - skip + MINIMP3_MAX_SAMPLES_PER_FRAME <= numOutput;
+
+        mp3d_sample_t *pcm = direct ? output + (start - skip) : frameSamples.get();
+        mp3dec_frame_info_t info;
+        size_t remaining = std::min(mBufferSize - position, static_cast<size_t>(INT_MAX));
+        int samples = mp3dec_decode_frame(decoder.get(), mBuffer + position, static_cast<int>(remaining),
+                                          pcm, &info);
+        position += info.frame_bytes;
+        if (position != expected.offset + expected.numBytes) {
+            // the decoder did not land on the indexed frame
+            segment->exact = false;
+            return;
+        }
+        if (predecode) {
+            continue;
+        }
+        if (samples != expected.numSamples || info.channels != channels) {
+            segment->exact = false;
+            return;
+        }
+        if (!direct) {
+            // frame straddles the trimmed start or end
+            uint64_t from = std::max(start, skip);
+            uint64_t to = std::min(end, skip + numOutput);
+            if (from < to) {
+                memcpy(output + (from - skip), frameSamples.get() + (from - start),
+                       (to - from) * sizeof(mp3d_sample_t));
+            }
+        }
+    }
+}
+
+int64_t ParallelMp3Decoder::decode(mp3d_sample_t *output) {
+    // nothing opened, or open() failed
+    if (mBuffer == nullptr || output == nullptr || mNumSegments == 0) {
+        return MP3D_E_PARAM;
+    }
+    if (mSerialSamples == nullptr) {
+        std::vector<Segment> segments(mNumSegments);
+        for (size_t segment = 0; segment < mNumSegments; segment++) {
+            segments[segment].firstFrame = mFrames.size() * segment / mNumSegments;
+            segments[segment].endFrame = mFrames.size() * (segment + 1) / mNumSegments;
+            segments[segment].exact = true;
+        }
+
+        std::vector<std::thread> threads;
+        for (size_t segment = 1; segment < mNumSegments; segment++) {
+            threads.emplace_back(&ParallelMp3Decoder::decodeSegment, this, &segments[segment], output);
+        }
+        decodeSegment(&segments[0], output);
+        for (std::thread &thread : threads) {
+            thread.join();
+        }
+
+        bool exact = std::all_of(segments.begin(), segments.end(),
+                                 [](const Segment &segment) { return segment.exact; });
+        if (exact) {
+            return static_cast<int64_t>(mNumSamples);
+        }
+        __android_log_print(ANDROID_LOG_INFO, TAG, "Stream can not be split, decoding serially");
+        size_t numSamples = mNumSamples;
+        int result = decodeSerially();
+        if (result != 0) {
+            return result;
+        }
+        // the caller allocated for the indexed length
+        mNumSamples = std::min(mNumSamples, numSamples);
+    }
+    memcpy(output, mSerialSamples, mNumSamples * sizeof(mp3d_sample_t));
+    return static_cast<int64_t>(mNumSamples);
+}
@@ -0,0 +1,122 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _PARALLEL_MP3_DECODER_H_
+#define _PARALLEL_MP3_DECODER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "minimp3_ex.h"
+
+// Segments shorter than this (~6.7s at 44.1kHz) are not worth a thread
+constexpr int32_t kMinFramesPerSegment = 256;
+
+/**
+ * Decodes a whole MP3 like mp3dec_load_buf(), but on up to numThreads threads and into
+ * memory supplied by the caller.
+ *
+ * open() indexes the frames with mp3dec_iterate_buf() and splits them into contiguous
+ * segments, which tells the exact number of output samples before anything is decoded.
+ * decode() then gives each segment its own decoder which starts MINIMP3_PREDECODE_FRAMES
+ * frames early (further back if needed to fill the 511 byte bit reservoir, the same rule
+ * as mp3dec_ex_seek()) and discards that output, so the reservoir and the MDCT/QMF overlap
+ * state match the serial decode at the segment start. The segments are decoded straight
+ * into their place in the output, with the encoder delay/padding of a Xing/Info tag
+ * trimmed as mp3dec_load_buf() does. The result is bit-exact with mp3dec_load_buf().
+ *
+ * Streams the segmented decode can not reproduce exactly (frames which do not decode to
+ * a full frame of samples, e.g. a cut stream whose first frames lack their reservoir,
+ * format changes mid-stream, free format streams) are decoded serially instead.
+ *
+ * The sample type is that of the minimp3 build (float with MINIMP3_FLOAT_OUTPUT).
+ */
+class ParallelMp3Decoder {
+public:
+    explicit ParallelMp3Decoder(int numThreads);
+    ~ParallelMp3Decoder();
+
+    /**
+     * Indexes the MP3 in buf, which must stay valid until decode() has returned.
+     * Returns 0 or one of the MP3D_E_* error codes.
+     */
+    int open(const uint8_t *buf, size_t bufSize);
+
+    /**
+     * open() on a memory mapping of fileName, which is held until the decoder is deleted.
+     */
+    int openFile(const char *fileName);
+
+    // Properties of the opened stream, getNumSamples() includes the channels
+    size_t getNumSamples() const { return mNumSamples; }
+    int getChannelCount() const { return mInfo.channels; }
+    int getSampleRate() const { return mInfo.hz; }
+    int getLayer() const { return mInfo.layer; }
+    int getAverageBitrateKbps() const { return mInfo.avg_bitrate_kbps; }
+
+    /**
+     * Decodes the opened stream into output, which must hold getNumSamples() samples.
+     * Returns the number of samples written or one of the MP3D_E_* error codes. That is
+     * getNumSamples() unless a stream that turned out not to be splittable was decoded
+     * serially to fewer samples.
+     */
+    int64_t decode(mp3d_sample_t *output);
+
+private:
+    struct Frame {
+        size_t offset;          // of the header, in the whole buffer
+        int32_t numBytes;
+        int32_t numSamples;     // per channel
+        int32_t mainDataBytes;  // layer 3 only
+    };
+
+    struct Segment {
+        size_t firstFrame;
+        size_t endFrame;
+        bool exact;
+    };
+
+    static int indexFrame(void *userData, const uint8_t *frame, int frameSize, int freeFormatBytes,
+                          size_t bufSize, uint64_t offset, mp3dec_frame_info_t *info);
+    size_t getPredecodeFrame(size_t firstFrame) const;
+    void decodeSegment(Segment *segment, mp3d_sample_t *output) const;
+    int decodeSerially();
+    void close();
+
+    int mNumThreads;
+
+    const uint8_t *mBuffer;
+    size_t mBufferSize;
+    void *mMapAddress;
+    size_t mMapLength;
+
+    // Frame index, built by open()
+    size_t mStartOffset;
+    std::vector<Frame> mFrames;
+    std::vector<uint64_t> mFrameStart;  // untrimmed output position of each frame
+    uint64_t mBitrateSum;
+    bool mUniform;                      // all frames have the channels/rate/layer of the first one
+    bool mFreeFormat;                   // not reliably indexed, mp3dec_iterate_buf() may miss frames
+
+    uint64_t mSkipSamples;              // encoder delay
+    size_t mNumSamples;
+    size_t mNumSegments;
+    mp3dec_file_info_t mInfo;
+
+    // Output of the serial fallback when open() found the stream can not be split
+    mp3d_sample_t *mSerialSamples;
+};
+
+#endif // _PARALLEL_MP3_DECODER_H_
@@ -2,6 +2,7 @@ package com.stephanduechtel.multitrackplayer
 
 import android.app.Application
 import android.content.Context
+import android.content.res.AssetFileDescriptor
 import android.content.res.AssetManager
 import android.media.AudioManager
 import android.media.audiofx.BassBoost
@@ -24,6 +25,7 @@ import kotlinx.coroutines.launch
 import java.io.IOException
 import kotlinx.coroutines.withContext
 import java.io.File
+import java.nio.ByteBuffer
 import okhttp3.OkHttpClient
 import okhttp3.Request
 import kotlinx.coroutines.async
@@ -47,6 +49,15 @@ class PlayerViewModel(application: Application): AndroidViewModel(application) {
 
     val GAIN_FACTOR = 100.0f
 
+    // Must match iolib::SampleFormat
+    val SAMPLE_FORMAT_FLOAT32 = 0
+    val SAMPLE_FORMAT_INT16 = 1
+    val SAMPLE_FORMAT_FLOAT16 = 2
+
+    // MP3 stems decode to float and are kept as float32 in RAM. Setting this before the stems
+    // load stores them as int16 instead: half the memory, but the detail below 16 bits is lost.
+    var saveSampleMemory = false
+
     private var job: Job? = null
 
     var currentTimeInSeconds by mutableStateOf(0f)
@@ -87,6 +98,7 @@ class PlayerViewModel(application: Application): AndroidViewModel(application) {
 
     fun initAudioPlayers() {
         setupAudioStreamNative(2)
+        setSampleFormatNative(if (saveSampleMemory) SAMPLE_FORMAT_INT16 else SAMPLE_FORMAT_FLOAT32)
         loadMp3Assets()
 
     }
@@ -228,9 +240,11 @@ class PlayerViewModel(application: Application): AndroidViewModel(application) {
             is LoopState.Pending -> {
                 loopState = LoopState.Active
                 loopOut = getCurrentTimeInSeconds(0)
+                setLoopRegionNative(loopIn, loopOut)
             }
             is LoopState.Active -> {
                 loopState = LoopState.Inactive
+                setLoopRegionNative(-1f, -1f)
             }
         }
         // Print statements for debugging
@@ -241,17 +255,23 @@ class PlayerViewModel(application: Application): AndroidViewModel(application) {
 
     fun seekTo(newTime: Float) {
         seekToTime = newTime
+        if (isDragging) {
+            setScrubTargetNative(newTime)
+        }
     }
 
     fun onSeekStart() {
         println("onSeekStart")
         isDragging = true
+        beginScrubNative(seekToTime)
     }
 
     fun onSeekEnd() {
         println("onSeekEnd $seekToTime")
         isDragging = false
+        // seek first, so playback resumes at the new position as the scrub audio fades out
         setPlaybackTimeInSeconds(seekToTime)
+        endScrubNative()
     }
 
 
@@ -378,12 +398,27 @@ class PlayerViewModel(application: Application): AndroidViewModel(application) {
         }
     }
 
+    /**
+     * Loads a WAV asset without copying it through the Java heap. The asset must be stored
+     * uncompressed in the APK (openFd() fails otherwise).
+     */
+    fun loadWavAsset(assetName: String, index: Int, pan: Float): Boolean {
+        val afd: AssetFileDescriptor = getApplication<Application>().assets.openFd(assetName)
+        return afd.use {
+            loadWavFdNative(it.parcelFileDescriptor.fd, it.startOffset, it.length, index, pan)
+        }
+    }
+
     private external fun setupAudioStreamNative(numChannels: Int)
     private external fun startAudioStreamNative()
     private external fun teardownAudioStreamNative()
 
     private external fun loadWavAssetNative(wavBytes: ByteArray, index: Int, pan: Float)
+    private external fun loadWavFdNative(fd: Int, offset: Long, length: Long, index: Int, pan: Float): Boolean
+    external fun loadWavBufferNative(wavBuffer: ByteBuffer, index: Int, pan: Float): Boolean
     private external fun unloadWavAssetsNative()
+    private external fun setSampleFormatNative(format: Int)
+    external fun setCompressSampleDataNative(compress: Boolean)
 
     external fun trigger(drumIndex: Int)
     external fun stopTrigger(drumIndex: Int)
@@ -398,6 +433,13 @@ class PlayerViewModel(application: Application): AndroidViewModel(application) {
     external fun getCurrentTimeInSeconds(index: Int): Float
 
     external fun setPlaybackTimeInSeconds(newTime: Float)
+    external fun setLoopRegionNative(startSeconds: Float, endSeconds: Float)
+
+    // Audible scrubbing: between begin and end the engine plays short grains around the target
+    // instead of the normal playback. The target only stores a position, set it on every drag update.
+    external fun beginScrubNative(targetSeconds: Float)
+    external fun setScrubTargetNative(targetSeconds: Float)
+    external fun endScrubNative()
 
     external fun getTotalLengthInSeconds(index: Int): Float
 
@@ -414,6 +456,29 @@ class PlayerViewModel(application: Application): AndroidViewModel(application) {
     external fun loadMp3AssetNative(filePath: String, index: Int, pan: Float)
     external fun setIgnorePitchIndexesNative(indexes: IntArray)
 
+    // Tempo of the whole source on all cores: [bpm, beat positions in seconds...], bpm 0 if none found.
+    // Takes a few hundred milliseconds for a song, call it off the main thread.
+    external fun detectTempoNative(index: Int): FloatArray
+
+    // Waveform between two times at any zoom: [min, max, rms] per bin, from a summary built at
+    // load time. Cheap enough to call on every frame while scrolling or zooming.
+    external fun getPeaksNative(index: Int, startSeconds: Float, endSeconds: Float, numBins: Int): FloatArray
+
+    // Time-stretch settings of a source: 0 default, 1 percussive, 2 tonal, 3 voice.
+    // Chosen from the audio when the source is loaded, -1 goes back to that choice.
+    external fun setStretchProfileNative(index: Int, profile: Int)
+    external fun getStretchProfileNative(index: Int): Int
+
+    // Time-stretch quality of a source: 0 full, up to 4 while the device can't keep up with
+    // the stretching (quick seek, short seek window, linear interpolation, no anti-alias filter).
+    external fun getQualityLevelNative(index: Int): Int
+
+    // Mute/solo instead of a zero gain: silenced sources cost no CPU and come back in sync.
+    // isMutedNative is also true for sources silenced by another source's solo.
+    external fun setMuteNative(index: Int, muted: Boolean)
+    external fun setSoloNative(index: Int, soloed: Boolean)
+    external fun isMutedNative(index: Int): Boolean
+
 }
 
 sealed class LoopState {
@@ -0,0 +1,604 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+#include "CompressedSampleBuffer.h"
+
+#include <android/log.h>
+#define LOG_TAG "CompressedSampleBuffer"
+#define LOGD(...) __android_log_print(ANDROID_LOG_DEBUG, LOG_TAG, __VA_ARGS__)
+
+namespace iolib {
+
+/*
+ * Block bitstream (MSB first):
+ *   2 bits  stereo mode (StereoMode), always Independent for non-stereo data
+ *   per channel:
+ *     3 bits  predictor order (0..kMaxPredictorOrder)
+ *     order * kWarmupBits  zigzag coded warm-up samples
+ *     per partition of kPartitionFrames frames:
+ *       5 bits  Rice parameter k
+ *       residuals: unary quotient + k bits, or kEscapeQuotient zeros + kEscapeBits raw
+ * Every block starts on a byte boundary.
+ */
+namespace {
+
+constexpr int32_t kPartitionFrames = 256;
+constexpr int32_t kMaxPredictorOrder = 4;
+constexpr int32_t kOrderBits = 3;
+constexpr int32_t kRiceParamBits = 5;
+constexpr uint32_t kMaxRiceParam = 24;
+constexpr int32_t kWarmupBits = 18;
+constexpr uint32_t kEscapeQuotient = 16;
+constexpr int32_t kEscapeBits = 24;
+// BitReader may fetch up to 8 bytes past the end of the last block
+constexpr int32_t kReadPadding = 8;
+
+enum StereoMode : uint32_t {
+    Independent = 0,
+    LeftSide = 1,
+    SideRight = 2,
+    MidSide = 3
+};
+
+inline uint32_t zigzagEncode(int32_t value) {
+    return (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31);
+}
+
+inline int32_t zigzagDecode(uint32_t value) {
+    return static_cast<int32_t>(value >> 1) ^ -static_cast<int32_t>(value & 1);
+}
+
+class BitWriter {
+public:
+    explicit BitWriter(std::vector<uint8_t>& out) : mOut(out), mAccumulator(0), mNumBits(0) {}
+
+    // numBits <= 32
+    void write(uint32_t value, int32_t numBits) {
+        if (numBits == 0) {
+            return;
+        }
+        mAccumulator = (mAccumulator << numBits) | (value & (0xFFFFFFFFu >> (32 - numBits)));
+        mNumBits += numBits;
+        while (mNumBits >= 8) {
+            mNumBits -= 8;
+            mOut.push_back(static_cast<uint8_t>(mAccumulator >> mNumBits));
+        }
+    }
+
+    void writeRice(uint32_t value, uint32_t k) {
+        uint32_t quotient = value >> k;
+        if (quotient < kEscapeQuotient) {
+            write(1, quotient + 1);
+            write(value, k);
+        } else {
+            write(0, kEscapeQuotient);
+            write(value, kEscapeBits);
+        }
+    }
+
+    void flush() {
+        if (mNumBits > 0) {
+            mOut.push_back(static_cast<uint8_t>(mAccumulator << (8 - mNumBits)));
+            mNumBits = 0;
+        }
+    }
+
+private:
+    std::vector<uint8_t>& mOut;
+    uint64_t mAccumulator;
+    int32_t  mNumBits;
+};
+
+class BitReader {
+public:
+    explicit BitReader(const uint8_t* data) : mData(data), mCache(0), mNumBits(0) {}
+
+    // numBits <= 32
+    uint32_t read(int32_t numBits) {
+        if (numBits == 0) {
+            return 0;
+        }
+        refill();
+        uint32_t value = static_cast<uint32_t>(mCache >> (64 - numBits));
+        mCache <<= numBits;
+        mNumBits -= numBits;
+        return value;
+    }
+
+    uint32_t readRice(uint32_t k) {
+        refill();
+        if ((mCache >> (64 - kEscapeQuotient)) == 0) {
+            mCache <<= kEscapeQuotient;
+            mNumBits -= kEscapeQuotient;
+            return read(kEscapeBits);
+        }
+        uint32_t quotient = static_cast<uint32_t>(__builtin_clzll(mCache));
+        mCache <<= quotient + 1;
+        mNumBits -= quotient + 1;
+        return (quotient << k) | read(k);
+    }
+
+private:
+    void refill() {
+        while (mNumBits <= 56) {
+            mCache |= static_cast<uint64_t>(*mData++) << (56 - mNumBits);
+            mNumBits += 8;
+        }
+    }
+
+    const uint8_t* mData;
+    uint64_t mCache;
+    int32_t  mNumBits;
+};
+
+inline int32_t predictResidual(const int32_t* x, int32_t n, int32_t order) {
+    switch (order) {
+        case 0: return x[n];
+        case 1: return x[n] - x[n - 1];
+        case 2: return x[n] - 2 * x[n - 1] + x[n - 2];
+        case 3: return x[n] - 3 * x[n - 1] + 3 * x[n - 2] - x[n - 3];
+        default: return x[n] - 4 * x[n - 1] + 6 * x[n - 2] - 4 * x[n - 3] + x[n - 4];
+    }
+}
+
+// Sum of absolute residuals of the fixed predictors, used to pick the order
+void estimateCosts(const int32_t* x, int32_t numFrames, uint64_t* costs) {
+    for (int32_t order = 0; order <= kMaxPredictorOrder; order++) {
+        costs[order] = 0;
+    }
+    for (int32_t n = kMaxPredictorOrder; n < numFrames; n++) {
+        int32_t e0 = x[n];
+        int32_t e1 = e0 - x[n - 1];
+        int32_t e2 = e1 - (x[n - 1] - x[n - 2]);
+        int32_t e3 = e2 - (x[n - 1] - 2 * x[n - 2] + x[n - 3]);
+        int32_t e4 = e3 - (x[n - 1] - 3 * x[n - 2] + 3 * x[n - 3] - x[n - 4]);
+        costs[0] += std::abs(e0);
+        costs[1] += std::abs(e1);
+        costs[2] += std::abs(e2);
+        costs[3] += std::abs(e3);
+        costs[4] += std::abs(e4);
+    }
+}
+
+int32_t chooseOrder(const uint64_t* costs, int32_t numFrames) {
+    if (numFrames <= kMaxPredictorOrder) {
+        return 0;
+    }
+    int32_t bestOrder = 0;
+    for (int32_t order = 1; order <= kMaxPredictorOrder; order++) {
+        if (costs[order] < costs[bestOrder]) {
+            bestOrder = order;
+        }
+    }
+    return bestOrder;
+}
+
+void encodeChannel(BitWriter& writer, const int32_t* x, int32_t numFrames, int32_t order,
+                   uint32_t* residuals) {
+    writer.write(order, kOrderBits);
+    for (int32_t n = 0; n < order; n++) {
+        writer.write(zigzagEncode(x[n]), kWarmupBits);
+    }
+
+    for (int32_t n = order; n < numFrames; n++) {
+        residuals[n] = zigzagEncode(predictResidual(x, n, order));
+    }
+
+    for (int32_t start = 0; start < numFrames; start += kPartitionFrames) {
+        int32_t first = std::max(start, order);
+        int32_t end = std::min(start + kPartitionFrames, numFrames);
+        uint64_t sum = 0;
+        for (int32_t n = first; n < end; n++) {
+            sum += residuals[n];
+        }
+        uint64_t count = std::max(end - first, 1);
+        uint32_t k = 0;
+        while (k < kMaxRiceParam && (count << (k + 1)) < sum) {
+            k++;
+        }
+        writer.write(k, kRiceParamBits);
+        for (int32_t n = first; n < end; n++) {
+            writer.writeRice(residuals[n], k);
+        }
+    }
+}
+
+void decodeChannel(BitReader& reader, int32_t* x, int32_t numFrames) {
+    int32_t order = static_cast<int32_t>(reader.read(kOrderBits));
+    for (int32_t n = 0; n < order; n++) {
+        x[n] = zigzagDecode(reader.read(kWarmupBits));
+    }
+
+    for (int32_t start = 0; start < numFrames; start += kPartitionFrames) {
+        int32_t first = std::max(start, order);
+        int32_t end = std::min(start + kPartitionFrames, numFrames);
+        uint32_t k = reader.read(kRiceParamBits);
+        switch (order) {
+            case 0:
+                for (int32_t n = first; n < end; n++) {
+                    x[n] = zigzagDecode(reader.readRice(k));
+                }
+                break;
+            case 1:
+                for (int32_t n = first; n < end; n++) {
+                    x[n] = zigzagDecode(reader.readRice(k)) + x[n - 1];
+                }
+                break;
+            case 2:
+                for (int32_t n = first; n < end; n++) {
+                    x[n] = zigzagDecode(reader.readRice(k)) + 2 * x[n - 1] - x[n - 2];
+                }
+                break;
+            case 3:
+                for (int32_t n = first; n < end; n++) {
+                    x[n] = zigzagDecode(reader.readRice(k)) + 3 * x[n - 1] - 3 * x[n - 2] + x[n - 3];
+                }
+                break;
+            default:
+                for (int32_t n = first; n < end; n++) {
+                    x[n] = zigzagDecode(reader.readRice(k))
+                            + 4 * x[n - 1] - 6 * x[n - 2] + 4 * x[n - 3] - x[n - 4];
+                }
+                break;
+        }
+    }
+}
+
+} // namespace
+
+CompressedSampleBuffer::CompressedSampleBuffer()
+    : SampleBuffer(SampleFormat::Int16), mNumBlocks(0), mBlockSamples(0),
+      mPlayheadSample(0), mCacheMisses(0), mWakeBlock(-1), mDecodeRunning(false) {
+    sem_init(&mDecodeSemaphore, 0, 0);
+}
+
+CompressedSampleBuffer::~CompressedSampleBuffer() {
+    stopDecodeThread();
+    sem_destroy(&mDecodeSemaphore);
+}
+
+void CompressedSampleBuffer::resampleData(int sampleRate) {
+    stopDecodeThread();
+    SampleBuffer::resampleData(sampleRate);
+    compress();
+    startDecodeThread();
+}
+
+size_t CompressedSampleBuffer::getStorageSizeInBytes() const {
+    if (mPackedData != nullptr) {
+        // not compressed yet
+        return SampleBuffer::getStorageSizeInBytes();
+    }
+    return mCompressedData.size() + mBlockOffsets.size() * sizeof(uint32_t)
+            + kCacheSlots * mBlockSamples * sizeof(float);
+}
+
+int32_t CompressedSampleBuffer::getBlockFrames(int32_t blockIndex) const {
+    int32_t numFrames = mNumSamples / mAudioProperties.channelCount;
+    return std::min(kBlockFrames, numFrames - blockIndex * kBlockFrames);
+}
+
+void CompressedSampleBuffer::compress() {
+    if (mPackedData == nullptr) {
+        return;
+    }
+
+    int32_t channelCount = mAudioProperties.channelCount;
+    int32_t numFrames = mNumSamples / channelCount;
+    mBlockSamples = kBlockFrames * channelCount;
+    mNumBlocks = (numFrames + kBlockFrames - 1) / kBlockFrames;
+
+    mCompressedData.clear();
+    mCompressedData.reserve(mNumSamples);   // ~50% of the int16 size
+    mBlockOffsets.resize(mNumBlocks + 1);
+
+    std::vector<int32_t> planes(kBlockFrames * std::max(channelCount, 4));
+    std::vector<uint32_t> residuals(kBlockFrames);
+
+    BitWriter writer(mCompressedData);
+    for (int32_t blockIndex = 0; blockIndex < mNumBlocks; blockIndex++) {
+        mBlockOffsets[blockIndex] = static_cast<uint32_t>(mCompressedData.size());
+        int32_t blockFrames = getBlockFrames(blockIndex);
+        const int16_t* src = mPackedData + static_cast<size_t>(blockIndex) * mBlockSamples;
+
+        // de-interleave
+        for (int32_t channel = 0; channel < channelCount; channel++) {
+            int32_t* plane = &planes[channel * kBlockFrames];
+            for (int32_t frame = 0; frame < blockFrames; frame++) {
+                plane[frame] = src[frame * channelCount + channel];
+            }
+        }
+
+        if (channelCount == 2) {
+            // pick the cheapest of left/right, left/side, side/right and mid/side
+            int32_t* left = &planes[0];
+            int32_t* right = &planes[kBlockFrames];
+            int32_t* mid = &planes[2 * kBlockFrames];
+            int32_t* side = &planes[3 * kBlockFrames];
+            for (int32_t frame = 0; frame < blockFrames; frame++) {
+                mid[frame] = (left[frame] + right[frame]) >> 1;
+                side[frame] = left[frame] - right[frame];
+            }
+
+            uint64_t costs[4][kMaxPredictorOrder + 1];
+            uint64_t best[4];
+            int32_t orders[4];
+            for (int32_t plane = 0; plane < 4; plane++) {
+                estimateCosts(&planes[plane * kBlockFrames], blockFrames, costs[plane]);
+                orders[plane] = chooseOrder(costs[plane], blockFrames);
+                best[plane] = costs[plane][orders[plane]];
+            }
+
+            // plane indexes: 0 left, 1 right, 2 mid, 3 side
+            static constexpr int32_t kModePlanes[4][2] = { {0, 1}, {0, 3}, {3, 1}, {2, 3} };
+            uint32_t mode = Independent;
+            uint64_t bestCost = best[0] + best[1];
+            for (uint32_t candidate = LeftSide; candidate <= MidSide; candidate++) {
+                uint64_t cost = best[kModePlanes[candidate][0]] + best[kModePlanes[candidate][1]];
+                if (cost < bestCost) {
+                    bestCost = cost;
+                    mode = candidate;
+                }
+            }
+
+            writer.write(mode, 2);
+            for (int32_t i = 0; i < 2; i++) {
+                int32_t plane = kModePlanes[mode][i];
+                encodeChannel(writer, &planes[plane * kBlockFrames], blockFrames, orders[plane],
+                              residuals.data());
+            }
+        } else {
+            writer.write(Independent, 2);
+            for (int32_t channel = 0; channel < channelCount; channel++) {
+                const int32_t* plane = &planes[channel * kBlockFrames];
+                uint64_t costs[kMaxPredictorOrder + 1];
+                estimateCosts(plane, blockFrames, costs);
+                encodeChannel(writer, plane, blockFrames, chooseOrder(costs, blockFrames),
+                              residuals.data());
+            }
+        }
+        writer.flush();
+    }
+    mBlockOffsets[mNumBlocks] = static_cast<uint32_t>(mCompressedData.size());
+    mCompressedData.resize(mCompressedData.size() + kReadPadding, 0);
+    mCompressedData.shrink_to_fit();
+
+    LOGD("compressed %d samples: %zu -> %zu bytes (%.1f%%)", mNumSamples,
+         mNumSamples * sizeof(int16_t), mCompressedData.size(),
+         100.0 * mCompressedData.size() / (mNumSamples * sizeof(int16_t)));
+
+    // the uncompressed copy is no longer needed
+    releaseSampleStorage();
+
+    size_t planeSamples = static_cast<size_t>(kBlockFrames) * std::max(channelCount, 2);
+    mDecoderPlanes.reset(new int32_t[planeSamples]);
+    mReaderPlanes.reset(new int32_t[planeSamples]);
+    mReaderBlock.reset(new float[mBlockSamples]);
+    for (CacheSlot& slot : mCache) {
+        slot.blockIndex.store(-1);
+        slot.samples.reset(new float[mBlockSamples]);
+    }
+}
+
+void CompressedSampleBuffer::decodeBlock(int32_t blockIndex, int32_t* planes, float* out) const {
+    int32_t channelCount = mAudioProperties.channelCount;
+    int32_t blockFrames = getBlockFrames(blockIndex);
+    BitReader reader(mCompressedData.data() + mBlockOffsets[blockIndex]);
+
+    uint32_t mode = reader.read(2);
+    for (int32_t channel = 0; channel < channelCount; channel++) {
+        decodeChannel(reader, &planes[channel * kBlockFrames], blockFrames);
+    }
+
+    if (mode != Independent) {
+        int32_t* first = &planes[0];
+        int32_t* second = &planes[kBlockFrames];
+        for (int32_t frame = 0; frame < blockFrames; frame++) {
+            int32_t left;
+            int32_t right;
+            if (mode == LeftSide) {
+                left = first[frame];
+                right = left - second[frame];
+            } else if (mode == SideRight) {
+                right = second[frame];
+                left = first[frame] + right;
+            } else {
+                int32_t side = second[frame];
+                int32_t mid = (first[frame] << 1) | (side & 1);
+                left = (mid + side) >> 1;
+                right = (mid - side) >> 1;
+            }
+            first[frame] = left;
+            second[frame] = right;
+        }
+    }
+
+    // interleave and convert to float in one pass
+    constexpr float kScale = 1.0f / 32768.0f;
+    for (int32_t channel = 0; channel < channelCount; channel++) {
+        const int32_t* plane = &planes[channel * kBlockFrames];
+        float* dst = out + channel;
+        for (int32_t frame = 0; frame < blockFrames; frame++) {
+            dst[frame * channelCount] = plane[frame] * kScale;
+        }
+    }
+}
+
+int32_t CompressedSampleBuffer::findSlot(int32_t blockIndex) const {
+    for (int32_t slot = 0; slot < kCacheSlots; slot++) {
+        if (mCache[slot].blockIndex.load(std::memory_order_acquire) == blockIndex) {
+            return slot;
+        }
+    }
+    return -1;
+}
+
+bool CompressedSampleBuffer::copyFromCache(int32_t blockIndex, int32_t offset, int32_t count,
+                                           float* out) const {
+    // seqlock style read: the copy is only valid if the slot was not rewritten meanwhile
+    int32_t slot = findSlot(blockIndex);
+    if (slot < 0) {
+        return false;
+    }
+    const CacheSlot& cacheSlot = mCache[slot];
+    uint32_t version = cacheSlot.version.load(std::memory_order_acquire);
+    if ((version & 1) != 0 || cacheSlot.blockIndex.load(std::memory_order_acquire) != blockIndex) {
+        return false;
+    }
+    memcpy(out, cacheSlot.samples.get() + offset, count * sizeof(float));
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return cacheSlot.version.load(std::memory_order_relaxed) == version;
+}
+
+const float* CompressedSampleBuffer::getFloatData(int32_t sampleIndex, int32_t numSamples,
+                                                  float* scratch) const {
+    if (mPackedData != nullptr || mNumBlocks == 0) {
+        // not compressed yet
+        return SampleBuffer::getFloatData(sampleIndex, numSamples, scratch);
+    }
+
+    mPlayheadSample.store(sampleIndex, std::memory_order_relaxed);
+    int32_t playBlock = sampleIndex / mBlockSamples;
+    if (mWakeBlock.exchange(playBlock, std::memory_order_relaxed) != playBlock) {
+        sem_post(&mDecodeSemaphore);
+    }
+
+    int32_t written = 0;
+    while (written < numSamples) {
+        int32_t position = sampleIndex + written;
+        int32_t blockIndex = position / mBlockSamples;
+        int32_t offset = position - blockIndex * mBlockSamples;
+        int32_t count = std::min(numSamples - written, mBlockSamples - offset);
+
+        if (!copyFromCache(blockIndex, offset, count, scratch + written)) {
+            mCacheMisses++;
+            decodeBlock(blockIndex, mReaderPlanes.get(), mReaderBlock.get());
+            memcpy(scratch + written, mReaderBlock.get() + offset, count * sizeof(float));
+            // the decode-ahead thread is behind, get it to catch up with the playhead
+            sem_post(&mDecodeSemaphore);
+        }
+        written += count;
+    }
+    return scratch;
+}
+
+const float* CompressedSampleBuffer::readFloatData(int32_t sampleIndex, int32_t numSamples,
+                                                   float* scratch) const {
+    if (mPackedData != nullptr || mNumBlocks == 0) {
+        return SampleBuffer::readFloatData(sampleIndex, numSamples, scratch);
+    }
+
+    // decoder scratch of this call, only allocated if a block is not cached
+    std::vector<int32_t> planes;
+    std::vector<float> block;
+    int32_t written = 0;
+    while (written < numSamples) {
+        int32_t position = sampleIndex + written;
+        int32_t blockIndex = position / mBlockSamples;
+        int32_t offset = position - blockIndex * mBlockSamples;
+        int32_t count = std::min(numSamples - written, mBlockSamples - offset);
+
+        if (!copyFromCache(blockIndex, offset, count, scratch + written)) {
+            if (block.empty()) {
+                planes.resize(static_cast<size_t>(kBlockFrames) * std::max(mAudioProperties.channelCount, 2));
+                block.resize(mBlockSamples);
+            }
+            decodeBlock(blockIndex, planes.data(), block.data());
+            memcpy(scratch + written, block.data() + offset, count * sizeof(float));
+        }
+        written += count;
+    }
+    return scratch;
+}
+
+const void* CompressedSampleBuffer::getStorageRange(int32_t sampleIndex, int32_t numSamples,
+                                                    size_t* numBytes) const {
+    if (mPackedData != nullptr || mNumBlocks == 0) {
+        return SampleBuffer::getStorageRange(sampleIndex, numSamples, numBytes);
+    }
+    int32_t start = std::max(sampleIndex, 0);
+    int32_t end = std::min(sampleIndex + numSamples, mNumSamples);
+    if (end <= start) {
+        *numBytes = 0;
+        return nullptr;
+    }
+    // the compressed blocks covering the range
+    int32_t firstBlock = start / mBlockSamples;
+    int32_t lastBlock = (end - 1) / mBlockSamples;
+    *numBytes = mBlockOffsets[lastBlock + 1] - mBlockOffsets[firstBlock];
+    return mCompressedData.data() + mBlockOffsets[firstBlock];
+}
+
+void CompressedSampleBuffer::startDecodeThread() {
+    if (mNumBlocks == 0 || mDecodeRunning.load()) {
+        return;
+    }
+    mDecodeRunning.store(true);
+    mDecodeThread = std::thread(&CompressedSampleBuffer::decodeAheadLoop, this);
+}
+
+void CompressedSampleBuffer::stopDecodeThread() {
+    mDecodeRunning.store(false);
+    sem_post(&mDecodeSemaphore);
+    if (mDecodeThread.joinable()) {
+        mDecodeThread.join();
+    }
+}
+
+void CompressedSampleBuffer::decodeAheadLoop() {
+    while (mDecodeRunning.load()) {
+        // keep one block behind and the rest ahead of the playhead
+        int32_t playBlock = mPlayheadSample.load(std::memory_order_relaxed) / mBlockSamples;
+        int32_t firstBlock = playBlock - 1;
+        int32_t lastBlock = playBlock + kCacheSlots - 2;
+
+        for (int32_t i = 0; i < kCacheSlots && mDecodeRunning.load(); i++) {
+            // playhead block first, then ahead, the block behind last
+            int32_t blockIndex = (i < kCacheSlots - 1) ? playBlock + i : firstBlock;
+            if (blockIndex < 0 || blockIndex >= mNumBlocks || findSlot(blockIndex) >= 0) {
+                continue;
+            }
+
+            int32_t freeSlot = -1;
+            for (int32_t slot = 0; slot < kCacheSlots; slot++) {
+                int32_t cached = mCache[slot].blockIndex.load(std::memory_order_relaxed);
+                if (cached < 0 || cached < firstBlock || cached > lastBlock) {
+                    freeSlot = slot;
+                    break;
+                }
+            }
+            if (freeSlot < 0) {
+                break;
+            }
+
+            CacheSlot& cacheSlot = mCache[freeSlot];
+            cacheSlot.version.fetch_add(1, std::memory_order_acq_rel);    // odd: being written
+            cacheSlot.blockIndex.store(-1, std::memory_order_release);
+            decodeBlock(blockIndex, mDecoderPlanes.get(), cacheSlot.samples.get());
+            cacheSlot.blockIndex.store(blockIndex, std::memory_order_release);
+            cacheSlot.version.fetch_add(1, std::memory_order_release);    // even: stable
+        }
+
+        // sleep until the playback reader moves on to another block (or stopDecodeThread())
+        while (sem_wait(&mDecodeSemaphore) != 0 && errno == EINTR) {
+        }
+    }
+}
+
+} // namespace iolib
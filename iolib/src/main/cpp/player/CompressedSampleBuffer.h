@@ -0,0 +1,108 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _PLAYER_COMPRESSEDSAMPLEBUFFER_
+#define _PLAYER_COMPRESSEDSAMPLEBUFFER_
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <semaphore.h>
+#include <thread>
+#include <vector>
+
+#include "SampleBuffer.h"
+
+namespace iolib {
+
+/**
+ * A SampleBuffer that keeps its (16-bit) sample data losslessly compressed in memory.
+ *
+ * The data is split into blocks of kBlockFrames frames which are coded independently
+ * (fixed polynomial prediction + stereo decorrelation + partitioned Rice coding), so any
+ * position can be reached in O(1). A decode-ahead thread keeps the blocks around the
+ * playhead decoded to float in a small cache which getFloatData() copies from. Reads that
+ * miss the cache (e.g. right after a seek) decode the block synchronously.
+ *
+ * getFloatData() is the playback path: a single reader (the audio callback) whose position
+ * steers the decode-ahead thread and which decodes misses into scratch kept for it. Any
+ * other reader goes through readFloatData(), which decodes on its own scratch.
+ *
+ * The data is compressed when resampleData() is called, i.e. when the buffer is added to
+ * the SimpleMultiPlayer.
+ */
+class CompressedSampleBuffer : public SampleBuffer {
+public:
+    static constexpr int32_t kBlockFrames = 4096;
+    static constexpr int32_t kCacheSlots = 8;
+
+    CompressedSampleBuffer();
+    virtual ~CompressedSampleBuffer();
+
+    void resampleData(int sampleRate) override;
+
+    size_t getStorageSizeInBytes() const override;
+
+    const float* getFloatData(int32_t sampleIndex, int32_t numSamples, float* scratch) const override;
+    const float* readFloatData(int32_t sampleIndex, int32_t numSamples, float* scratch) const override;
+
+    const void* getStorageRange(int32_t sampleIndex, int32_t numSamples, size_t* numBytes) const override;
+
+    // Number of getFloatData() blocks that had to be decoded on the calling thread
+    int32_t getCacheMissCount() const { return mCacheMisses.load(); }
+
+private:
+    struct CacheSlot {
+        // block held by this slot or -1, version is bumped before and after every rewrite
+        std::atomic<int32_t> blockIndex{-1};
+        std::atomic<uint32_t> version{0};
+        std::unique_ptr<float[]> samples;
+    };
+
+    void compress();
+    void decodeBlock(int32_t blockIndex, int32_t* planes, float* out) const;
+    int32_t getBlockFrames(int32_t blockIndex) const;
+
+    void startDecodeThread();
+    void stopDecodeThread();
+    void decodeAheadLoop();
+    int32_t findSlot(int32_t blockIndex) const;
+    bool copyFromCache(int32_t blockIndex, int32_t offset, int32_t count, float* out) const;
+
+    int32_t mNumBlocks;
+    int32_t mBlockSamples;
+    std::vector<uint8_t>  mCompressedData;
+    std::vector<uint32_t> mBlockOffsets;
+
+    // Decode-ahead cache
+    mutable std::array<CacheSlot, kCacheSlots> mCache;
+    mutable std::atomic<int32_t> mPlayheadSample;
+    mutable std::atomic<int32_t> mCacheMisses;
+
+    // Scratch for the decode-ahead thread and for cache misses of the playback reader
+    std::unique_ptr<int32_t[]> mDecoderPlanes;
+    std::unique_ptr<int32_t[]> mReaderPlanes;
+    std::unique_ptr<float[]>   mReaderBlock;
+
+    // Posted by the playback reader when the playhead enters another block or misses the
+    // cache, sem_post() neither blocks nor locks so it is fine on the audio thread
+    std::thread mDecodeThread;
+    mutable sem_t mDecodeSemaphore;
+    mutable std::atomic<int32_t> mWakeBlock;
+    std::atomic<bool> mDecodeRunning;
+};
+
+} // namespace iolib
+
+#endif //_PLAYER_COMPRESSEDSAMPLEBUFFER_
@@ -25,6 +25,11 @@
 namespace iolib {
 
 void OneShotSampleSource::mixAudio(float* outBuff, int numChannels, int32_t numFrames) {
+    applyRequestedStretchProfile();
+    if (advanceMuted(numFrames)) {
+        return;
+    }
+
     int32_t numSamples = mSampleBuffer->getNumSamples();
     int32_t sampleChannels = mSampleBuffer->getProperties().channelCount;
     int32_t samplesLeft = numSamples - mCurSampleIndex;
@@ -59,45 +64,46 @@ void OneShotSampleSource::mixAudio(float* outBuff, int numChannels, int32_t numF
 //            LOGD("adjustedWriteFrames set to samplesLeft / sampleChannels: %d", adjustedWriteFrames);
         }
 
-        const float* data  = mSampleBuffer->getSampleData();
-
-        // Buffer to hold processed samples
-        std::vector<float> processedSamples(numWriteFrames * sampleChannels);
         // Feed the required number of samples to SoundTouch
-        mSoundTouch.putSamples(data + mCurSampleIndex, adjustedWriteFrames);
-        // Calculate the actual number of processed frames
-        mSoundTouch.receiveSamples(processedSamples.data(), numWriteFrames);
-
+        putFrames(adjustedWriteFrames);
+        // Mix straight from SoundTouch's output storage, without copying it out first
+        const float* processedSamples = nullptr;
+        int32_t numProcessedFrames = std::min(numWriteFrames,
+                                              static_cast<int32_t>(mSoundTouch.peekOutput(&processedSamples)));
 
         if ((sampleChannels == 1) && (numChannels == 1)) {
             // MONO output from MONO samples
-            for (int32_t frameIndex = 0; frameIndex < numWriteFrames; frameIndex++) {
-                outBuff[frameIndex] += processedSamples[frameIndex] * mGain;
+            for (int32_t frameIndex = 0; frameIndex < numProcessedFrames; frameIndex++) {
+                outBuff[frameIndex] += processedSamples[frameIndex] * mGain * nextFadeGain();
             }
         } else if ((sampleChannels == 1) && (numChannels == 2)) {
             // STEREO output from MONO samples
             int dstSampleIndex = 0;
-            for (int32_t frameIndex = 0; frameIndex < numWriteFrames; frameIndex++) {
-                outBuff[dstSampleIndex++] += processedSamples[frameIndex] * mLeftGain;
-                outBuff[dstSampleIndex++] += processedSamples[frameIndex] * mRightGain;
+            for (int32_t frameIndex = 0; frameIndex < numProcessedFrames; frameIndex++) {
+                float fade = nextFadeGain();
+                outBuff[dstSampleIndex++] += processedSamples[frameIndex] * mLeftGain * fade;
+                outBuff[dstSampleIndex++] += processedSamples[frameIndex] * mRightGain * fade;
             }
         } else if ((sampleChannels == 2) && (numChannels == 1)) {
             // MONO output from STEREO samples
             int dstSampleIndex = 0;
-            for (int32_t frameIndex = 0; frameIndex < numWriteFrames; frameIndex++) {
-                outBuff[dstSampleIndex++] += processedSamples[frameIndex * 2] * mLeftGain +
-                                             processedSamples[frameIndex * 2 + 1] * mRightGain;
+            for (int32_t frameIndex = 0; frameIndex < numProcessedFrames; frameIndex++) {
+                outBuff[dstSampleIndex++] += (processedSamples[frameIndex * 2] * mLeftGain +
+                                              processedSamples[frameIndex * 2 + 1] * mRightGain) * nextFadeGain();
             }
         } else if ((sampleChannels == 2) && (numChannels == 2)) {
             // STEREO output from STEREO samples
             int dstSampleIndex = 0;
-            for (int32_t frameIndex = 0; frameIndex < numWriteFrames; frameIndex++) {
-                outBuff[dstSampleIndex++] += processedSamples[frameIndex * 2] * mLeftGain;
-                outBuff[dstSampleIndex++] += processedSamples[frameIndex * 2 + 1] * mRightGain;
+            for (int32_t frameIndex = 0; frameIndex < numProcessedFrames; frameIndex++) {
+                float fade = nextFadeGain();
+                outBuff[dstSampleIndex++] += processedSamples[frameIndex * 2] * mLeftGain * fade;
+                outBuff[dstSampleIndex++] += processedSamples[frameIndex * 2 + 1] * mRightGain * fade;
             }
         }
+        mSoundTouch.consume(numProcessedFrames);
 
         mCurSampleIndex += adjustedWriteFrames * sampleChannels;
+        finishMute();
 
         if (mCurSampleIndex >= numSamples) {
             LOGD("Reached End Of Song: mCurSampleIndex = %d, numSamples = %d", mCurSampleIndex, numSamples);
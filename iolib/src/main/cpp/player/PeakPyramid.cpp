@@ -0,0 +1,233 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "PeakPyramid.h"
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define PEAKPYRAMID_USE_NEON
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define PEAKPYRAMID_USE_SSE2
+#endif
+
+namespace iolib {
+
+// Min, max & sum of squares of numSamples (> 0) samples
+static void scanSamples(const float* src, int32_t numSamples, float* outMin, float* outMax,
+                        float* outSumSquares) {
+    int32_t index = 0;
+    float minValue = src[0];
+    float maxValue = src[0];
+    float sumSquares = 0.0f;
+#if defined(PEAKPYRAMID_USE_NEON)
+    if (numSamples >= 8) {
+        float32x4_t min0 = vld1q_f32(src);
+        float32x4_t max0 = min0;
+        float32x4_t min1 = min0;
+        float32x4_t max1 = min0;
+        float32x4_t sum0 = vdupq_n_f32(0.0f);
+        float32x4_t sum1 = vdupq_n_f32(0.0f);
+        for (; index + 8 <= numSamples; index += 8) {
+            float32x4_t a = vld1q_f32(src + index);
+            float32x4_t b = vld1q_f32(src + index + 4);
+            min0 = vminq_f32(min0, a);
+            max0 = vmaxq_f32(max0, a);
+            min1 = vminq_f32(min1, b);
+            max1 = vmaxq_f32(max1, b);
+            sum0 = vmlaq_f32(sum0, a, a);
+            sum1 = vmlaq_f32(sum1, b, b);
+        }
+        float mins[4];
+        float maxs[4];
+        float sums[4];
+        vst1q_f32(mins, vminq_f32(min0, min1));
+        vst1q_f32(maxs, vmaxq_f32(max0, max1));
+        vst1q_f32(sums, vaddq_f32(sum0, sum1));
+        minValue = std::min(std::min(mins[0], mins[1]), std::min(mins[2], mins[3]));
+        maxValue = std::max(std::max(maxs[0], maxs[1]), std::max(maxs[2], maxs[3]));
+        sumSquares = (sums[0] + sums[1]) + (sums[2] + sums[3]);
+    }
+#elif defined(PEAKPYRAMID_USE_SSE2)
+    if (numSamples >= 8) {
+        __m128 min0 = _mm_loadu_ps(src);
+        __m128 max0 = min0;
+        __m128 min1 = min0;
+        __m128 max1 = min0;
+        __m128 sum0 = _mm_setzero_ps();
+        __m128 sum1 = _mm_setzero_ps();
+        for (; index + 8 <= numSamples; index += 8) {
+            __m128 a = _mm_loadu_ps(src + index);
+            __m128 b = _mm_loadu_ps(src + index + 4);
+            min0 = _mm_min_ps(min0, a);
+            max0 = _mm_max_ps(max0, a);
+            min1 = _mm_min_ps(min1, b);
+            max1 = _mm_max_ps(max1, b);
+            sum0 = _mm_add_ps(sum0, _mm_mul_ps(a, a));
+            sum1 = _mm_add_ps(sum1, _mm_mul_ps(b, b));
+        }
+        float mins[4];
+        float maxs[4];
+        float sums[4];
+        _mm_storeu_ps(mins, _mm_min_ps(min0, min1));
+        _mm_storeu_ps(maxs, _mm_max_ps(max0, max1));
+        _mm_storeu_ps(sums, _mm_add_ps(sum0, sum1));
+        minValue = std::min(std::min(mins[0], mins[1]), std::min(mins[2], mins[3]));
+        maxValue = std::max(std::max(maxs[0], maxs[1]), std::max(maxs[2], maxs[3]));
+        sumSquares = (sums[0] + sums[1]) + (sums[2] + sums[3]);
+    }
+#endif
+    for (; index < numSamples; index++) {
+        minValue = std::min(minValue, src[index]);
+        maxValue = std::max(maxValue, src[index]);
+        sumSquares += src[index] * src[index];
+    }
+    *outMin = minValue;
+    *outMax = maxValue;
+    *outSumSquares = sumSquares;
+}
+
+void PeakPyramid::begin(int32_t channelCount) {
+    clear();
+    mChannelCount = std::max(channelCount, 1);
+}
+
+void PeakPyramid::clear() {
+    mLevels.clear();
+    mBase = Level();
+    mNumFrames = 0;
+    mNumSamples = 0;
+    mBinSamples = 0;
+}
+
+void PeakPyramid::accumulate(const float* data, int32_t numSamples) {
+    const int32_t binSamples = kBaseBinFrames * mChannelCount;
+    mNumSamples += numSamples;
+    while (numSamples > 0) {
+        int32_t count = std::min(numSamples, binSamples - mBinSamples);
+        float minValue;
+        float maxValue;
+        float sumSquares;
+        scanSamples(data, count, &minValue, &maxValue, &sumSquares);
+        if (mBinSamples == 0) {
+            mBinMin = minValue;
+            mBinMax = maxValue;
+            mBinSumSquares = sumSquares;
+        } else {
+            mBinMin = std::min(mBinMin, minValue);
+            mBinMax = std::max(mBinMax, maxValue);
+            mBinSumSquares += sumSquares;
+        }
+        mBinSamples += count;
+        if (mBinSamples == binSamples) {
+            mBase.mins.push_back(mBinMin);
+            mBase.maxs.push_back(mBinMax);
+            mBase.sumSquares.push_back(mBinSumSquares);
+            mBinSamples = 0;
+        }
+        data += count;
+        numSamples -= count;
+    }
+}
+
+void PeakPyramid::finish() {
+    if (mBinSamples > 0) {
+        mBase.mins.push_back(mBinMin);
+        mBase.maxs.push_back(mBinMax);
+        mBase.sumSquares.push_back(mBinSumSquares);
+        mBinSamples = 0;
+    }
+    mNumFrames = mNumSamples / mChannelCount;
+    if (mBase.mins.empty()) {
+        return;
+    }
+    mLevels.push_back(std::move(mBase));
+    mBase = Level();
+
+    // each level merges kLevelFactor bins of the one below, up to a single bin
+    while (mLevels.back().mins.size() > 1) {
+        const Level& lower = mLevels.back();
+        Level upper;
+        upper.binFrames = lower.binFrames * kLevelFactor;
+        size_t numBins = (lower.mins.size() + kLevelFactor - 1) / kLevelFactor;
+        upper.mins.resize(numBins);
+        upper.maxs.resize(numBins);
+        upper.sumSquares.resize(numBins);
+        for (size_t bin = 0; bin < numBins; bin++) {
+            size_t first = bin * kLevelFactor;
+            size_t last = std::min(first + kLevelFactor, lower.mins.size());
+            upper.mins[bin] = *std::min_element(lower.mins.begin() + first, lower.mins.begin() + last);
+            upper.maxs[bin] = *std::max_element(lower.maxs.begin() + first, lower.maxs.begin() + last);
+            float sumSquares = 0.0f;
+            for (size_t index = first; index < last; index++) {
+                sumSquares += lower.sumSquares[index];
+            }
+            upper.sumSquares[bin] = sumSquares;
+        }
+        mLevels.push_back(std::move(upper));
+    }
+}
+
+void PeakPyramid::query(double startFrame, double endFrame, int32_t numBins, float* out) const {
+    if (numBins <= 0) {
+        return;
+    }
+    memset(out, 0, sizeof(float) * 3 * numBins);
+    if (mLevels.empty() || endFrame <= startFrame) {
+        return;
+    }
+
+    // the coarsest level with bins no wider than the requested ones, so every requested
+    // bin merges at most a few of its bins
+    double framesPerBin = (endFrame - startFrame) / numBins;
+    size_t levelIndex = 0;
+    while (levelIndex + 1 < mLevels.size() && mLevels[levelIndex + 1].binFrames <= framesPerBin) {
+        levelIndex++;
+    }
+    const Level& level = mLevels[levelIndex];
+    const int64_t numLevelBins = static_cast<int64_t>(level.mins.size());
+
+    for (int32_t bin = 0; bin < numBins; bin++) {
+        double binStart = std::max(0.0, startFrame + bin * framesPerBin);
+        double binEnd = std::min(static_cast<double>(mNumFrames), startFrame + (bin + 1) * framesPerBin);
+        if (binEnd <= binStart) {
+            continue;
+        }
+        int64_t first = static_cast<int64_t>(binStart / level.binFrames);
+        int64_t last = std::min(numLevelBins, static_cast<int64_t>(std::ceil(binEnd / level.binFrames)));
+        if (first >= last) {
+            continue;
+        }
+
+        float minValue = level.mins[first];
+        float maxValue = level.maxs[first];
+        float sumSquares = 0.0f;
+        for (int64_t index = first; index < last; index++) {
+            minValue = std::min(minValue, level.mins[index]);
+            maxValue = std::max(maxValue, level.maxs[index]);
+            sumSquares += level.sumSquares[index];
+        }
+        // the last bin of a level may be partial
+        int64_t numFrames = std::min(last * level.binFrames, mNumFrames) - first * level.binFrames;
+        out[3 * bin] = minValue;
+        out[3 * bin + 1] = maxValue;
+        out[3 * bin + 2] = std::sqrt(sumSquares / static_cast<float>(numFrames * mChannelCount));
+    }
+}
+
+} // namespace iolib
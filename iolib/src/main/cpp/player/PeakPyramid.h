@@ -0,0 +1,76 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _PLAYER_PEAKPYRAMID_
+#define _PLAYER_PEAKPYRAMID_
+
+#include <cstdint>
+#include <vector>
+
+namespace iolib {
+
+/*
+ * Min/max/RMS summary of a sample buffer for waveform display, at 256, 1024, 4096, ...
+ * frames per bin up to a single bin for the whole buffer. The channels are summarized
+ * together. Built once from the samples as they are loaded, after that any range can be
+ * drawn at any zoom in time proportional to the number of bins asked for.
+ */
+class PeakPyramid {
+public:
+    static constexpr int32_t kBaseBinFrames = 256;
+    static constexpr int32_t kLevelFactor = 4;
+
+    // Starts a new pyramid, discarding the current one
+    void begin(int32_t channelCount);
+    // Adds the next numSamples interleaved samples (any number, not only whole frames)
+    void accumulate(const float* data, int32_t numSamples);
+    // Completes the last bin & builds the coarser levels, the pyramid is usable after this
+    void finish();
+    void clear();
+
+    bool isEmpty() const { return mLevels.empty(); }
+    int32_t getNumLevels() const { return static_cast<int32_t>(mLevels.size()); }
+    int64_t getNumFrames() const { return mNumFrames; }
+
+    /*
+     * Summarizes frames [startFrame, endFrame) in numBins equal bins, writing min, max and
+     * RMS of each to out (3 * numBins floats). Bins narrower than kBaseBinFrames repeat the
+     * 256-frame bins they fall into, bins past the end of the data are zero.
+     */
+    void query(double startFrame, double endFrame, int32_t numBins, float* out) const;
+
+private:
+    struct Level {
+        int64_t binFrames = kBaseBinFrames;
+        std::vector<float> mins;
+        std::vector<float> maxs;
+        std::vector<float> sumSquares;  // of all samples in the bin
+    };
+
+    std::vector<Level> mLevels;
+    int32_t mChannelCount = 0;
+    int64_t mNumFrames = 0;
+
+    // level 0 bin being accumulated
+    Level mBase;
+    int32_t mBinSamples = 0;
+    float mBinMin = 0.0f;
+    float mBinMax = 0.0f;
+    float mBinSumSquares = 0.0f;
+    int64_t mNumSamples = 0;
+};
+
+} // namespace iolib
+
+#endif //_PLAYER_PEAKPYRAMID_
@@ -0,0 +1,275 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cerrno>
+#include <cstring>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "PlaybackWindow.h"
+
+#include <android/log.h>
+#define LOG_TAG "PlaybackWindow"
+#define LOGD(...) __android_log_print(ANDROID_LOG_DEBUG, LOG_TAG, __VA_ARGS__)
+
+namespace iolib {
+
+// Interval at which the window follows the playhead
+constexpr auto kUpdateInterval = std::chrono::milliseconds(20);
+
+PlaybackWindow::PlaybackWindow()
+    : mPlayheadFrame(0), mLoopStartFrame(-1), mLoopEndFrame(-1),
+      mAudioMinorFaults(-1), mAudioMajorFaults(-1), mLoggedFaults(-1),
+      mPageSize(static_cast<uintptr_t>(sysconf(_SC_PAGESIZE))), mLockAllowed(true),
+      mRunning(false) {}
+
+PlaybackWindow::~PlaybackWindow() {
+    clear();
+}
+
+void PlaybackWindow::addBuffer(SampleBuffer* buffer) {
+    {
+        std::lock_guard<std::mutex> lock(mBuffersMutex);
+        mBuffers.push_back({buffer, PageRange(), PageRange(), PageRange(), false});
+    }
+    start();
+}
+
+void PlaybackWindow::clear() {
+    stop();
+    std::lock_guard<std::mutex> lock(mBuffersMutex);
+    for (WindowedBuffer& windowed : mBuffers) {
+        releaseWindow(&windowed);
+    }
+    mBuffers.clear();
+}
+
+void PlaybackWindow::setLoopRegion(int32_t startFrame, int32_t endFrame) {
+    mLoopStartFrame.store(startFrame, std::memory_order_relaxed);
+    mLoopEndFrame.store(endFrame, std::memory_order_relaxed);
+}
+
+void PlaybackWindow::start() {
+    if (mRunning.load()) {
+        return;
+    }
+    mRunning.store(true);
+    mThread = std::thread(&PlaybackWindow::windowLoop, this);
+}
+
+void PlaybackWindow::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mThreadMutex);
+        mRunning.store(false);
+    }
+    mThreadCondition.notify_all();
+    if (mThread.joinable()) {
+        mThread.join();
+    }
+}
+
+/*
+ * Calls fn(start, end) for the parts of [start, end) not covered by a or b.
+ */
+template <typename Fn>
+static void forEachUncovered(uintptr_t start, uintptr_t end, uintptr_t aStart, uintptr_t aEnd,
+                             uintptr_t bStart, uintptr_t bEnd, Fn fn) {
+    uintptr_t pieces[2][2] = { {start, std::min(end, aStart)}, {std::max(start, aEnd), end} };
+    if (aStart >= aEnd) {
+        // empty cover
+        pieces[0][1] = end;
+        pieces[1][0] = end;
+    }
+    for (auto& piece : pieces) {
+        if (piece[0] >= piece[1]) {
+            continue;
+        }
+        if (bStart >= bEnd) {
+            fn(piece[0], piece[1]);
+            continue;
+        }
+        if (piece[0] < std::min(piece[1], bStart)) {
+            fn(piece[0], std::min(piece[1], bStart));
+        }
+        if (std::max(piece[0], bEnd) < piece[1]) {
+            fn(std::max(piece[0], bEnd), piece[1]);
+        }
+    }
+}
+
+PlaybackWindow::PageRange PlaybackWindow::getPageRange(SampleBuffer* buffer, int32_t startFrame,
+                                                       int32_t endFrame) const {
+    PageRange range;
+    int32_t channelCount = buffer->getChannelCount();
+    if (startFrame >= 0 && endFrame > startFrame && channelCount > 0) {
+        size_t numBytes = 0;
+        const void* address = buffer->getStorageRange(startFrame * channelCount,
+                                                      (endFrame - startFrame) * channelCount,
+                                                      &numBytes);
+        if (address != nullptr && numBytes > 0) {
+            uintptr_t begin = reinterpret_cast<uintptr_t>(address);
+            range.start = begin & ~(mPageSize - 1);
+            range.end = (begin + numBytes + mPageSize - 1) & ~(mPageSize - 1);
+        }
+    }
+    return range;
+}
+
+PlaybackWindow::PageRange PlaybackWindow::getOwnedPages(SampleBuffer* buffer) const {
+    PageRange range;
+    size_t numBytes = 0;
+    const void* address = buffer->getStorageRange(0, buffer->getNumSamples(), &numBytes);
+    if (address != nullptr && numBytes > 0) {
+        // round inward: the edge pages may belong to another buffer's window too
+        uintptr_t begin = reinterpret_cast<uintptr_t>(address);
+        uintptr_t start = (begin + mPageSize - 1) & ~(mPageSize - 1);
+        uintptr_t end = (begin + numBytes) & ~(mPageSize - 1);
+        if (start < end) {
+            range.start = start;
+            range.end = end;
+        }
+    }
+    return range;
+}
+
+/*
+ * munlock()s the part of [start, end) inside owned. munlock() does not nest, so unlocking
+ * a page shared with another buffer would drop that buffer's lock as well.
+ */
+void PlaybackWindow::unlockOwnedPages(uintptr_t start, uintptr_t end, const PageRange& owned) {
+    start = std::max(start, owned.start);
+    end = std::min(end, owned.end);
+    if (start < end) {
+        munlock(reinterpret_cast<void*>(start), end - start);
+    }
+}
+
+void PlaybackWindow::updateWindow(WindowedBuffer* windowed, PageRange playRange, PageRange loopRange) {
+    const PageRange oldPlay = windowed->playRange;
+    const PageRange oldLoop = windowed->loopRange;
+
+    if (mLockAllowed) {
+        // lock the pages entering the window (mlock() faults them in)
+        bool lockFailed = false;
+        auto lockPages = [&lockFailed](uintptr_t start, uintptr_t end) {
+            if (!lockFailed && mlock(reinterpret_cast<void*>(start), end - start) != 0) {
+                LOGD("mlock() failed (%s), falling back to prefaulting", strerror(errno));
+                lockFailed = true;
+            }
+        };
+        forEachUncovered(playRange.start, playRange.end, oldPlay.start, oldPlay.end,
+                         oldLoop.start, oldLoop.end, lockPages);
+        forEachUncovered(loopRange.start, loopRange.end, oldPlay.start, oldPlay.end,
+                         oldLoop.start, oldLoop.end, lockPages);
+
+        if (!lockFailed) {
+            // unlock the pages that left both ranges (munlock() does not nest)
+            const PageRange& owned = windowed->ownedPages;
+            auto unlockPages = [&owned](uintptr_t start, uintptr_t end) {
+                unlockOwnedPages(start, end, owned);
+            };
+            forEachUncovered(oldPlay.start, oldPlay.end, playRange.start, playRange.end,
+                             loopRange.start, loopRange.end, unlockPages);
+            forEachUncovered(oldLoop.start, oldLoop.end, playRange.start, playRange.end,
+                             loopRange.start, loopRange.end, unlockPages);
+            windowed->playRange = playRange;
+            windowed->loopRange = loopRange;
+            windowed->locked = true;
+            return;
+        }
+
+        mLockAllowed = false;
+        unlockOwnedPages(playRange.start, playRange.end, windowed->ownedPages);
+        unlockOwnedPages(loopRange.start, loopRange.end, windowed->ownedPages);
+    }
+
+    // No locking: hint the pages entering the window and touch the whole window every
+    // round, so pages reclaimed meanwhile are faulted back in here and not on the audio thread.
+    releaseWindow(windowed);
+    auto advisePages = [](uintptr_t start, uintptr_t end) {
+        madvise(reinterpret_cast<void*>(start), end - start, MADV_WILLNEED);
+    };
+    forEachUncovered(playRange.start, playRange.end, oldPlay.start, oldPlay.end,
+                     oldLoop.start, oldLoop.end, advisePages);
+    forEachUncovered(loopRange.start, loopRange.end, oldPlay.start, oldPlay.end,
+                     oldLoop.start, oldLoop.end, advisePages);
+    for (const PageRange& range : {playRange, loopRange}) {
+        for (uintptr_t page = range.start; page < range.end; page += mPageSize) {
+            (void) *reinterpret_cast<volatile const uint8_t*>(page);
+        }
+    }
+    windowed->playRange = playRange;
+    windowed->loopRange = loopRange;
+}
+
+void PlaybackWindow::releaseWindow(WindowedBuffer* windowed) {
+    if (windowed->locked) {
+        PageRange& play = windowed->playRange;
+        PageRange& loop = windowed->loopRange;
+        unlockOwnedPages(play.start, play.end, windowed->ownedPages);
+        unlockOwnedPages(loop.start, loop.end, windowed->ownedPages);
+        windowed->locked = false;
+    }
+}
+
+void PlaybackWindow::windowLoop() {
+    while (mRunning.load()) {
+        {
+            std::lock_guard<std::mutex> lock(mBuffersMutex);
+            for (WindowedBuffer& windowed : mBuffers) {
+                SampleBuffer* buffer = windowed.buffer;
+                int32_t sampleRate = buffer->getSampleRate();
+                int32_t framesBehind = static_cast<int32_t>(sampleRate * kSecondsBehind);
+                int32_t framesAhead = static_cast<int32_t>(sampleRate * kSecondsAhead);
+                int32_t numFrames = buffer->getNumSamples() / std::max(buffer->getChannelCount(), 1);
+
+                int32_t playhead = mPlayheadFrame.load(std::memory_order_relaxed);
+                PageRange playRange = getPageRange(buffer,
+                                                   std::max(playhead - framesBehind, 0),
+                                                   std::min(playhead + framesAhead, numFrames));
+
+                // keep the start of the loop resident so the jump back does not fault
+                PageRange loopRange;
+                int32_t loopStart = mLoopStartFrame.load(std::memory_order_relaxed);
+                int32_t loopEnd = mLoopEndFrame.load(std::memory_order_relaxed);
+                if (loopStart >= 0 && loopEnd > loopStart) {
+                    loopRange = getPageRange(buffer, loopStart,
+                                             std::min({loopEnd, loopStart + framesAhead, numFrames}));
+                }
+
+                windowed.ownedPages = getOwnedPages(buffer);
+                updateWindow(&windowed, playRange, loopRange);
+            }
+        }
+
+        // faults the window failed to prevent, reported by the audio thread
+        long minorFaults = mAudioMinorFaults.load(std::memory_order_relaxed);
+        long majorFaults = mAudioMajorFaults.load(std::memory_order_relaxed);
+        if (minorFaults >= 0 && minorFaults + majorFaults != mLoggedFaults) {
+            if (mLoggedFaults >= 0) {
+                LOGD("page faults in audio callback: %ld (major %ld)",
+                     minorFaults + majorFaults - mLoggedFaults, majorFaults);
+            }
+            mLoggedFaults = minorFaults + majorFaults;
+        }
+
+        std::unique_lock<std::mutex> lock(mThreadMutex);
+        mThreadCondition.wait_for(lock, kUpdateInterval, [this] { return !mRunning.load(); });
+    }
+}
+
+} // namespace iolib
@@ -0,0 +1,113 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _PLAYER_PLAYBACKWINDOW_
+#define _PLAYER_PLAYBACKWINDOW_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "SampleBuffer.h"
+
+namespace iolib {
+
+/**
+ * Keeps the sample memory the audio callback is about to read resident, so that
+ * OneShotSampleSource::mixAudio() does not take page faults.
+ *
+ * A background thread follows the playhead (and the loop-in point, if a loop is set) and
+ * mlock()s a window of pages around it in every registered SampleBuffer, unlocking the
+ * pages that fall behind. Where mlock() is not permitted (RLIMIT_MEMLOCK is small on
+ * Android) the pages are madvise(MADV_WILLNEED)ed and touched instead.
+ *
+ * The playhead and loop region are set from the audio thread and are lock-free.
+ */
+class PlaybackWindow {
+public:
+    // Window around a position, in seconds
+    static constexpr float kSecondsBehind = 1.0f;
+    static constexpr float kSecondsAhead = 8.0f;
+
+    PlaybackWindow();
+    ~PlaybackWindow();
+
+    // Buffers must not be deleted while registered
+    void addBuffer(SampleBuffer* buffer);
+    void clear();
+
+    // Positions in frames at the (common) sample rate of the buffers
+    void setPlayheadFrame(int32_t frame) { mPlayheadFrame.store(frame, std::memory_order_relaxed); }
+    void setLoopRegion(int32_t startFrame, int32_t endFrame);
+    void clearLoopRegion() { setLoopRegion(-1, -1); }
+
+    // Running page fault totals of the audio thread, logged from the window thread whenever
+    // they grow. Only reported in builds with PLAYER_COUNT_PAGE_FAULTS (see SimpleMultiPlayer).
+    void setAudioPageFaults(long minor, long major) {
+        mAudioMinorFaults.store(minor, std::memory_order_relaxed);
+        mAudioMajorFaults.store(major, std::memory_order_relaxed);
+    }
+
+private:
+    // Page aligned [start, end) address range, empty if start == end
+    struct PageRange {
+        uintptr_t start = 0;
+        uintptr_t end = 0;
+    };
+
+    struct WindowedBuffer {
+        SampleBuffer* buffer;
+        PageRange playRange;
+        PageRange loopRange;
+        // Pages that hold only this buffer's samples. The partial pages at either end may
+        // be shared with neighbouring allocations, so they are never munlock()ed.
+        PageRange ownedPages;
+        bool locked;
+    };
+
+    void start();
+    void stop();
+    void windowLoop();
+    PageRange getPageRange(SampleBuffer* buffer, int32_t startFrame, int32_t endFrame) const;
+    PageRange getOwnedPages(SampleBuffer* buffer) const;
+    static void unlockOwnedPages(uintptr_t start, uintptr_t end, const PageRange& owned);
+    void updateWindow(WindowedBuffer* windowed, PageRange playRange, PageRange loopRange);
+    void releaseWindow(WindowedBuffer* windowed);
+
+    std::vector<WindowedBuffer> mBuffers;
+    std::mutex mBuffersMutex;
+
+    std::atomic<int32_t> mPlayheadFrame;
+    std::atomic<int32_t> mLoopStartFrame;
+    std::atomic<int32_t> mLoopEndFrame;
+
+    std::atomic<long> mAudioMinorFaults;
+    std::atomic<long> mAudioMajorFaults;
+    long mLoggedFaults;
+
+    uintptr_t mPageSize;
+    bool mLockAllowed;
+
+    std::thread mThread;
+    std::mutex mThreadMutex;
+    std::condition_variable mThreadCondition;
+    std::atomic<bool> mRunning;
+};
+
+} // namespace iolib
+
+#endif //_PLAYER_PLAYBACKWINDOW_
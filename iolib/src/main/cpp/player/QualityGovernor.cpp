@@ -0,0 +1,168 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+
+#include <android/log.h>
+
+#include "QualityGovernor.h"
+
+static const char* TAG = "QualityGovernor";
+
+namespace iolib {
+
+// Step down above 70% of the deadline (the rest is the mixer's and the system's), or at
+// once when a callback missed it. Step up after 3 s below 35%, twice as long each time a
+// step up is followed by a step down within 10 s, up to a minute.
+static constexpr float kStepDownLoad = 0.7f;
+static constexpr float kStepUpLoad = 0.35f;
+static constexpr float kMissedLoad = 1.0f;
+static constexpr int32_t kStepUpDelayMs = 3000;
+static constexpr int32_t kMaxStepUpDelayMs = 60000;
+static constexpr int32_t kRelapseMs = 10000;
+
+// Wait between steps down, long enough to see the effect in the smoothed load
+static constexpr int32_t kStepDownHoldMs = 200;
+
+// Smoothing of the load and of the source costs, per callback
+static constexpr float kSmoothing = 0.1f;
+
+void QualityGovernor::clear(std::vector<SampleSource*>& sources, int32_t numSources) {
+    mSourceNanos.fill(0);
+    mSourceCost.fill(0.0f);
+    mLevels.fill(QualityLevel::Full);
+    for (int32_t index = 0; index < numSources; index++) {
+        mLevels[index] = sources[index]->getQualityLevel();
+    }
+    mLoad = 0.0f;
+    mHoldFrames = 0;
+    mCalmFrames = 0;
+    mFramesSinceStepUp = -1;
+    mStepUpDelayMs = kStepUpDelayMs;
+}
+
+QualityLevel QualityGovernor::getLevel(int32_t index) const {
+    if (index < 0 || index >= kMaxSources) {
+        return QualityLevel::Full;
+    }
+    return mLevels[index];
+}
+
+void QualityGovernor::update(std::vector<SampleSource*>& sources, int32_t numSources,
+                             int64_t renderNanos, int32_t numFrames, int32_t sampleRate) {
+    numSources = std::min(numSources, kMaxSources);
+    if (mResetRequested.exchange(false, std::memory_order_acquire)) {
+        clear(sources, numSources);
+    }
+    if (numFrames <= 0 || sampleRate <= 0 || numSources == 0) {
+        return;
+    }
+
+    for (int32_t index = 0; index < numSources; index++) {
+        mSourceCost[index] += kSmoothing * (static_cast<float>(mSourceNanos[index]) - mSourceCost[index]);
+        mSourceNanos[index] = 0;
+    }
+
+    float deadlineNanos = numFrames * 1e9f / sampleRate;
+    float load = renderNanos / deadlineNanos;
+    mLoad += kSmoothing * (load - mLoad);
+    mHoldFrames = std::max<int64_t>(0, mHoldFrames - numFrames);
+    if (mFramesSinceStepUp >= 0) {
+        mFramesSinceStepUp += numFrames;
+    }
+
+    if (load >= kMissedLoad || mLoad > kStepDownLoad) {
+        mCalmFrames = 0;
+        if (mHoldFrames > 0) {
+            return;
+        }
+        // the most expensive source that still has a step left
+        int32_t victim = -1;
+        for (int32_t index = 0; index < numSources; index++) {
+            if (mLevels[index] != QualityLevel::NoAntiAlias &&
+                (victim < 0 || mSourceCost[index] > mSourceCost[victim])) {
+                victim = index;
+            }
+        }
+        if (victim >= 0) {
+            if (mFramesSinceStepUp >= 0 &&
+                mFramesSinceStepUp < static_cast<int64_t>(sampleRate) * kRelapseMs / 1000) {
+                mStepUpDelayMs = std::min(2 * mStepUpDelayMs, kMaxStepUpDelayMs);
+            }
+            mFramesSinceStepUp = -1;
+            setLevel(sources[victim], victim,
+                     static_cast<QualityLevel>(static_cast<int32_t>(mLevels[victim]) + 1),
+                     std::max(load, mLoad));
+            mHoldFrames = static_cast<int64_t>(sampleRate) * kStepDownHoldMs / 1000;
+        }
+    } else if (mLoad < kStepUpLoad) {
+        mCalmFrames += numFrames;
+        if (mCalmFrames < static_cast<int64_t>(sampleRate) * mStepUpDelayMs / 1000) {
+            return;
+        }
+        // the most degraded source
+        int32_t index = static_cast<int32_t>(
+                std::max_element(mLevels.begin(), mLevels.begin() + numSources) - mLevels.begin());
+        if (mLevels[index] != QualityLevel::Full) {
+            setLevel(sources[index], index,
+                     static_cast<QualityLevel>(static_cast<int32_t>(mLevels[index]) - 1), mLoad);
+            mFramesSinceStepUp = 0;
+        }
+        mCalmFrames = 0;
+    } else {
+        mCalmFrames = 0;
+    }
+}
+
+void QualityGovernor::setLevel(SampleSource* source, int32_t index, QualityLevel level, float load) {
+    QualityLevel previous = mLevels[index];
+    mLevels[index] = level;
+    source->setQualityLevel(level);
+
+    static_assert(std::atomic<Transition>::is_always_lock_free, "recorded on the audio thread");
+    Transition transition;
+    transition.index = static_cast<uint8_t>(index);
+    transition.from = static_cast<uint8_t>(previous);
+    transition.to = static_cast<uint8_t>(level);
+    transition.loadPercent = static_cast<uint16_t>(std::clamp(load * 100.0f, 0.0f, 65535.0f));
+    transition.costMicros = static_cast<uint16_t>(std::clamp(mSourceCost[index] / 1000.0f, 0.0f, 65535.0f));
+    int32_t number = mNumTransitions.load(std::memory_order_relaxed);
+    mTransitions[number % kMaxPendingTransitions].store(transition, std::memory_order_relaxed);
+    mNumTransitions.store(number + 1, std::memory_order_release);
+}
+
+void QualityGovernor::logTransitions() {
+    int32_t end = mNumTransitions.load(std::memory_order_acquire);
+    int32_t number = mNumLoggedTransitions.exchange(end);
+    if (end - number > kMaxPendingTransitions) {
+        __android_log_print(ANDROID_LOG_INFO, TAG, "%d transitions not logged",
+                            end - number - kMaxPendingTransitions);
+        number = end - kMaxPendingTransitions;
+    }
+    for (; number < end; number++) {
+        Transition transition = mTransitions[number % kMaxPendingTransitions].load(std::memory_order_relaxed);
+        if (mNumTransitions.load(std::memory_order_acquire) - number > kMaxPendingTransitions) {
+            // overwritten by a newer one while logging
+            continue;
+        }
+        __android_log_print(ANDROID_LOG_INFO, TAG,
+                            "#%d source %d: %s -> %s at %d%% of the deadline, %d us/callback",
+                            number + 1, transition.index,
+                            getQualityLevelName(static_cast<QualityLevel>(transition.from)),
+                            getQualityLevelName(static_cast<QualityLevel>(transition.to)),
+                            transition.loadPercent, transition.costMicros);
+    }
+}
+
+} // namespace iolib
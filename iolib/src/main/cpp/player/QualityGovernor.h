@@ -0,0 +1,105 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _PLAYER_QUALITYGOVERNOR_
+#define _PLAYER_QUALITYGOVERNOR_
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include "SampleSource.h"
+#include "StretchProfile.h"
+
+namespace iolib {
+
+/*
+ * Trades time-stretch quality for render time when the audio callback gets close to its
+ * deadline (the duration of the frames it renders), instead of letting it underrun.
+ *
+ * Under load the most expensive source steps down one QualityLevel at a time, waiting a
+ * little between steps for the change to show in the render time. Once the callbacks have
+ * stayed well within the deadline for a few seconds, the most degraded source steps back
+ * up. The gap between the two thresholds and the wait keep it from oscillating, and the
+ * wait grows when a step up has to be taken back soon after.
+ *
+ * The per-source state is sized once for kMaxSources, sources past that are not governed.
+ * Audio thread only, apart from reset() and logTransitions(). The audio thread only records
+ * the transitions, logTransitions() logs them.
+ */
+class QualityGovernor {
+public:
+    static constexpr int32_t kMaxSources = 64;
+
+    // Starts over when sources were added or removed, the next update() clears the state
+    // (and takes each source's current level), so it can be called while callbacks run
+    void reset() { mResetRequested.store(true, std::memory_order_release); }
+
+    // Render time of source index in the current callback
+    void addSourceTime(int32_t index, int64_t nanos) {
+        if (index < kMaxSources) {
+            mSourceNanos[index] += nanos;
+        }
+    }
+
+    // End of a callback that took renderNanos for numFrames frames
+    void update(std::vector<SampleSource*>& sources, int32_t numSources,
+                int64_t renderNanos, int32_t numFrames, int32_t sampleRate);
+
+    QualityLevel getLevel(int32_t index) const;
+
+    int32_t getNumTransitions() const { return mNumTransitions.load(std::memory_order_acquire); }
+
+    // Logs the transitions recorded since the last call, from a thread that may block (liblog can
+    // lock and allocate), e.g. while the UI polls the levels. One thread at a time.
+    void logTransitions();
+
+private:
+    void setLevel(SampleSource* source, int32_t index, QualityLevel level, float load);
+
+    void clear(std::vector<SampleSource*>& sources, int32_t numSources);
+
+    // A transition as setLevel() records it for logTransitions(), small enough to be stored
+    // atomically without a lock
+    struct Transition {
+        uint8_t index;
+        uint8_t from;
+        uint8_t to;
+        uint16_t loadPercent;
+        uint16_t costMicros;
+    };
+    // Transitions kept for logTransitions(), older ones are only counted
+    static constexpr int32_t kMaxPendingTransitions = 16;
+
+    std::array<int64_t, kMaxSources> mSourceNanos{};        // this callback
+    std::array<float, kMaxSources> mSourceCost{};           // smoothed, nanoseconds per callback
+    std::array<QualityLevel, kMaxSources> mLevels{};
+
+    std::atomic<bool> mResetRequested{true};
+
+    float mLoad = 0.0f;                     // smoothed render time / deadline
+    int64_t mHoldFrames = 0;                // frames to wait before the next step down
+    int64_t mCalmFrames = 0;                // frames rendered since the load was last high
+    int64_t mFramesSinceStepUp = -1;        // -1 when a step down came after the last step up
+    int32_t mStepUpDelayMs = 0;
+
+    std::array<std::atomic<Transition>, kMaxPendingTransitions> mTransitions;
+    std::atomic<int32_t> mNumTransitions{0};
+    std::atomic<int32_t> mNumLoggedTransitions{0};
+};
+
+} // namespace iolib
+
+#endif //_PLAYER_QUALITYGOVERNOR_
@@ -14,6 +14,9 @@
  * limitations under the License.
  */
 
+#include <algorithm>
+#include <cstring>
+
 #include "SampleBuffer.h"
 
 // Resampler Includes
@@ -29,16 +32,59 @@ using namespace RESAMPLER_OUTER_NAMESPACE::resampler;
 
 namespace iolib {
 
+// Size of the stack blocks used when converting between storage formats
+constexpr int32_t kConversionBlockSamples = 1024;
+
 void SampleBuffer::loadSampleData(parselib::WavStreamReader* reader) {
     mAudioProperties.channelCount = reader->getNumChannels();
     mAudioProperties.sampleRate = reader->getSampleRate();
 
     reader->positionToAudio();
 
+    int32_t numSamples = reader->getNumSampleFrames() * reader->getNumChannels();
+    float* data = new float[numSamples];
+
+    reader->getDataFloat(data, reader->getNumSampleFrames());
+
+    storeFloatData(data, numSamples);
+}
+
+void SampleBuffer::loadSampleData(parselib::WavStreamReader* reader,
+                                  std::shared_ptr<parselib::InputStream> stream) {
+    const unsigned char* audioData = reader->getAudioDataPointer();
+    int encoding = reader->getSampleEncoding();
+
+    bool inPlace = false;
+    if (audioData != nullptr) {
+        if (mSampleFormat == SampleFormat::Float32) {
+            inPlace = encoding == parselib::AudioEncoding::PCM_IEEEFLOAT;
+        } else if (mSampleFormat == SampleFormat::Int16) {
+            inPlace = encoding == parselib::AudioEncoding::PCM_16;
+        }
+        // the samples are accessed directly, so they must be naturally aligned
+        inPlace = inPlace
+                && reinterpret_cast<uintptr_t>(audioData) % getBytesPerSample(mSampleFormat) == 0;
+    }
+
+    if (!inPlace) {
+        loadSampleData(reader);
+        return;
+    }
+
+    mAudioProperties.channelCount = reader->getNumChannels();
+    mAudioProperties.sampleRate = reader->getSampleRate();
     mNumSamples = reader->getNumSampleFrames() * reader->getNumChannels();
-    mSampleData = new float[mNumSamples];
 
-    reader->getDataFloat(mSampleData, reader->getNumSampleFrames());
+    // The storage is never written to, resampleData() and CompressedSampleBuffer read it
+    // and replace it with their own.
+    if (mSampleFormat == SampleFormat::Float32) {
+        mSampleData = reinterpret_cast<float*>(const_cast<unsigned char*>(audioData));
+    } else {
+        mPackedData = reinterpret_cast<int16_t*>(const_cast<unsigned char*>(audioData));
+    }
+    mBackingStream = std::move(stream);
+    LOGD("referencing %d samples in place", mNumSamples);
+    buildPeaksFromStorage();
 }
 
     void SampleBuffer::loadRawSampleData(const int16_t* data, int32_t numSamples, int32_t numChannels, int32_t sampleRate) {
@@ -46,18 +92,169 @@ void SampleBuffer::loadSampleData(parselib::WavStreamReader* reader) {
         mAudioProperties.sampleRate = sampleRate;
         mNumSamples = numSamples * numChannels;
 
-        mSampleData = new float[mNumSamples];
-        for (int32_t i = 0; i < mNumSamples; ++i) {
-            mSampleData[i] = data[i] / 32768.0f; // Convert from int16_t to float
+        switch (mSampleFormat) {
+            case SampleFormat::Int16:
+                // already in the storage format, no conversion needed
+                mPackedData = new int16_t[mNumSamples];
+                memcpy(mPackedData, data, mNumSamples * sizeof(int16_t));
+                buildPeaksFromStorage();
+                break;
+
+            case SampleFormat::Float16: {
+                mPackedData = new int16_t[mNumSamples];
+                uint16_t* halfData = reinterpret_cast<uint16_t*>(mPackedData);
+                float block[kConversionBlockSamples];
+                mPeaks.begin(numChannels);
+                for (int32_t index = 0; index < mNumSamples; index += kConversionBlockSamples) {
+                    int32_t blockSamples = std::min(kConversionBlockSamples, mNumSamples - index);
+                    convertInt16ToFloat(data + index, block, blockSamples);
+                    mPeaks.accumulate(block, blockSamples);
+                    convertFloatToHalf(block, halfData + index, blockSamples);
+                }
+                mPeaks.finish();
+                break;
+            }
+
+            case SampleFormat::Float32:
+            default:
+                mSampleData = new float[mNumSamples];
+                convertInt16ToFloat(data, mSampleData, mNumSamples);
+                buildPeaksFromStorage();
+                break;
         }
     }
 
+bool SampleBuffer::loadFloatSampleData(int32_t numSamples, int32_t numChannels, int32_t sampleRate,
+                                       const std::function<int32_t(float* data)>& decode) {
+    mAudioProperties.channelCount = numChannels;
+    mAudioProperties.sampleRate = sampleRate;
+
+    float* data = new float[numSamples];
+    int32_t numDecoded = decode(data);
+    if (numDecoded < 0) {
+        delete[] data;
+        mNumSamples = 0;
+        return false;
+    }
+    storeFloatData(data, std::min(numDecoded, numSamples));
+    return true;
+}
+
 void SampleBuffer::unloadSampleData() {
+    releaseSampleStorage();
+    mNumSamples = 0;
+    mPeaks.clear();
+}
+
+void SampleBuffer::releaseSampleStorage() {
+    if (mBackingStream != nullptr) {
+        // not ours to delete
+        mSampleData = nullptr;
+        mPackedData = nullptr;
+        mBackingStream.reset();
+        return;
+    }
     if (mSampleData != nullptr) {
         delete[] mSampleData;
         mSampleData = nullptr;
     }
-    mNumSamples = 0;
+    if (mPackedData != nullptr) {
+        delete[] mPackedData;
+        mPackedData = nullptr;
+    }
+}
+
+void SampleBuffer::storeFloatData(float* data, int32_t numSamples) {
+    mNumSamples = numSamples;
+    mPeaks.begin(mAudioProperties.channelCount);
+    switch (mSampleFormat) {
+        case SampleFormat::Int16:
+            // peaks & conversion block by block, while the block is in the cache
+            mPackedData = new int16_t[numSamples];
+            for (int32_t index = 0; index < numSamples; index += kConversionBlockSamples) {
+                int32_t blockSamples = std::min(kConversionBlockSamples, numSamples - index);
+                mPeaks.accumulate(data + index, blockSamples);
+                convertFloatToInt16(data + index, mPackedData + index, blockSamples);
+            }
+            delete[] data;
+            break;
+
+        case SampleFormat::Float16: {
+            mPackedData = new int16_t[numSamples];
+            uint16_t* halfData = reinterpret_cast<uint16_t*>(mPackedData);
+            for (int32_t index = 0; index < numSamples; index += kConversionBlockSamples) {
+                int32_t blockSamples = std::min(kConversionBlockSamples, numSamples - index);
+                mPeaks.accumulate(data + index, blockSamples);
+                convertFloatToHalf(data + index, halfData + index, blockSamples);
+            }
+            delete[] data;
+            break;
+        }
+
+        case SampleFormat::Float32:
+        default:
+            mSampleData = data;
+            mPeaks.accumulate(data, numSamples);
+            break;
+    }
+    mPeaks.finish();
+}
+
+void SampleBuffer::buildPeaksFromStorage() {
+    float block[kConversionBlockSamples];
+    mPeaks.begin(mAudioProperties.channelCount);
+    for (int32_t index = 0; index < mNumSamples; index += kConversionBlockSamples) {
+        int32_t blockSamples = std::min(kConversionBlockSamples, mNumSamples - index);
+        mPeaks.accumulate(readFloatData(index, blockSamples, block), blockSamples);
+    }
+    mPeaks.finish();
+}
+
+float* SampleBuffer::unpackToFloat() const {
+    float* data = new float[mNumSamples];
+    if (mSampleFormat == SampleFormat::Float32) {
+        memcpy(data, mSampleData, mNumSamples * sizeof(float));
+    } else {
+        readFloatData(0, mNumSamples, data);
+    }
+    return data;
+}
+
+const float* SampleBuffer::getFloatData(int32_t sampleIndex, int32_t numSamples, float* scratch) const {
+    switch (mSampleFormat) {
+        case SampleFormat::Int16:
+            convertInt16ToFloat(mPackedData + sampleIndex, scratch, numSamples);
+            return scratch;
+
+        case SampleFormat::Float16:
+            convertHalfToFloat(reinterpret_cast<const uint16_t*>(mPackedData) + sampleIndex,
+                               scratch, numSamples);
+            return scratch;
+
+        case SampleFormat::Float32:
+        default:
+            return mSampleData + sampleIndex;
+    }
+}
+
+const float* SampleBuffer::readFloatData(int32_t sampleIndex, int32_t numSamples, float* scratch) const {
+    // plain storage has no playback state
+    return SampleBuffer::getFloatData(sampleIndex, numSamples, scratch);
+}
+
+const void* SampleBuffer::getStorageRange(int32_t sampleIndex, int32_t numSamples, size_t* numBytes) const {
+    int32_t start = std::max(sampleIndex, 0);
+    int32_t end = std::min(sampleIndex + numSamples, mNumSamples);
+    if (end <= start) {
+        *numBytes = 0;
+        return nullptr;
+    }
+    size_t bytesPerSample = getBytesPerSample(mSampleFormat);
+    *numBytes = (end - start) * bytesPerSample;
+    const uint8_t* storage = (mSampleFormat == SampleFormat::Float32)
+            ? reinterpret_cast<const uint8_t*>(mSampleData)
+            : reinterpret_cast<const uint8_t*>(mPackedData);
+    return storage + start * bytesPerSample;
 }
 
 class ResampleBlock {
@@ -113,8 +310,11 @@ void SampleBuffer::resampleData(int sampleRate) {
     }
     LOGD("+++ resampleData: %d, sampleRate %d", mAudioProperties.sampleRate, sampleRate);
 
+    // the resampler works on float, so expand 16-bit storage for the duration of the conversion
+    float* inputSamples = (mSampleFormat == SampleFormat::Float32) ? mSampleData : unpackToFloat();
+
     ResampleBlock inputBlock;
-    inputBlock.mBuffer = mSampleData;
+    inputBlock.mBuffer = inputSamples;
     inputBlock.mNumSamples = mNumSamples;
     inputBlock.mSampleRate = mAudioProperties.sampleRate;
 
@@ -123,11 +323,13 @@ void SampleBuffer::resampleData(int sampleRate) {
     iolib::resampleData(inputBlock, &outputBlock, mAudioProperties.channelCount);
 
     // delete previous samples
-    delete[] mSampleData;
+    if (inputSamples != mSampleData) {
+        delete[] inputSamples;
+    }
+    unloadSampleData();
 
     // install the resampled data
-    mSampleData = outputBlock.mBuffer;
-    mNumSamples = outputBlock.mNumSamples;
+    storeFloatData(outputBlock.mBuffer, outputBlock.mNumSamples);
     mAudioProperties.sampleRate = outputBlock.mSampleRate;
 }
 
@@ -17,8 +17,15 @@
 #ifndef _PLAYER_SAMPLEBUFFER_
 #define _PLAYER_SAMPLEBUFFER_
 
+#include <functional>
+#include <memory>
+
+#include <stream/InputStream.h>
 #include <wav/WavStreamReader.h>
 
+#include "PeakPyramid.h"
+#include "SampleFormat.h"
+
 namespace iolib {
 
 /*
@@ -31,29 +38,92 @@ struct AudioProperties {
 
 class SampleBuffer {
 public:
-    SampleBuffer() : mNumSamples(0) {};
-    ~SampleBuffer() { unloadSampleData(); }
+    explicit SampleBuffer(SampleFormat format = SampleFormat::Float32)
+        : mSampleFormat(format), mSampleData(nullptr), mPackedData(nullptr), mNumSamples(0) {};
+    virtual ~SampleBuffer() { unloadSampleData(); }
 
     // Data load/unload
     void loadSampleData(parselib::WavStreamReader* reader);
+    /**
+     * Loads from a reader over a memory backed stream (e.g. a parselib::MappedInputStream).
+     * If the WAV encoding is the storage format (float32 WAV into Float32, 16-bit WAV into
+     * Int16) the samples are referenced in place and the stream is kept alive for as long as
+     * the data is in use, otherwise they are converted as by loadSampleData(reader).
+     */
+    void loadSampleData(parselib::WavStreamReader* reader, std::shared_ptr<parselib::InputStream> stream);
     void loadRawSampleData(const int16_t* data, int32_t numSamples, int32_t numChannels, int32_t sampleRate);
+    /**
+     * Loads the output of a decoder that produces float samples. decode(data) is called with
+     * room for numSamples samples and returns how many it wrote (negative on failure).
+     * For Float32 storage data is the final sample storage, so nothing is copied or converted
+     * after decoding. Returns false if decode() failed.
+     */
+    bool loadFloatSampleData(int32_t numSamples, int32_t numChannels, int32_t sampleRate,
+                             const std::function<int32_t(float* data)>& decode);
     void unloadSampleData();
 
-    void resampleData(int sampleRate);
+    virtual void resampleData(int sampleRate);
 
     virtual AudioProperties getProperties() const { return mAudioProperties; }
 
+    SampleFormat getSampleFormat() const { return mSampleFormat; }
+    virtual size_t getStorageSizeInBytes() const { return mNumSamples * getBytesPerSample(mSampleFormat); }
+
+    // Only valid for SampleFormat::Float32, use getFloatData() for any format
     float* getSampleData() { return mSampleData; }
     int32_t getNumSamples() { return mNumSamples; }
 
+    /**
+     * Returns numSamples float samples starting at sampleIndex.
+     * For Float32 storage this points straight into the buffer, otherwise the samples are
+     * converted into scratch (which must hold numSamples floats) and scratch is returned.
+     */
+    virtual const float* getFloatData(int32_t sampleIndex, int32_t numSamples, float* scratch) const;
+
+    /**
+     * Same as getFloatData(), for readers other than the playback of this buffer (analysis,
+     * display). Safe to call from any thread while the buffer plays, and leaves the playback
+     * state alone (e.g. the decode-ahead position of a CompressedSampleBuffer).
+     */
+    virtual const float* readFloatData(int32_t sampleIndex, int32_t numSamples, float* scratch) const;
+
+    /**
+     * Returns the memory that stores samples [sampleIndex, sampleIndex + numSamples) and its
+     * length in numBytes (clipped to the buffer). Used to keep the playback window resident.
+     */
+    virtual const void* getStorageRange(int32_t sampleIndex, int32_t numSamples, size_t* numBytes) const;
+
     int32_t getSampleRate() const { return mAudioProperties.sampleRate; }
     int32_t getChannelCount() const { return mAudioProperties.channelCount; }
 
+    // true if the samples live in the memory of the stream they were loaded from
+    bool isReferencingStream() const { return mBackingStream != nullptr; }
+
+    // Waveform summary, built while the samples are loaded (and again when resampled)
+    const PeakPyramid& getPeaks() const { return mPeaks; }
+
 protected:
+    // Frees (or lets go of referenced) sample storage, keeps mNumSamples
+    void releaseSampleStorage();
+    // Takes ownership of a float buffer and stores it in mSampleFormat
+    void storeFloatData(float* data, int32_t numSamples);
+    // Returns the whole buffer as newly allocated float data (caller deletes)
+    float* unpackToFloat() const;
+    // Builds mPeaks from the stored samples, for data that never passes storeFloatData()
+    void buildPeaksFromStorage();
+
     AudioProperties mAudioProperties;
 
-    float*  mSampleData;
-    int32_t mNumSamples;
+    SampleFormat mSampleFormat;
+
+    float*   mSampleData;   // Float32 storage
+    int16_t* mPackedData;   // Int16 / Float16 storage (Float16 holds raw half bits)
+    int32_t  mNumSamples;
+
+    // Set while mSampleData/mPackedData point into the memory of this stream (read only)
+    std::shared_ptr<parselib::InputStream> mBackingStream;
+
+    PeakPyramid mPeaks;
 };
 
 }
@@ -0,0 +1,213 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cmath>
+#include <cstring>
+
+#include "SampleFormat.h"
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define SAMPLEFORMAT_USE_NEON
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define SAMPLEFORMAT_USE_SSE2
+#if defined(__F16C__)
+#include <immintrin.h>
+#endif
+#endif
+
+namespace iolib {
+
+// int16 <-> float uses the same scaling as the original MP3 load path (x / 32768)
+static constexpr float kInt16ToFloat = 1.0f / 32768.0f;
+static constexpr float kFloatToInt16 = 32768.0f;
+
+size_t getBytesPerSample(SampleFormat format) {
+    switch (format) {
+        case SampleFormat::Int16:
+        case SampleFormat::Float16:
+            return sizeof(int16_t);
+        case SampleFormat::Float32:
+        default:
+            return sizeof(float);
+    }
+}
+
+static inline int16_t floatToInt16(float value) {
+    float scaled = value * kFloatToInt16;
+    if (scaled > 32767.0f) {
+        return 32767;
+    } else if (scaled < -32768.0f) {
+        return -32768;
+    }
+    return static_cast<int16_t>(lrintf(scaled));
+}
+
+// IEEE 754 half <-> single conversions (round to nearest even), see
+// https://fgiesen.wordpress.com/2012/03/28/half-to-float-done-quic/
+static inline float halfToFloat(uint16_t half) {
+    static const uint32_t kMagic = 113u << 23;
+    static const uint32_t kShiftedExponent = 0x7C00u << 13;
+
+    uint32_t bits = (half & 0x7FFFu) << 13;
+    uint32_t exponent = kShiftedExponent & bits;
+    bits += (127u - 15u) << 23;
+    if (exponent == kShiftedExponent) {
+        // Inf/NaN
+        bits += (128u - 16u) << 23;
+    } else if (exponent == 0) {
+        // Zero/subnormal, renormalize through the FPU
+        float magic;
+        float value;
+        bits += 1u << 23;
+        memcpy(&magic, &kMagic, sizeof(float));
+        memcpy(&value, &bits, sizeof(float));
+        value -= magic;
+        memcpy(&bits, &value, sizeof(float));
+    }
+    bits |= static_cast<uint32_t>(half & 0x8000u) << 16;
+
+    float result;
+    memcpy(&result, &bits, sizeof(float));
+    return result;
+}
+
+static inline uint16_t floatToHalf(float value) {
+    static const uint32_t kSingleInfinity = 255u << 23;
+    static const uint32_t kHalfMax = (127u + 16u) << 23;
+    static const uint32_t kSubnormalMagic = ((127u - 15u) + (23u - 10u) + 1u) << 23;
+
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(float));
+    uint32_t sign = bits & 0x80000000u;
+    bits ^= sign;
+
+    uint16_t half;
+    if (bits >= kHalfMax) {
+        // Overflow to Inf, keep NaN a NaN
+        half = (bits > kSingleInfinity) ? 0x7E00u : 0x7C00u;
+    } else if (bits < (113u << 23)) {
+        // Result is a subnormal or zero, let the FPU do the rounding
+        float magic;
+        float absValue;
+        memcpy(&magic, &kSubnormalMagic, sizeof(float));
+        memcpy(&absValue, &bits, sizeof(float));
+        absValue += magic;
+        memcpy(&bits, &absValue, sizeof(float));
+        half = static_cast<uint16_t>(bits - kSubnormalMagic);
+    } else {
+        uint32_t mantissaOdd = (bits >> 13) & 1u;
+        bits += ((15u - 127u) << 23) + 0xFFFu;
+        bits += mantissaOdd;
+        half = static_cast<uint16_t>(bits >> 13);
+    }
+    return half | static_cast<uint16_t>(sign >> 16);
+}
+
+void convertInt16ToFloat(const int16_t* src, float* dst, int32_t numSamples) {
+    int32_t index = 0;
+#if defined(SAMPLEFORMAT_USE_NEON)
+    for (; index + 8 <= numSamples; index += 8) {
+        int16x8_t samples = vld1q_s16(src + index);
+        int32x4_t low = vmovl_s16(vget_low_s16(samples));
+        int32x4_t high = vmovl_s16(vget_high_s16(samples));
+        vst1q_f32(dst + index, vmulq_n_f32(vcvtq_f32_s32(low), kInt16ToFloat));
+        vst1q_f32(dst + index + 4, vmulq_n_f32(vcvtq_f32_s32(high), kInt16ToFloat));
+    }
+#elif defined(SAMPLEFORMAT_USE_SSE2)
+    const __m128 scale = _mm_set1_ps(kInt16ToFloat);
+    for (; index + 8 <= numSamples; index += 8) {
+        __m128i samples = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + index));
+        // sign-extend by placing each sample in the upper half and shifting back down
+        __m128i low = _mm_srai_epi32(_mm_unpacklo_epi16(samples, samples), 16);
+        __m128i high = _mm_srai_epi32(_mm_unpackhi_epi16(samples, samples), 16);
+        _mm_storeu_ps(dst + index, _mm_mul_ps(_mm_cvtepi32_ps(low), scale));
+        _mm_storeu_ps(dst + index + 4, _mm_mul_ps(_mm_cvtepi32_ps(high), scale));
+    }
+#endif
+    for (; index < numSamples; index++) {
+        dst[index] = src[index] * kInt16ToFloat;
+    }
+}
+
+void convertFloatToInt16(const float* src, int16_t* dst, int32_t numSamples) {
+    int32_t index = 0;
+#if defined(SAMPLEFORMAT_USE_NEON) && defined(__aarch64__)
+    const float32x4_t maxValue = vdupq_n_f32(32767.0f);
+    const float32x4_t minValue = vdupq_n_f32(-32768.0f);
+    for (; index + 8 <= numSamples; index += 8) {
+        float32x4_t low = vmulq_n_f32(vld1q_f32(src + index), kFloatToInt16);
+        float32x4_t high = vmulq_n_f32(vld1q_f32(src + index + 4), kFloatToInt16);
+        low = vmaxq_f32(vminq_f32(low, maxValue), minValue);
+        high = vmaxq_f32(vminq_f32(high, maxValue), minValue);
+        int16x4_t lowShort = vqmovn_s32(vcvtnq_s32_f32(low));
+        int16x4_t highShort = vqmovn_s32(vcvtnq_s32_f32(high));
+        vst1q_s16(dst + index, vcombine_s16(lowShort, highShort));
+    }
+#elif defined(SAMPLEFORMAT_USE_SSE2)
+    const __m128 scale = _mm_set1_ps(kFloatToInt16);
+    const __m128 maxValue = _mm_set1_ps(32767.0f);
+    const __m128 minValue = _mm_set1_ps(-32768.0f);
+    for (; index + 8 <= numSamples; index += 8) {
+        __m128 low = _mm_mul_ps(_mm_loadu_ps(src + index), scale);
+        __m128 high = _mm_mul_ps(_mm_loadu_ps(src + index + 4), scale);
+        low = _mm_max_ps(_mm_min_ps(low, maxValue), minValue);
+        high = _mm_max_ps(_mm_min_ps(high, maxValue), minValue);
+        __m128i packed = _mm_packs_epi32(_mm_cvtps_epi32(low), _mm_cvtps_epi32(high));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + index), packed);
+    }
+#endif
+    for (; index < numSamples; index++) {
+        dst[index] = floatToInt16(src[index]);
+    }
+}
+
+void convertHalfToFloat(const uint16_t* src, float* dst, int32_t numSamples) {
+    int32_t index = 0;
+#if defined(SAMPLEFORMAT_USE_NEON) && defined(__aarch64__)
+    for (; index + 4 <= numSamples; index += 4) {
+        float16x4_t halves = vreinterpret_f16_u16(vld1_u16(src + index));
+        vst1q_f32(dst + index, vcvt_f32_f16(halves));
+    }
+#elif defined(SAMPLEFORMAT_USE_SSE2) && defined(__F16C__)
+    for (; index + 8 <= numSamples; index += 8) {
+        __m128i halves = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + index));
+        _mm256_storeu_ps(dst + index, _mm256_cvtph_ps(halves));
+    }
+#endif
+    for (; index < numSamples; index++) {
+        dst[index] = halfToFloat(src[index]);
+    }
+}
+
+void convertFloatToHalf(const float* src, uint16_t* dst, int32_t numSamples) {
+    int32_t index = 0;
+#if defined(SAMPLEFORMAT_USE_NEON) && defined(__aarch64__)
+    for (; index + 4 <= numSamples; index += 4) {
+        float16x4_t halves = vcvt_f16_f32(vld1q_f32(src + index));
+        vst1_u16(dst + index, vreinterpret_u16_f16(halves));
+    }
+#elif defined(SAMPLEFORMAT_USE_SSE2) && defined(__F16C__)
+    for (; index + 8 <= numSamples; index += 8) {
+        __m128i halves = _mm256_cvtps_ph(_mm256_loadu_ps(src + index), _MM_FROUND_TO_NEAREST_INT);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + index), halves);
+    }
+#endif
+    for (; index < numSamples; index++) {
+        dst[index] = floatToHalf(src[index]);
+    }
+}
+
+} // namespace iolib
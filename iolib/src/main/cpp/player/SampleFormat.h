@@ -0,0 +1,52 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _PLAYER_SAMPLEFORMAT_
+#define _PLAYER_SAMPLEFORMAT_
+
+#include <cstdint>
+#include <cstddef>
+
+namespace iolib {
+
+/*
+ * In-memory storage format of the sample data held by a SampleBuffer.
+ * Float32 is handed to SoundTouch as-is, the 16-bit formats halve the resident
+ * size and are converted to float block-by-block as they are played.
+ * The values are shared with the Java side (PlayerViewModel), do not reorder.
+ */
+enum class SampleFormat : int32_t {
+    Float32 = 0,
+    Int16 = 1,
+    Float16 = 2
+};
+
+/*
+ * Returns the number of bytes one sample occupies in the given storage format.
+ */
+size_t getBytesPerSample(SampleFormat format);
+
+/*
+ * Block conversion kernels between the storage formats and float.
+ * Vectorized with NEON on ARM and SSE2 on x86, scalar everywhere else.
+ * Float16 samples are passed around as their raw IEEE 754 half bit patterns.
+ */
+void convertInt16ToFloat(const int16_t* src, float* dst, int32_t numSamples);
+void convertFloatToInt16(const float* src, int16_t* dst, int32_t numSamples);
+void convertHalfToFloat(const uint16_t* src, float* dst, int32_t numSamples);
+void convertFloatToHalf(const float* src, uint16_t* dst, int32_t numSamples);
+
+} // namespace iolib
+
+#endif //_PLAYER_SAMPLEFORMAT_
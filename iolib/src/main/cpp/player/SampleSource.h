@@ -17,12 +17,17 @@
 #ifndef _PLAYER_SAMPLESOURCE_
 #define _PLAYER_SAMPLESOURCE_
 
+#include <algorithm>
+#include <atomic>
+#include <cmath>
 #include <cstdint>
+#include <vector>
 #include <android/log.h> // Include the Android logging header
 
 #include "DataSource.h"
 
 #include "SampleBuffer.h"
+#include "StretchProfile.h"
 
 #include "SoundTouch.h"
 
@@ -46,10 +51,20 @@ public:
     soundtouch::SoundTouch mSoundTouch;
 
     SampleSource(SampleBuffer *sampleBuffer, float pan)
-     : mSampleBuffer(sampleBuffer), mCurSampleIndex(0), mIsPlaying(false), mGain(1.0f) {
+     : mSampleBuffer(sampleBuffer), mCurSampleIndex(0), mIsPlaying(false), mGain(1.0f),
+       mRequestedProfile(static_cast<int32_t>(StretchProfile::Default)),
+       mAppliedProfile(static_cast<int32_t>(StretchProfile::Default)),
+       mQualityLevel(static_cast<int32_t>(QualityLevel::Full)),
+       mMuted(false), mRenderMuted(false), mMutedFrames(0.0), mFadeGain(1.0f), mFadeStep(0.0f),
+       mFadeFrames(0) {
         setPan(pan);
         mSoundTouch.setSampleRate(mSampleBuffer->getSampleRate());
         mSoundTouch.setChannels(mSampleBuffer->getChannelCount());
+        // profiles are switched on the audio thread, see applyRequestedStretchProfile()
+        reserveStretchProfiles(mSoundTouch);
+        mSoundTouch.setSetting(SETTING_INTERPOLATION, kPolyphaseInterpolation);
+        mFullInterpolation = mSoundTouch.getSetting(SETTING_INTERPOLATION);
+        mConversionBuffer.resize(kConversionBufferFrames * mSampleBuffer->getChannelCount());
     }
     virtual ~SampleSource() {}
 
@@ -59,6 +74,72 @@ public:
 
     float currentPitch = 0.0f;
 
+    // Takes effect at the start of the next mixAudio(), on the audio thread
+    void setStretchProfile(StretchProfile profile) {
+        mRequestedProfile.store(static_cast<int32_t>(profile));
+    }
+
+    StretchProfile getStretchProfile() const {
+        return static_cast<StretchProfile>(mRequestedProfile.load());
+    }
+
+    // Audio thread only (QualityGovernor), applied to the running stretch without a restart
+    void setQualityLevel(QualityLevel level) {
+        mQualityLevel.store(static_cast<int32_t>(level));
+        applyStretchProfile(mSoundTouch, static_cast<StretchProfile>(mAppliedProfile), level,
+                            mFullInterpolation);
+    }
+
+    QualityLevel getQualityLevel() const {
+        return static_cast<QualityLevel>(mQualityLevel.load());
+    }
+
+    // Muted sources fade out, then skip SoundTouch & mixing, see advanceMuted()
+    void setMuted(bool muted) {
+        mMuted.store(muted);
+    }
+
+    bool isMuted() const {
+        return mMuted.load();
+    }
+
+    // Audio thread: unmuted but not processing yet, call unmute() before mixAudio()
+    bool isUnmuting() const {
+        return mRenderMuted && !mMuted.load(std::memory_order_relaxed);
+    }
+
+    // Audio thread: processing, so getPlayedFrameIndex() can serve as the reference
+    bool isRendering() const {
+        return mIsPlaying && !mRenderMuted;
+    }
+
+    // Input frame of the next output frame, i.e. the position that is heard
+    int32_t getPlayedFrameIndex() {
+        return mCurSampleIndex / mSampleBuffer->getChannelCount() - getPendingFrames();
+    }
+
+    // Audio thread: reference can be passed to unmute() to restart exactly in step with it
+    bool canAlignTo(const SampleSource& reference) const {
+        return mSoundTouch.isAlignableTo(reference.mSoundTouch);
+    }
+
+    /*
+     * Audio thread: restarts processing in step with reference, a source that kept rendering
+     * (or nullptr for the position advanced while muted), and fades in. With the same stretch
+     * settings as reference (canAlignTo()) the source picks up the splice positions of its
+     * SoundTouch, so both come out sample aligned. Otherwise it restarts at the played frame
+     * of reference, which is only as close as the splices of the two can be.
+     */
+    void unmute(SampleSource* reference) {
+        if (reference == nullptr) {
+            mSoundTouch.clear();
+        } else if (!alignTo(*reference)) {
+            setCurrentSampleIndex(reference->getPlayedFrameIndex() * mSampleBuffer->getChannelCount());
+        }
+        mRenderMuted = false;
+        startFade(0.0f, 1.0f, mSampleBuffer->getSampleRate() * kMuteFadeMs / 1000);
+    }
+
     void setPitchSemiTones(float pitch) {
         mSoundTouch.setPitchSemiTones(pitch);
     }
@@ -106,6 +187,10 @@ public:
         return mGain;
     }
 
+    // Gain & pan of the left and right output channels
+    float getLeftGain() const { return mLeftGain; }
+    float getRightGain() const { return mRightGain; }
+
     int32_t getCurrentSampleIndex() {
         return mCurSampleIndex;
     }
@@ -174,6 +259,134 @@ protected:
     // Overall gain
     float mGain;
 
+    // Scratch block for converting 16-bit sample storage to float before SoundTouch, allocated
+    // once so mixAudio() never allocates whatever the tempo or callback size
+    static constexpr int32_t kConversionBufferFrames = 4096;
+    std::vector<float> mConversionBuffer;
+
+    // Stretch profile set from the UI thread, and the one mSoundTouch currently runs with
+    std::atomic<int32_t> mRequestedProfile;
+    int32_t mAppliedProfile;
+
+    // Quality step of mSoundTouch, and its interpolation at QualityLevel::Full
+    std::atomic<int32_t> mQualityLevel;
+    int mFullInterpolation;
+
+    static constexpr int32_t kMuteFadeMs = 20;
+
+    // Mute state set from the UI thread, and the one mixAudio() acts on
+    std::atomic<bool> mMuted;
+    bool mRenderMuted;
+
+    // Fraction of an input frame not yet advanced while muted
+    double mMutedFrames;
+
+    // Mute fade, on top of mGain: mFadeGain moves by mFadeStep for mFadeFrames more frames
+    float mFadeGain;
+    float mFadeStep;
+    int32_t mFadeFrames;
+
+    void startFade(float from, float to, int32_t numFrames) {
+        numFrames = std::max(numFrames, 1);
+        mFadeGain = from;
+        mFadeStep = (to - from) / static_cast<float>(numFrames);
+        mFadeFrames = numFrames;
+    }
+
+    // Gain for the next output frame
+    float nextFadeGain() {
+        float gain = mFadeGain;
+        if (mFadeFrames > 0 && --mFadeFrames == 0) {
+            mFadeGain = mFadeStep > 0.0f ? 1.0f : 0.0f;
+        } else if (mFadeFrames > 0) {
+            mFadeGain += mFadeStep;
+        }
+        return gain;
+    }
+
+    // Feeds numFrames frames from mCurSampleIndex on to mSoundTouch, fetched as float in blocks
+    // that fit mConversionBuffer (16-bit storage is converted on the fly)
+    void putFrames(int32_t numFrames) {
+        int32_t channelCount = mSampleBuffer->getChannelCount();
+        for (int32_t frame = 0; frame < numFrames; frame += kConversionBufferFrames) {
+            int32_t blockFrames = std::min(kConversionBufferFrames, numFrames - frame);
+            const float* data = mSampleBuffer->getFloatData(mCurSampleIndex + frame * channelCount,
+                                                            blockFrames * channelCount,
+                                                            mConversionBuffer.data());
+            mSoundTouch.putSamples(data, blockFrames);
+        }
+    }
+
+    // Restarts mSoundTouch at the input position of reference, cutting the stream where it
+    // does, see SoundTouch::prepareAlignment(). False if that isn't possible.
+    bool alignTo(SampleSource& reference) {
+        int32_t channelCount = mSampleBuffer->getChannelCount();
+        int32_t endFrame = reference.mCurSampleIndex / reference.mSampleBuffer->getChannelCount();
+        int32_t numFrames = static_cast<int32_t>(mSoundTouch.prepareAlignment(reference.mSoundTouch));
+        int32_t startFrame = endFrame - numFrames;
+        if (numFrames == 0 || startFrame < 0 || endFrame * channelCount > mSampleBuffer->getNumSamples()) {
+            return false;
+        }
+        mCurSampleIndex = startFrame * channelCount;
+        putFrames(numFrames);
+        mCurSampleIndex = endFrame * channelCount;
+        return mSoundTouch.finishAlignment(reference.mSoundTouch);
+    }
+
+    // Input frames fed to SoundTouch ahead of the played position
+    int32_t getPendingFrames() {
+        return static_cast<int32_t>(std::lround(mSoundTouch.getPendingInputSamples()));
+    }
+
+    /*
+     * Call from mixAudio() before processing. Turns the fade around when the source was muted
+     * or unmuted while rendering. Returns true when it is muted and faded out: the position
+     * then moves on by the input frames numFrames output frames stand for, without
+     * processing or mixing anything.
+     */
+    bool advanceMuted(int32_t numFrames) {
+        if (!mRenderMuted) {
+            float target = mMuted.load(std::memory_order_relaxed) ? 0.0f : 1.0f;
+            float fadeEnd = mFadeFrames > 0 ? (mFadeStep < 0.0f ? 0.0f : 1.0f) : mFadeGain;
+            if (fadeEnd != target) {
+                startFade(mFadeGain, target, mSampleBuffer->getSampleRate() * kMuteFadeMs / 1000);
+            }
+            return false;
+        }
+        int32_t channelCount = mSampleBuffer->getChannelCount();
+        mMutedFrames += numFrames / mSoundTouch.getInputOutputSampleRatio();
+        int32_t frames = static_cast<int32_t>(mMutedFrames);
+        mMutedFrames -= frames;
+        mCurSampleIndex += frames * channelCount;
+        if (mCurSampleIndex >= mSampleBuffer->getNumSamples()) {
+            mCurSampleIndex = mSampleBuffer->getNumSamples();
+            mIsPlaying = false;
+        }
+        return true;
+    }
+
+    // Call at the end of mixAudio(): once faded out, drops what SoundTouch holds so the
+    // position is the played one for advanceMuted()
+    void finishMute() {
+        if (mMuted.load(std::memory_order_relaxed) && !mRenderMuted && mFadeGain <= 0.0f) {
+            setCurrentSampleIndex(mCurSampleIndex - getPendingFrames() * mSampleBuffer->getChannelCount());
+            mRenderMuted = true;
+            mMutedFrames = 0.0;
+        }
+    }
+
+    // Call from mixAudio() before feeding SoundTouch. Rewinds to the input position of the
+    // next output frame, so the stem restarts with the new settings without a jump.
+    void applyRequestedStretchProfile() {
+        int32_t requested = mRequestedProfile.load(std::memory_order_relaxed);
+        if (requested == mAppliedProfile) {
+            return;
+        }
+        setCurrentSampleIndex(mCurSampleIndex - getPendingFrames() * mSampleBuffer->getChannelCount());
+        applyStretchProfile(mSoundTouch, static_cast<StretchProfile>(requested),
+                            getQualityLevel(), mFullInterpolation);
+        mAppliedProfile = requested;
+    }
 
 private:
     void calcGainFactors() {
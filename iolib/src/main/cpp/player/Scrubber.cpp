@@ -0,0 +1,194 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <cmath>
+
+#include "Scrubber.h"
+
+namespace iolib {
+
+// The read head runs at the speed that would reach the target in kFollowMs, changing speed
+// over about kSmoothMs. Targets further than kSnapMs are jumped to.
+static constexpr int32_t kFollowMs = 60;
+static constexpr int32_t kSmoothMs = 30;
+static constexpr int32_t kSnapMs = 250;
+
+// Fade of the grains after end()
+static constexpr int32_t kEndFadeMs = 20;
+
+Scrubber::Scrubber() : mActive(false), mGeneration(0), mTargetSeconds(0.0f) {
+    // periodic Hann, grains half a grain apart add up to 1
+    for (int32_t index = 0; index < kGrainFrames; index++) {
+        mWindow[index] = 0.5f - 0.5f * static_cast<float>(std::cos(2.0 * M_PI * index / kGrainFrames));
+    }
+}
+
+void Scrubber::begin(float targetSeconds) {
+    mTargetSeconds.store(targetSeconds, std::memory_order_relaxed);
+    mGeneration.fetch_add(1, std::memory_order_release);
+    mActive.store(true, std::memory_order_release);
+}
+
+void Scrubber::update(int32_t sampleRate) {
+    mJustStarted = false;
+    bool active = mActive.load(std::memory_order_acquire);
+    uint32_t generation = mGeneration.load(std::memory_order_acquire);
+    if (active && (mState != State::Scrubbing || generation != mSeenGeneration)) {
+        mJustStarted = mState != State::Scrubbing;
+        mSeenGeneration = generation;
+        mSampleRate = sampleRate;
+        mPosition = std::max(0.0, static_cast<double>(mTargetSeconds.load(std::memory_order_relaxed)) * sampleRate);
+        mVelocity = 0.0;
+        for (Grain& grain : mGrains) {
+            grain.active = false;
+        }
+        mFramesToHop = 0;
+        mState = State::Scrubbing;
+    } else if (!active && mState == State::Scrubbing) {
+        mFadeFrames = std::max(1, sampleRate * kEndFadeMs / 1000);
+        mFadeFramesLeft = mFadeFrames;
+        mState = State::FadingOut;
+    }
+}
+
+void Scrubber::follow(int32_t numFrames) {
+    double target = static_cast<double>(mTargetSeconds.load(std::memory_order_relaxed)) * mSampleRate;
+    double distance = target - mPosition;
+    if (std::fabs(distance) > static_cast<double>(mSampleRate) * kSnapMs / 1000) {
+        // too far to catch up with audibly, play at the target at normal speed instead
+        mPosition = target;
+        mVelocity = 0.0;
+        return;
+    }
+    double velocity = std::clamp(distance / (static_cast<double>(mSampleRate) * kFollowMs / 1000),
+                                 -kMaxRate, kMaxRate);
+    double smoothing = std::min(1.0, numFrames / (static_cast<double>(mSampleRate) * kSmoothMs / 1000));
+    mVelocity += smoothing * (velocity - mVelocity);
+    mPosition = std::max(0.0, mPosition + mVelocity * numFrames);
+}
+
+void Scrubber::startGrain() {
+    // the grain that just ended (or never started) takes over, centered on the read head
+    Grain& grain = mGrains[0].active ? mGrains[1] : mGrains[0];
+    // below normal speed forwards (and at a standstill) the grains play at normal speed,
+    // so there is always something recognizable to hear
+    grain.rate = mVelocity <= -1.0 ? mVelocity : std::max(mVelocity, 1.0);
+    grain.startFrame = mPosition - grain.rate * kHopFrames;
+    grain.phase = 0;
+    grain.active = true;
+}
+
+void Scrubber::render(float* outBuff, int32_t numChannels, int32_t numFrames,
+                      const std::vector<SampleSource*>& sources, const std::vector<SampleBuffer*>& buffers,
+                      int32_t numSources) {
+    while (numFrames > 0 && mState != State::Idle) {
+        if (mFramesToHop == 0) {
+            for (Grain& grain : mGrains) {
+                grain.active = grain.active && grain.phase < kGrainFrames;
+            }
+            if (mState == State::Scrubbing) {
+                startGrain();
+            }
+            mFramesToHop = kHopFrames;
+        }
+        // chunks never cross a hop, so no grain ends inside one
+        int32_t chunkFrames = std::min(std::min(numFrames, mFramesToHop), kChunkFrames);
+
+        float fadeGain = 1.0f;
+        float fadeStep = 0.0f;
+        if (mState == State::FadingOut) {
+            chunkFrames = std::min(chunkFrames, mFadeFramesLeft);
+            fadeGain = static_cast<float>(mFadeFramesLeft) / mFadeFrames;
+            fadeStep = -1.0f / mFadeFrames;
+        } else {
+            follow(chunkFrames);
+        }
+
+        for (int32_t index = 0; index < numSources; index++) {
+            if (sources[index]->isMuted()) {
+                continue;
+            }
+            for (const Grain& grain : mGrains) {
+                if (grain.active) {
+                    mixGrain(outBuff, numChannels, chunkFrames, grain, sources[index], buffers[index],
+                             fadeGain, fadeStep);
+                }
+            }
+        }
+
+        for (Grain& grain : mGrains) {
+            grain.phase += chunkFrames;
+        }
+        mFramesToHop -= chunkFrames;
+        if (mState == State::FadingOut) {
+            mFadeFramesLeft -= chunkFrames;
+            if (mFadeFramesLeft <= 0) {
+                mState = State::Idle;
+            }
+        }
+        outBuff += chunkFrames * numChannels;
+        numFrames -= chunkFrames;
+    }
+}
+
+void Scrubber::mixGrain(float* outBuff, int32_t numChannels, int32_t numFrames, const Grain& grain,
+                        SampleSource* source, SampleBuffer* buffer, float fadeGain, float fadeStep) {
+    int32_t sampleChannels = buffer->getChannelCount();
+    if (sampleChannels < 1 || sampleChannels > kMaxChannels) {
+        return;
+    }
+    int32_t lastFrame = buffer->getNumSamples() / sampleChannels - 1;
+
+    // input frames this chunk of the grain reads, clipped to the buffer
+    double startPosition = grain.startFrame + grain.phase * grain.rate;
+    double endPosition = startPosition + (numFrames - 1) * grain.rate;
+    int32_t firstFrame = static_cast<int32_t>(std::floor(std::min(startPosition, endPosition)));
+    int32_t endFrame = static_cast<int32_t>(std::floor(std::max(startPosition, endPosition))) + 1;
+    firstFrame = std::max(firstFrame, 0);
+    endFrame = std::min(endFrame, lastFrame);
+    if (endFrame < firstFrame) {
+        return;
+    }
+    const float* data = buffer->getFloatData(firstFrame * sampleChannels,
+                                             (endFrame - firstFrame + 1) * sampleChannels,
+                                             mScratch.data());
+
+    float gain = source->getGain();
+    float leftGain = source->getLeftGain();
+    float rightGain = source->getRightGain();
+    const float* window = mWindow.data() + grain.phase;
+    for (int32_t frameIndex = 0; frameIndex < numFrames; frameIndex++, fadeGain += fadeStep) {
+        double position = startPosition + frameIndex * grain.rate;
+        if (position < firstFrame || position > endFrame) {
+            continue;
+        }
+        int32_t frame = static_cast<int32_t>(position);
+        float fraction = static_cast<float>(position - frame);
+        const float* sample0 = data + (frame - firstFrame) * sampleChannels;
+        const float* sample1 = frame < endFrame ? sample0 + sampleChannels : sample0;
+        float weight = window[frameIndex] * fadeGain;
+
+        float left = sample0[0] + fraction * (sample1[0] - sample0[0]);
+        float right = sampleChannels == 2 ? sample0[1] + fraction * (sample1[1] - sample0[1]) : left;
+        if (numChannels == 1) {
+            outBuff[frameIndex] += (sampleChannels == 1 ? left * gain : left * leftGain + right * rightGain) * weight;
+        } else {
+            outBuff[frameIndex * numChannels] += left * leftGain * weight;
+            outBuff[frameIndex * numChannels + 1] += right * rightGain * weight;
+        }
+    }
+}
+
+} // namespace iolib
@@ -0,0 +1,115 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _PLAYER_SCRUBBER_
+#define _PLAYER_SCRUBBER_
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include "SampleBuffer.h"
+#include "SampleSource.h"
+
+namespace iolib {
+
+/*
+ * Makes the position audible while the seek bar is dragged. Instead of the normal playback
+ * it plays short Hann windowed grains (two at a time, half a grain apart) read straight from
+ * the SampleBuffers, bypassing SoundTouch. The grains start at a read head that follows the
+ * target like a tape: slow drags play at the speed of the drag (varispeed), a still target
+ * repeats the grain at its position at normal speed, and jumps too far to catch up with
+ * move the head right to the target.
+ *
+ * The UI thread only stores the target (atomics, no locks, no allocation), the audio
+ * thread does the rest on fixed-size storage. The normal playback fades out when scrubbing
+ * starts and the grains fade out when it ends, over the restarted playback.
+ */
+class Scrubber {
+public:
+    static constexpr int32_t kGrainFrames = 2048;    // ~43 ms at 48 kHz
+    static constexpr int32_t kHopFrames = kGrainFrames / 2;
+
+    Scrubber();
+
+    // UI thread
+    void begin(float targetSeconds);
+    void setTarget(float targetSeconds) { mTargetSeconds.store(targetSeconds, std::memory_order_relaxed); }
+    void end() { mActive.store(false, std::memory_order_release); }
+    bool isActive() const { return mActive.load(std::memory_order_acquire); }
+
+    // Audio thread, once per callback before the calls below: picks up begin() & end()
+    void update(int32_t sampleRate);
+    // Grains replace the normal playback
+    bool isScrubbing() const { return mState == State::Scrubbing; }
+    // Scrubbing started with this callback, the normal playback should fade out in it
+    bool hasJustStarted() const { return mJustStarted; }
+    // Grains to mix, while scrubbing and while they fade out after end()
+    bool isRendering() const { return mState != State::Idle; }
+    int32_t getPositionFrame() const { return static_cast<int32_t>(mPosition); }
+
+    // Audio thread: adds numFrames frames of grains of the unmuted sources to outBuff
+    void render(float* outBuff, int32_t numChannels, int32_t numFrames,
+                const std::vector<SampleSource*>& sources, const std::vector<SampleBuffer*>& buffers,
+                int32_t numSources);
+
+private:
+    enum class State {
+        Idle,
+        Scrubbing,
+        FadingOut
+    };
+
+    struct Grain {
+        double startFrame = 0.0;  // read position at phase 0
+        double rate = 1.0;        // input frames per output frame, negative plays backwards
+        int32_t phase = 0;
+        bool active = false;
+    };
+
+    // Output frames handled at a time, bounds the input frames a grain reads at once
+    static constexpr int32_t kChunkFrames = 256;
+    static constexpr double kMaxRate = 4.0;
+    static constexpr int32_t kMaxChannels = 2;
+
+    void follow(int32_t numFrames);
+    void startGrain();
+    void mixGrain(float* outBuff, int32_t numChannels, int32_t numFrames, const Grain& grain,
+                  SampleSource* source, SampleBuffer* buffer, float fadeGain, float fadeStep);
+
+    // UI thread -> audio thread
+    std::atomic<bool> mActive;
+    std::atomic<uint32_t> mGeneration;
+    std::atomic<float> mTargetSeconds;
+
+    // audio thread
+    State mState = State::Idle;
+    bool mJustStarted = false;
+    uint32_t mSeenGeneration = 0;
+    int32_t mSampleRate = 0;
+    double mPosition = 0.0;   // read head, in frames
+    double mVelocity = 0.0;   // read head frames per output frame
+    int32_t mFramesToHop = 0;
+    int32_t mFadeFrames = 0;
+    int32_t mFadeFramesLeft = 0;
+    std::array<Grain, 2> mGrains;
+
+    std::array<float, kGrainFrames> mWindow;
+    std::array<float, (static_cast<int32_t>(kChunkFrames * kMaxRate) + 2) * kMaxChannels> mScratch;
+};
+
+} // namespace iolib
+
+#endif //_PLAYER_SCRUBBER_
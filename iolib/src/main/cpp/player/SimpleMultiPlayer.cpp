@@ -15,6 +15,7 @@
  */
 
 #include <android/log.h>
+#include <sys/resource.h>
 
 // parselib includes
 #include <stream/MemInputStream.h>
@@ -24,6 +25,8 @@
 #include "OneShotSampleSource.h"
 #include "SimpleMultiPlayer.h"
 
+#include <BPMDetect.h>
+
 #include <atomic>
 #include <vector>
 #include <thread>
@@ -45,6 +48,8 @@ SimpleMultiPlayer::SimpleMultiPlayer()
 DataCallbackResult SimpleMultiPlayer::MyDataCallback::onAudioReady(AudioStream *oboeStream,
                                                                    void *audioData,
                                                                    int32_t numFrames) {
+    auto callbackStart = std::chrono::steady_clock::now();
+
 
     auto result = oboeStream->getXRunCount();
     if (result) { // Check if the result is successful
@@ -56,6 +61,15 @@ DataCallbackResult SimpleMultiPlayer::MyDataCallback::onAudioReady(AudioStream *
     }
 
 
+#ifdef PLAYER_COUNT_PAGE_FAULTS
+    // page faults taken on the audio thread (should stay flat), a syscall per callback so
+    // debug builds only. PlaybackWindow logs them from its own thread.
+    struct rusage usage;
+    if (getrusage(RUSAGE_THREAD, &usage) == 0) {
+        mParent->mPlaybackWindow.setAudioPageFaults(usage.ru_minflt, usage.ru_majflt);
+    }
+#endif
+
     StreamState streamState = oboeStream->getState();
     if (streamState != StreamState::Open && streamState != StreamState::Started) {
         __android_log_print(ANDROID_LOG_ERROR, TAG, "  streamState:%d", streamState);
@@ -89,13 +103,74 @@ DataCallbackResult SimpleMultiPlayer::MyDataCallback::onAudioReady(AudioStream *
     }
 
 
-    // OneShotSampleSource* sources = mSampleSources.get();
-    for(int32_t index = 0; index < mParent->mNumSampleBuffers; index++) {
-        if (mParent->mSampleSources[index]->isPlaying()) {
-            mParent->mSampleSources[index]->mixAudio((float*)audioData, mParent->mChannelCount, numFrames);
+    Scrubber& scrubber = mParent->mScrubber;
+    scrubber.update(mParent->mSampleRate);
+
+    if (scrubber.isScrubbing()) {
+        mParent->mPlaybackWindow.setPlayheadFrame(scrubber.getPositionFrame());
+    } else if (mParent->mNumSampleBuffers > 0) {
+        SampleSource* reference = mParent->mSampleSources[0];
+        mParent->mPlaybackWindow.setPlayheadFrame(
+                reference->getCurrentSampleIndex() / mParent->mSampleBuffers[0]->getChannelCount());
+    }
+
+    // Unmuted sources restart in step with one that kept playing, preferably one with the same
+    // stretch settings, which they can follow sample by sample
+    for (int32_t index = 0; index < mParent->mNumSampleBuffers; index++) {
+        SampleSource* source = mParent->mSampleSources[index];
+        if (!source->isPlaying() || !source->isUnmuting()) {
+            continue;
+        }
+        SampleSource* reference = nullptr;
+        for (int32_t other = 0; other < mParent->mNumSampleBuffers; other++) {
+            SampleSource* candidate = mParent->mSampleSources[other];
+            if (!candidate->isRendering()) {
+                continue;
+            }
+            if (source->canAlignTo(*candidate)) {
+                reference = candidate;
+                break;
+            }
+            if (reference == nullptr) {
+                reference = candidate;
+            }
+        }
+        source->unmute(reference);
+    }
+
+    // While scrubbing the sources hold their position, except in the callback that fades them out
+    if (!scrubber.isScrubbing() || scrubber.hasJustStarted()) {
+        // OneShotSampleSource* sources = mSampleSources.get();
+        for(int32_t index = 0; index < mParent->mNumSampleBuffers; index++) {
+            if (mParent->mSampleSources[index]->isPlaying()) {
+                auto mixStart = std::chrono::steady_clock::now();
+                mParent->mSampleSources[index]->mixAudio((float*)audioData, mParent->mChannelCount, numFrames);
+                mParent->mQualityGovernor.addSourceTime(index, std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::steady_clock::now() - mixStart).count());
+            }
         }
     }
 
+    if (scrubber.hasJustStarted()) {
+        float* samples = static_cast<float*>(audioData);
+        for (int32_t frameIndex = 0; frameIndex < numFrames; frameIndex++) {
+            float gain = 1.0f - static_cast<float>(frameIndex) / numFrames;
+            for (int32_t channel = 0; channel < mParent->mChannelCount; channel++) {
+                *samples++ *= gain;
+            }
+        }
+    }
+    if (scrubber.isRendering()) {
+        scrubber.render(static_cast<float*>(audioData), mParent->mChannelCount, numFrames,
+                        mParent->mSampleSources, mParent->mSampleBuffers, mParent->mNumSampleBuffers);
+    } else {
+        // the grains are cheap, their render time says nothing about the SoundTouch settings
+        mParent->mQualityGovernor.update(mParent->mSampleSources, mParent->mNumSampleBuffers,
+                                         std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                                 std::chrono::steady_clock::now() - callbackStart).count(),
+                                         numFrames, mParent->mSampleRate);
+    }
+
     if (mParent->mLatencyTuner) {
         mParent->mLatencyTuner->tune();
     }
@@ -212,16 +287,29 @@ void SimpleMultiPlayer::teardownAudioStream() {
 void SimpleMultiPlayer::addSampleSource(SampleSource* source, SampleBuffer* buffer) {
     __android_log_print(ANDROID_LOG_INFO, TAG, "+++ addSampleSource");
     buffer->resampleData(mSampleRate);
+    __android_log_print(ANDROID_LOG_INFO, TAG, "+++ addSampleSource %zu bytes resident",
+                        buffer->getStorageSizeInBytes());
+
+    StretchProfile profile = analyzeStretchProfile(*buffer);
+    source->setStretchProfile(profile);
+    __android_log_print(ANDROID_LOG_INFO, TAG, "+++ addSampleSource %s stretch profile",
+                        getStretchProfileName(profile));
 
     mSampleBuffers.push_back(buffer);
     mSampleSources.push_back(source);
+    mDetectedProfiles.push_back(profile);
+    mMuted.push_back(false);
+    mSoloed.push_back(false);
     mNumSampleBuffers++;
+    mQualityGovernor.reset();
+    mPlaybackWindow.addBuffer(buffer);
     __android_log_print(ANDROID_LOG_INFO, TAG, "+++ addSampleSource DONE");
 }
 
 void SimpleMultiPlayer::unloadSampleData() {
     __android_log_print(ANDROID_LOG_INFO, TAG, "unloadSampleData()");
     resetAll();
+    mPlaybackWindow.clear();
 
     for (int32_t bufferIndex = 0; bufferIndex < mNumSampleBuffers; bufferIndex++) {
         delete mSampleBuffers[bufferIndex];
@@ -230,6 +318,10 @@ void SimpleMultiPlayer::unloadSampleData() {
 
     mSampleBuffers.clear();
     mSampleSources.clear();
+    mDetectedProfiles.clear();
+    mMuted.clear();
+    mSoloed.clear();
+    mQualityGovernor.reset();
 
     mNumSampleBuffers = 0;
 }
@@ -395,6 +487,16 @@ float SimpleMultiPlayer::getCurrentTimeInSeconds(int index) {
         return mSampleSources[index]->getTotalLengthInSeconds();
     }
 
+    void SimpleMultiPlayer::setLoopRegion(float startSeconds, float endSeconds) {
+        if (startSeconds < 0.0f || endSeconds <= startSeconds || mNumSampleBuffers == 0) {
+            mPlaybackWindow.clearLoopRegion();
+            return;
+        }
+        int32_t sampleRate = mSampleBuffers[0]->getSampleRate();
+        mPlaybackWindow.setLoopRegion(static_cast<int32_t>(startSeconds * sampleRate),
+                                      static_cast<int32_t>(endSeconds * sampleRate));
+    }
+
     void SimpleMultiPlayer::setTempo(float tempo) {
         mCurrentTempo = tempo;
         for(int32_t index = 0; index < mNumSampleBuffers; index++) {
@@ -425,4 +527,126 @@ float SimpleMultiPlayer::getCurrentTimeInSeconds(int index) {
         mIgnorePitchIndexes = indexes;
     }
 
+    float SimpleMultiPlayer::detectTempo(int index, std::vector<float>* beats) {
+        beats->clear();
+        if (index < 0 || index >= mNumSampleBuffers) {
+            return 0.0f;
+        }
+        SampleBuffer* buffer = mSampleBuffers[index];
+        int32_t channelCount = buffer->getChannelCount();
+        int32_t numSamples = buffer->getNumSamples();
+        if (channelCount <= 0 || numSamples <= 0) {
+            return 0.0f;
+        }
+
+        // Float32 storage is analyzed in place. Not getFloatData(): this runs next to the audio
+        // callback, which must stay the only playback reader of the buffer
+        std::vector<float> scratch;
+        if (buffer->getSampleFormat() != SampleFormat::Float32 || buffer->getSampleData() == nullptr) {
+            scratch.resize(numSamples);
+        }
+        const float* data = buffer->readFloatData(0, numSamples, scratch.data());
+
+        auto start = std::chrono::steady_clock::now();
+        soundtouch::BPMDetect bpmDetect(channelCount, buffer->getSampleRate());
+        bpmDetect.analyze(data, numSamples / channelCount, 0);
+        float bpm = bpmDetect.getBpm();
+
+        int numBeats = bpmDetect.getBeats(nullptr, nullptr, 0);
+        std::vector<float> strengths(numBeats);
+        beats->resize(numBeats);
+        bpmDetect.getBeats(beats->data(), strengths.data(), numBeats);
+
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now() - start);
+        __android_log_print(ANDROID_LOG_INFO, TAG, "Tempo of source %d: %.2f BPM, %d beats in %lld ms",
+                            index, bpm, numBeats, static_cast<long long>(elapsed.count()));
+        return bpm;
+    }
+
+    void SimpleMultiPlayer::setStretchProfile(int index, int32_t profile) {
+        if (index < 0 || index >= mNumSampleBuffers) {
+            return;
+        }
+        StretchProfile stretchProfile = mDetectedProfiles[index];
+        if (profile >= static_cast<int32_t>(StretchProfile::Default) &&
+            profile <= static_cast<int32_t>(StretchProfile::Voice)) {
+            stretchProfile = static_cast<StretchProfile>(profile);
+        } else if (profile != kStretchProfileAuto) {
+            __android_log_print(ANDROID_LOG_ERROR, TAG, "Invalid stretch profile %d", profile);
+            return;
+        }
+        mSampleSources[index]->setStretchProfile(stretchProfile);
+        __android_log_print(ANDROID_LOG_INFO, TAG, "Stretch profile of source %d: %s",
+                            index, getStretchProfileName(stretchProfile));
+    }
+
+    void SimpleMultiPlayer::getPeaks(int index, float startSeconds, float endSeconds, int numBins,
+                                     std::vector<float>* peaks) {
+        peaks->assign(3 * std::max(numBins, 0), 0.0f);
+        if (index < 0 || index >= mNumSampleBuffers || numBins <= 0) {
+            return;
+        }
+        SampleBuffer* buffer = mSampleBuffers[index];
+        double sampleRate = buffer->getSampleRate();
+        buffer->getPeaks().query(startSeconds * sampleRate, endSeconds * sampleRate, numBins, peaks->data());
+    }
+
+    int32_t SimpleMultiPlayer::getStretchProfile(int index) {
+        if (index < 0 || index >= mNumSampleBuffers) {
+            return kStretchProfileAuto;
+        }
+        return static_cast<int32_t>(mSampleSources[index]->getStretchProfile());
+    }
+
+    int32_t SimpleMultiPlayer::getQualityLevel(int index) {
+        // polled by the UI, log what the governor did from here rather than from the audio thread
+        mQualityGovernor.logTransitions();
+        if (index < 0 || index >= mNumSampleBuffers) {
+            return static_cast<int32_t>(QualityLevel::Full);
+        }
+        return static_cast<int32_t>(mSampleSources[index]->getQualityLevel());
+    }
+
+    void SimpleMultiPlayer::setMute(int index, bool muted) {
+        if (index < 0 || index >= mNumSampleBuffers) {
+            return;
+        }
+        mMuted[index] = muted;
+        updateMutes();
+    }
+
+    void SimpleMultiPlayer::setSolo(int index, bool soloed) {
+        if (index < 0 || index >= mNumSampleBuffers) {
+            return;
+        }
+        mSoloed[index] = soloed;
+        updateMutes();
+    }
+
+    void SimpleMultiPlayer::beginScrub(float targetSeconds) {
+        mScrubber.begin(targetSeconds);
+        __android_log_print(ANDROID_LOG_INFO, TAG, "Scrubbing from %.2f s", targetSeconds);
+    }
+
+    void SimpleMultiPlayer::endScrub() {
+        mScrubber.end();
+        __android_log_print(ANDROID_LOG_INFO, TAG, "Scrubbing ended");
+    }
+
+    bool SimpleMultiPlayer::isMuted(int index) {
+        return index >= 0 && index < mNumSampleBuffers && mSampleSources[index]->isMuted();
+    }
+
+    void SimpleMultiPlayer::updateMutes() {
+        bool anySoloed = std::find(mSoloed.begin(), mSoloed.end(), true) != mSoloed.end();
+        for (int32_t index = 0; index < mNumSampleBuffers; index++) {
+            bool muted = mMuted[index] || (anySoloed && !mSoloed[index]);
+            if (muted != mSampleSources[index]->isMuted()) {
+                mSampleSources[index]->setMuted(muted);
+                __android_log_print(ANDROID_LOG_INFO, TAG, "Source %d %s", index, muted ? "muted" : "unmuted");
+            }
+        }
+    }
+
 }
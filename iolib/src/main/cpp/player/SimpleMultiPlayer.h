@@ -23,7 +23,11 @@
 #include <stdint.h>
 
 #include "OneShotSampleSource.h"
+#include "PlaybackWindow.h"
+#include "QualityGovernor.h"
 #include "SampleBuffer.h"
+#include "Scrubber.h"
+#include "StretchProfile.h"
 
 #include <SoundTouch.h>
 
@@ -60,6 +64,20 @@ public:
      */
     void unloadSampleData();
 
+    /**
+     * Storage format for SampleBuffers created for this session (see SampleFormat).
+     * Only affects buffers loaded after the call.
+     */
+    void setSampleFormat(SampleFormat format) { mSampleFormat = format; }
+    SampleFormat getSampleFormat() const { return mSampleFormat; }
+
+    /**
+     * If set, SampleBuffers for this session are created as CompressedSampleBuffers
+     * (lossless 16-bit blocks decoded ahead of the playhead) instead of plain SampleBuffers.
+     */
+    void setCompressSampleData(bool compress) { mCompressSampleData = compress; }
+    bool getCompressSampleData() const { return mCompressSampleData; }
+
     void triggerDown(int32_t index);
     void triggerUp(int32_t index);
 
@@ -80,6 +98,12 @@ public:
     void setCurrentTimeInSeconds(float newTime);
     float getTotalLengthInSeconds(int index);
 
+    /**
+     * Loop region (in seconds) whose start is kept resident next to the playhead,
+     * pass a negative value to clear it. See PlaybackWindow.
+     */
+    void setLoopRegion(float startSeconds, float endSeconds);
+
     float mCurrentTempo = 1.0f;
     float mCurrentPitch = 0.0f;
 
@@ -103,10 +127,64 @@ public:
     std::vector<int32_t> mIgnorePitchIndexes;
     void setIgnorePitchIndexes(const std::vector<int32_t>& indexes);
 
+    /**
+     * Detects the tempo of the whole SampleBuffer at index with soundtouch::BPMDetect::analyze(),
+     * on all cores. Returns the BPM (0 if detection failed) and the beat positions in seconds in
+     * beats. Buffers not stored as Float32 are converted to a temporary float copy first.
+     */
+    float detectTempo(int index, std::vector<float>* beats);
+
+    /**
+     * Waveform of the source at index between startSeconds and endSeconds, in numBins bins of
+     * [min, max, rms] written to peaks. Served from the buffer's PeakPyramid, so it costs the
+     * same at any zoom and can be called for every frame of a scroll or pinch.
+     */
+    void getPeaks(int index, float startSeconds, float endSeconds, int numBins, std::vector<float>* peaks);
+
+    /**
+     * Sets the StretchProfile of the source at index, kStretchProfileAuto goes back to the
+     * profile chosen by analyzeStretchProfile() when the source was added.
+     */
+    void setStretchProfile(int index, int32_t profile);
+    int32_t getStretchProfile(int index);
+    std::vector<StretchProfile> mDetectedProfiles;
+
+    /**
+     * Current QualityLevel of the source at index, lowered by mQualityGovernor while the
+     * callbacks are close to their deadline.
+     */
+    int32_t getQualityLevel(int index);
+    QualityGovernor mQualityGovernor;
+
+    /**
+     * Mute & solo. While any source is soloed only the soloed ones play, a muted source never
+     * plays. Silenced sources fade out and stop processing, they only keep their position
+     * and come back in sync with a short fade in. Unlike setGain(index, 0) they cost no CPU.
+     */
+    void setMute(int index, bool muted);
+    void setSolo(int index, bool soloed);
+    // Silenced by mute or by another source's solo
+    bool isMuted(int index);
+    std::vector<bool> mMuted;
+    std::vector<bool> mSoloed;
+
+    /**
+     * Scrubbing while the seek bar is dragged: between beginScrub() and endScrub() the sources
+     * are not played, the Scrubber plays grains around the target instead. setScrubTarget()
+     * only stores the position, call it on every drag update. Seek to the final position
+     * (setCurrentTimeInSeconds()) before endScrub() so playback resumes there.
+     */
+    void beginScrub(float targetSeconds);
+    void setScrubTarget(float targetSeconds) { mScrubber.setTarget(targetSeconds); }
+    void endScrub();
+    Scrubber mScrubber;
+
 // Sample Data
 int32_t mNumSampleBuffers;
     std::vector<SampleSource*>  mSampleSources;
 private:
+    void updateMutes();
+
     class MyDataCallback : public oboe::AudioStreamDataCallback {
     public:
         MyDataCallback(SimpleMultiPlayer *parent) : mParent(parent), mPreviousXRunCount(0) {}
@@ -143,6 +221,9 @@ private:
 
 
     std::vector<SampleBuffer*>  mSampleBuffers;
+    PlaybackWindow mPlaybackWindow;
+    SampleFormat mSampleFormat = SampleFormat::Float32;
+    bool mCompressSampleData = false;
 
     bool mOutputReset;
 
@@ -0,0 +1,187 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "StretchProfile.h"
+
+namespace iolib {
+
+// Envelope blocks of 10 ms, judged in windows of 0.5 s
+static constexpr int32_t kBlocksPerSecond = 100;
+static constexpr int32_t kBlocksPerWindow = 50;
+static constexpr int32_t kBlocksPerRead = 64;
+
+// Windows whose loudest block is below -60 dBFS are silence and don't count
+static constexpr float kSilentEnergy = 1e-6f;
+
+// Loudness peaks are the loudest block within 100 ms either side, at most 30 dB below the
+// loudest block of the stem. Their attack is the number of blocks before the peak that are
+// louder than -20 dB relative to it: drum hits rise from near silence within one block,
+// syllables take several and sustained notes start on top of the previous one.
+static constexpr int32_t kPeakRadiusBlocks = 10;
+static constexpr float kPeakFloor = 1e-3f;
+static constexpr float kAttackFloor = 1e-2f;
+static constexpr int32_t kPercussiveAttackBlocks = 2;
+
+// Peak-to-median loudness (dB) of a 0.5 s window below which a stem is evenly loud, tonal
+static constexpr float kTonalDepthDb = 8.0f;
+
+// Sequence, seek window & overlap (ms) of each profile, picked with soundtouch_quality_bench.
+// Percussive: least timing jitter and fewest lost hits on the drum loop. Tonal: lowest
+// spectral distortion on the sweep and the mix. Voice: SoundTouch's speech settings,
+// lowest distortion on the voice signal.
+struct StretchSettings {
+    int sequenceMs;
+    int seekWindowMs;
+    int overlapMs;
+};
+
+static const StretchSettings kProfileSettings[] = {
+    { 0, 0, 8 },        // Default (0 = automatic)
+    { 30, 8, 6 },       // Percussive
+    { 60, 15, 10 },     // Tonal
+    { 40, 15, 8 }       // Voice
+};
+
+const char* getStretchProfileName(StretchProfile profile) {
+    switch (profile) {
+        case StretchProfile::Percussive: return "percussive";
+        case StretchProfile::Tonal: return "tonal";
+        case StretchProfile::Voice: return "voice";
+        default: return "default";
+    }
+}
+
+const char* getQualityLevelName(QualityLevel level) {
+    switch (level) {
+        case QualityLevel::QuickSeek: return "quick seek";
+        case QualityLevel::ShortSeekWindow: return "short seek window";
+        case QualityLevel::LinearInterpolation: return "linear interpolation";
+        case QualityLevel::NoAntiAlias: return "no anti-alias filter";
+        default: return "full";
+    }
+}
+
+void applyStretchProfile(soundtouch::SoundTouch& soundTouch, StretchProfile profile,
+                         QualityLevel level, int fullInterpolation) {
+    const StretchSettings& settings = kProfileSettings[static_cast<int32_t>(profile)];
+    int seekWindowMs = settings.seekWindowMs;
+    if (level >= QualityLevel::ShortSeekWindow &&
+        (seekWindowMs == 0 || seekWindowMs > kShortSeekWindowMs)) {
+        seekWindowMs = kShortSeekWindowMs;
+    }
+    soundTouch.setSetting(SETTING_SEQUENCE_MS, settings.sequenceMs);
+    soundTouch.setSetting(SETTING_SEEKWINDOW_MS, seekWindowMs);
+    soundTouch.setSetting(SETTING_OVERLAP_MS, settings.overlapMs);
+    soundTouch.setSetting(SETTING_USE_QUICKSEEK, level >= QualityLevel::QuickSeek);
+
+    if (level >= QualityLevel::LinearInterpolation) {
+        soundTouch.setSetting(SETTING_INTERPOLATION, kLinearInterpolation);
+    } else if (fullInterpolation >= 0) {
+        soundTouch.setSetting(SETTING_INTERPOLATION, fullInterpolation);
+    }
+
+    // toggling the filter flushes the pitch shifter, only touch it on a change
+    int useAntiAlias = level < QualityLevel::NoAntiAlias;
+    if (soundTouch.getSetting(SETTING_USE_AA_FILTER) != useAntiAlias) {
+        soundTouch.setSetting(SETTING_USE_AA_FILTER, useAntiAlias);
+    }
+}
+
+void reserveStretchProfiles(soundtouch::SoundTouch& soundTouch) {
+    // SoundTouch only grows its overlap buffer and correlation work space
+    for (int32_t profile = static_cast<int32_t>(StretchProfile::Voice);
+         profile >= static_cast<int32_t>(StretchProfile::Default); profile--) {
+        applyStretchProfile(soundTouch, static_cast<StretchProfile>(profile));
+    }
+}
+
+StretchProfile analyzeStretchProfile(SampleBuffer& buffer) {
+    const int32_t channelCount = buffer.getChannelCount();
+    const int32_t sampleRate = buffer.getSampleRate();
+    if (channelCount <= 0 || sampleRate <= 0) {
+        return StretchProfile::Default;
+    }
+    const int32_t numFrames = buffer.getNumSamples() / channelCount;
+    const int32_t blockFrames = std::max(1, sampleRate / kBlocksPerSecond);
+    const int32_t numBlocks = numFrames / blockFrames;
+
+    // mean energy of the channel sum per block
+    std::vector<float> energies(numBlocks);
+    std::vector<float> scratch(static_cast<size_t>(kBlocksPerRead * blockFrames * channelCount));
+    for (int32_t block = 0; block < numBlocks; block += kBlocksPerRead) {
+        int32_t count = std::min(kBlocksPerRead, numBlocks - block);
+        const float* data = buffer.readFloatData(block * blockFrames * channelCount,
+                                                 count * blockFrames * channelCount, scratch.data());
+        for (int32_t i = 0; i < count; i++) {
+            float sum = 0.0f;
+            for (int32_t frame = 0; frame < blockFrames; frame++) {
+                float x = 0.0f;
+                for (int32_t channel = 0; channel < channelCount; channel++) {
+                    x += *data++;
+                }
+                sum += x * x;
+            }
+            energies[block + i] = sum / static_cast<float>(blockFrames * channelCount * channelCount);
+        }
+    }
+
+    // median attack of the loudness peaks
+    std::vector<int32_t> attacks;
+    const float loudest = numBlocks > 0 ? *std::max_element(energies.begin(), energies.end()) : 0.0f;
+    for (int32_t block = kPeakRadiusBlocks; block + kPeakRadiusBlocks < numBlocks; block++) {
+        const float energy = energies[block];
+        if (energy < loudest * kPeakFloor ||
+            *std::max_element(energies.begin() + block - kPeakRadiusBlocks,
+                              energies.begin() + block + kPeakRadiusBlocks + 1) > energy) {
+            continue;
+        }
+        int32_t attack = 0;
+        while (attack < kPeakRadiusBlocks && energies[block - attack - 1] > energy * kAttackFloor) {
+            attack++;
+        }
+        attacks.push_back(attack);
+    }
+
+    // peak-to-median depth of each window that isn't silent
+    std::vector<float> depths;
+    std::vector<float> window(kBlocksPerWindow);
+    for (int32_t start = 0; start + kBlocksPerWindow <= numBlocks; start += kBlocksPerWindow) {
+        std::copy(energies.begin() + start, energies.begin() + start + kBlocksPerWindow, window.begin());
+        float peak = *std::max_element(window.begin(), window.end());
+        if (peak < kSilentEnergy) {
+            continue;
+        }
+        std::nth_element(window.begin(), window.begin() + kBlocksPerWindow / 2, window.end());
+        float median = window[kBlocksPerWindow / 2];
+        depths.push_back(10.0f * std::log10(peak / (median + peak * 1e-6f)));
+    }
+    if (depths.empty()) {
+        return StretchProfile::Default;
+    }
+
+    if (!attacks.empty()) {
+        std::nth_element(attacks.begin(), attacks.begin() + attacks.size() / 2, attacks.end());
+        if (attacks[attacks.size() / 2] <= kPercussiveAttackBlocks) {
+            return StretchProfile::Percussive;
+        }
+    }
+    std::nth_element(depths.begin(), depths.begin() + depths.size() / 2, depths.end());
+    return depths[depths.size() / 2] <= kTonalDepthDb ? StretchProfile::Tonal : StretchProfile::Voice;
+}
+
+} // namespace iolib
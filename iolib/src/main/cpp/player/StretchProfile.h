@@ -0,0 +1,95 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _PLAYER_STRETCHPROFILE_
+#define _PLAYER_STRETCHPROFILE_
+
+#include <cstdint>
+
+#include <SoundTouch.h>
+
+#include "SampleBuffer.h"
+
+namespace iolib {
+
+/*
+ * SoundTouch time-stretch settings (sequence, seek window and overlap length) tuned for
+ * the content of a stem. Percussive stems keep their hits on time with short sequences
+ * and a narrow seek window, tonal stems keep sustained notes smooth with long sequences.
+ * The values are shared with the Java side (PlayerViewModel), do not reorder.
+ */
+enum class StretchProfile : int32_t {
+    Default = 0,    // SoundTouch's automatic settings
+    Percussive = 1, // drums, click
+    Tonal = 2,      // bass, keys, pads, guitars
+    Voice = 3       // vocals, speech
+};
+
+/*
+ * Steps of the quality ladder QualityGovernor walks down when callbacks get close to their
+ * deadline, each one cheaper than the previous and including it.
+ */
+enum class QualityLevel : int32_t {
+    Full = 0,
+    QuickSeek = 1,              // SoundTouch's quick seek instead of the full correlation search
+    ShortSeekWindow = 2,        // seek window of kShortSeekWindowMs
+    LinearInterpolation = 3,    // linear pitch shift interpolation
+    NoAntiAlias = 4             // anti-alias filter of the pitch shift off
+};
+
+constexpr int32_t kNumQualityLevels = 5;
+constexpr int kShortSeekWindowMs = 6;
+
+// SETTING_INTERPOLATION values (TransposerBase::LINEAR & POLYPHASE). SoundTouch defaults to
+// cubic, the sources opt in to the polyphase filter, which is cleaner above 0.05 fs at the
+// same cost.
+constexpr int kLinearInterpolation = 0;
+constexpr int kPolyphaseInterpolation = 3;
+
+/*
+ * Passed instead of a profile to go back to the one chosen by analyzeStretchProfile().
+ */
+constexpr int32_t kStretchProfileAuto = -1;
+
+const char* getStretchProfileName(StretchProfile profile);
+
+const char* getQualityLevelName(QualityLevel level);
+
+/*
+ * Applies the settings of profile, reduced to quality level, to soundTouch. Takes effect on
+ * the next processed sequence, call clear() as well to restart the stretch from a known
+ * position. fullInterpolation is the SETTING_INTERPOLATION to restore above
+ * LinearInterpolation, -1 leaves it as it is.
+ */
+void applyStretchProfile(soundtouch::SoundTouch& soundTouch, StretchProfile profile,
+                         QualityLevel level = QualityLevel::Full, int fullInterpolation = -1);
+
+/*
+ * Applies every profile once and ends on Default, so that soundTouch (with its sample rate and
+ * channels set) allocates for the longest overlap and seek window of any profile up front.
+ * applyStretchProfile() on the audio thread then doesn't allocate.
+ */
+void reserveStretchProfiles(soundtouch::SoundTouch& soundTouch);
+
+/*
+ * Chooses a profile from the loudness envelope of the buffer: stems whose peaks mostly
+ * rise from near silence within 20 ms are percussive, evenly loud stems are tonal and
+ * stems with slower, syllable-like modulation are voice. Silent buffers get Default.
+ * One pass over the data in 10 ms blocks, cheap enough to run at load time.
+ */
+StretchProfile analyzeStretchProfile(SampleBuffer& buffer);
+
+} // namespace iolib
+
+#endif //_PLAYER_STRETCHPROFILE_
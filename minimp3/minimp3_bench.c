@@ -0,0 +1,256 @@
+/*
+    Decoder benchmark: frames/second, per-frame decode latency percentiles and
+    mp3dec_ex_seek() latency, for the current build configuration
+    (HAVE_SIMD, MINIMP3_FLOAT_OUTPUT). See scripts/bench.sh.
+
+    minimp3_bench [-r repeat] [-i iterations] [-s seeks] file...
+
+    -r  decode each file repeated in memory this many times (synthetic long stream)
+    -i  decode each file this many times, latencies of all runs are collected
+    -s  number of random sample-precise seeks to time per file; open= is the
+        mp3dec_ex_open_buf() time including the frame index scan
+*/
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 199309L
+#endif
+#define MINIMP3_IMPLEMENTATION
+#define MINIMP3_NO_STDIO
+#include "minimp3_ex.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+typedef struct
+{
+    uint64_t frames, samples, ns;  /* samples per channel */
+    uint64_t *lat;                 /* per-frame (or per-seek) latency, ns */
+    size_t num_lat, cap_lat;
+} bench_stats;
+
+static uint64_t now_ns(void)
+{
+#ifdef _WIN32
+    static LARGE_INTEGER freq;
+    LARGE_INTEGER t;
+    if (!freq.QuadPart)
+        QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&t);
+    return (uint64_t)((double)t.QuadPart*1e9/(double)freq.QuadPart);
+#else
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint64_t)t.tv_sec*1000000000u + t.tv_nsec;
+#endif
+}
+
+static void add_latency(bench_stats *s, uint64_t ns)
+{
+    if (s->num_lat == s->cap_lat)
+    {
+        s->cap_lat = s->cap_lat ? s->cap_lat*2 : 4096;
+        s->lat = (uint64_t *)realloc(s->lat, s->cap_lat*sizeof(uint64_t));
+        if (!s->lat)
+        {
+            printf("error: not enough memory\n");
+            exit(1);
+        }
+    }
+    s->lat[s->num_lat++] = ns;
+}
+
+static int cmp_u64(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+static double percentile_us(const bench_stats *s, double p)
+{   /* s->lat must be sorted */
+    size_t i;
+    if (!s->num_lat)
+        return 0;
+    i = (size_t)(p*(s->num_lat - 1) + 0.5);
+    return s->lat[i]*1e-3;
+}
+
+static void print_latency(const char *name, bench_stats *s)
+{
+    qsort(s->lat, s->num_lat, sizeof(uint64_t), cmp_u64);
+    printf(" %s p50=%.1f p90=%.1f p99=%.1f max=%.1fus", name,
+        percentile_us(s, 0.5), percentile_us(s, 0.9), percentile_us(s, 0.99), percentile_us(s, 1.0));
+}
+
+static uint8_t *load_file(const char *file_name, int repeat, size_t *size)
+{
+    FILE *file = fopen(file_name, "rb");
+    uint8_t *buf = 0;
+    long file_size;
+    int i;
+    *size = 0;
+    if (!file)
+        return 0;
+    if (fseek(file, 0, SEEK_END) || (file_size = ftell(file)) <= 0 || fseek(file, 0, SEEK_SET))
+        goto done;
+    buf = (uint8_t *)malloc((size_t)file_size*repeat);
+    if (!buf)
+        goto done;
+    if (fread(buf, 1, file_size, file) != (size_t)file_size)
+    {
+        free(buf);
+        buf = 0;
+        goto done;
+    }
+    for (i = 1; i < repeat; i++)
+        memcpy(buf + (size_t)file_size*i, buf, file_size);
+    *size = (size_t)file_size*repeat;
+done:
+    fclose(file);
+    return buf;
+}
+
+static int decode_all(const uint8_t *buf, size_t size, bench_stats *s, int *hz)
+{   /* decode frame by frame, as a streaming player would */
+    static mp3d_sample_t pcm[MINIMP3_MAX_SAMPLES_PER_FRAME];
+    mp3dec_t mp3d;
+    mp3dec_frame_info_t info;
+    uint64_t start = now_ns();
+    mp3dec_init(&mp3d);
+    memset(&info, 0, sizeof(info));
+    while (size)
+    {
+        uint64_t t = now_ns();
+        int samples = mp3dec_decode_frame(&mp3d, buf, size > INT_MAX ? INT_MAX : (int)size, pcm, &info);
+        t = now_ns() - t;
+        if (!info.frame_bytes)
+            break;
+        buf  += info.frame_bytes;
+        size -= info.frame_bytes;
+        if (samples)
+        {
+            s->frames++;
+            s->samples += samples;
+            *hz = info.hz;
+            add_latency(s, t);
+        }
+    }
+    s->ns += now_ns() - start;
+    return 0;
+}
+
+static uint32_t lcg_rand(uint32_t *state)
+{
+    *state = *state*1664525u + 1013904223u;
+    return *state >> 8;
+}
+
+static int time_seeks(const uint8_t *buf, size_t size, int seeks, bench_stats *s, uint64_t *open_ns)
+{   /* seek + first decoded frame, like a player jumping to a position */
+    mp3dec_ex_t dec;
+    mp3dec_frame_info_t info;
+    mp3d_sample_t *pcm;
+    uint32_t state = 1;
+    uint64_t t = now_ns();
+    int i, res;
+    if ((res = mp3dec_ex_open_buf(&dec, buf, size, MP3D_SEEK_TO_SAMPLE)))
+        return res;
+    res = mp3dec_ex_seek(&dec, 0); /* builds the frame index if the open did not (Xing/Info tag) */
+    *open_ns += now_ns() - t;
+    for (i = 0; !res && i < seeks && dec.samples; i++)
+    {
+        uint64_t position = (uint64_t)lcg_rand(&state)*dec.samples >> 24;
+        position -= position % dec.info.channels;
+        t = now_ns();
+        if (!(res = mp3dec_ex_seek(&dec, position)))
+            mp3dec_ex_read_frame(&dec, &pcm, &info, MINIMP3_MAX_SAMPLES_PER_FRAME);
+        add_latency(s, now_ns() - t);
+    }
+    mp3dec_ex_close(&dec);
+    return res;
+}
+
+static void print_stats(const char *name, bench_stats *decode, bench_stats *seek, uint64_t open_ns, int hz)
+{
+    double sec = decode->ns*1e-9;
+    printf("%-48s frames=%u fps=%.0f rt=%.1fx", name, (unsigned)decode->frames,
+        sec > 0 ? decode->frames/sec : 0, (sec > 0 && hz) ? (double)decode->samples/hz/sec : 0);
+    print_latency("frame", decode);
+    if (seek->num_lat)
+    {
+        printf(" open=%.2fms", open_ns*1e-6);
+        print_latency("seek", seek);
+    }
+    printf("\n");
+}
+
+int main(int argc, char *argv[])
+{
+    int i, j, repeat = 1, iterations = 1, seeks = 0, hz = 0;
+    uint64_t open_ns = 0, total_audio_us = 0;
+    bench_stats total, total_seek;
+    memset(&total, 0, sizeof(total));
+    memset(&total_seek, 0, sizeof(total_seek));
+    for (i = 1; i < argc; i++)
+    {
+        if (argv[i][0] != '-')
+            break;
+        switch (argv[i][1])
+        {
+        case 'r': i++; if (i < argc) repeat = atoi(argv[i]); break;
+        case 'i': i++; if (i < argc) iterations = atoi(argv[i]); break;
+        case 's': i++; if (i < argc) seeks = atoi(argv[i]); break;
+        default:
+            printf("error: unrecognized option\n");
+            return 1;
+        }
+    }
+    if (i >= argc || repeat < 1 || iterations < 1 || seeks < 0)
+    {
+        printf("usage: minimp3_bench [-r repeat] [-i iterations] [-s seeks] file...\n");
+        return 1;
+    }
+    printf("config: HAVE_SIMD=%d sample=%s repeat=%d iterations=%d seeks=%d\n", HAVE_SIMD,
+        sizeof(mp3d_sample_t) == sizeof(float) ? "float" : "int16", repeat, iterations, seeks);
+    for (; i < argc; i++)
+    {
+        bench_stats decode, seek;
+        uint64_t file_open_ns = 0;
+        size_t size;
+        uint8_t *buf = load_file(argv[i], repeat, &size);
+        if (!buf)
+        {
+            printf("error: can not read %s\n", argv[i]);
+            return 1;
+        }
+        memset(&decode, 0, sizeof(decode));
+        memset(&seek, 0, sizeof(seek));
+        hz = 0;
+        for (j = 0; j < iterations; j++)
+            decode_all(buf, size, &decode, &hz);
+        if (seeks && time_seeks(buf, size, seeks, &seek, &file_open_ns))
+            printf("warning: seek failed on %s\n", argv[i]);
+        print_stats(argv[i], &decode, &seek, file_open_ns, hz);
+
+        total.frames  += decode.frames;
+        total.ns      += decode.ns;
+        if (hz)
+            total_audio_us += decode.samples*1000000/hz;
+        open_ns += file_open_ns;
+        for (j = 0; j < (int)decode.num_lat; j++)
+            add_latency(&total, decode.lat[j]);
+        for (j = 0; j < (int)seek.num_lat; j++)
+            add_latency(&total_seek, seek.lat[j]);
+        free(decode.lat);
+        free(seek.lat);
+        free(buf);
+    }
+    /* rt over mixed sample rates: total audio duration / total decode time */
+    total.samples = total_audio_us;
+    print_stats("total", &total, &total_seek, open_ns, 1000000);
+    free(total.lat);
+    free(total_seek.lat);
+    return 0;
+}
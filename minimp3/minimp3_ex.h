@@ -26,7 +26,9 @@
 #define MINIMP3_IO_SIZE (128*1024) /* io buffer size for streaming functions, must be greater than MINIMP3_BUF_SIZE */
 #define MINIMP3_BUF_SIZE (16*1024) /* buffer which can hold minimum 10 consecutive mp3 frames (~16KB) worst case */
 /*#define MINIMP3_SCAN_LIMIT (256*1024)*/ /* how many bytes will be scanned to search first valid mp3 frame, to prevent stall on large non-mp3 files */
-#define MINIMP3_ENABLE_RING 0      /* WIP enable hardware magic ring buffer if available, to make less input buffer memmove(s) in callback IO mode */
+#ifndef MINIMP3_ENABLE_RING
+#define MINIMP3_ENABLE_RING 1      /* use hardware magic ring buffer if available (Linux/Android with _GNU_SOURCE), so callback IO streaming does not memmove input */
+#endif
 
 /* return error codes */
 #define MP3D_E_PARAM   -1
@@ -81,7 +83,7 @@ typedef struct
     mp3dec_frame_info_t info;
     mp3d_sample_t buffer[MINIMP3_MAX_SAMPLES_PER_FRAME];
     size_t input_consumed, input_filled;
-    int is_file, flags, vbr_tag_found, indexes_built;
+    int is_file, is_ring, flags, vbr_tag_found, indexes_built;
     int free_format_bytes;
     int buffer_samples, buffer_consumed, to_skip, start_delay;
     int last_error;
@@ -173,6 +175,36 @@ static size_t mp3dec_skip_id3v2(const uint8_t *buf, size_t buf_size)
     return 0;
 }
 
+static int mp3dec_refill_io(mp3dec_io_t *io, uint8_t *buf, size_t buf_size, int is_ring, size_t *consumed, size_t *filled)
+{   /* returns 1 at eof */
+    if (is_ring)
+    {   /* buf is mapped twice back to back, unconsumed bytes stay contiguous when the window wraps */
+        if (*consumed >= buf_size)
+        {
+            *consumed -= buf_size;
+            *filled   -= buf_size;
+        }
+    } else
+    {
+        memmove(buf, buf + *consumed, *filled - *consumed);
+        *filled -= *consumed;
+        *consumed = 0;
+    }
+    size_t to_read = buf_size - (*filled - *consumed);
+    size_t readed = io->read(buf + *filled, to_read, io->read_data);
+    if (readed > to_read)
+        return MP3D_E_IOERROR;
+    *filled += readed;
+    if (readed != to_read)
+    {
+        size_t avail = *filled - *consumed;
+        mp3dec_skip_id3v1(buf + *consumed, &avail);
+        *filled = *consumed + avail;
+        return 1;
+    }
+    return 0;
+}
+
 static void mp3dec_skip_id3(const uint8_t **pbuf, size_t *pbuf_size)
 {
     uint8_t *buf = (uint8_t *)(*pbuf);
@@ -538,7 +570,7 @@ int mp3dec_iterate_buf(const uint8_t *buf, size_t buf_size, MP3D_ITERATE_CB call
     return 0;
 }
 
-int mp3dec_iterate_cb(mp3dec_io_t *io, uint8_t *buf, size_t buf_size, MP3D_ITERATE_CB callback, void *user_data)
+static int mp3dec_iterate_io(mp3dec_io_t *io, uint8_t *buf, size_t buf_size, int is_ring, MP3D_ITERATE_CB callback, void *user_data)
 {
     if (!io || !buf || (size_t)-1 == buf_size || buf_size < MINIMP3_BUF_SIZE || !callback)
         return MP3D_E_PARAM;
@@ -597,22 +629,19 @@ int mp3dec_iterate_cb(mp3dec_io_t *io, uint8_t *buf, size_t buf_size, MP3D_ITERA
         consumed += i + frame_size;
         if (!eof && filled - consumed < MINIMP3_BUF_SIZE)
         {   /* keep minimum 10 consecutive mp3 frames (~16KB) worst case */
-            memmove(buf, buf + consumed, filled - consumed);
-            filled -= consumed;
-            consumed = 0;
-            size_t readed = io->read(buf + filled, buf_size - filled, io->read_data);
-            if (readed > (buf_size - filled))
-                return MP3D_E_IOERROR;
-            if (readed != (buf_size - filled))
-                eof = 1;
-            filled += readed;
-            if (eof)
-                mp3dec_skip_id3v1(buf, &filled);
+            if ((ret = mp3dec_refill_io(io, buf, buf_size, is_ring, &consumed, &filled)) < 0)
+                return ret;
+            eof = ret;
         }
     } while (1);
     return 0;
 }
 
+int mp3dec_iterate_cb(mp3dec_io_t *io, uint8_t *buf, size_t buf_size, MP3D_ITERATE_CB callback, void *user_data)
+{
+    return mp3dec_iterate_io(io, buf, buf_size, 0, callback, user_data);
+}
+
 static int mp3dec_load_index(void *user_data, const uint8_t *frame, int frame_size, int free_format_bytes, size_t buf_size, uint64_t offset, mp3dec_frame_info_t *info)
 {
     mp3dec_frame_t *idx_frame;
@@ -875,20 +904,10 @@ size_t mp3dec_ex_read_frame(mp3dec_ex_t *dec, mp3d_sample_t **buf, mp3dec_frame_
         {
             if (!eof && (dec->input_filled - dec->input_consumed) < MINIMP3_BUF_SIZE)
             {   /* keep minimum 10 consecutive mp3 frames (~16KB) worst case */
-                memmove((uint8_t*)dec->file.buffer, (uint8_t*)dec->file.buffer + dec->input_consumed, dec->input_filled - dec->input_consumed);
-                dec->input_filled -= dec->input_consumed;
-                dec->input_consumed = 0;
-                size_t readed = dec->io->read((uint8_t*)dec->file.buffer + dec->input_filled, dec->file.size - dec->input_filled, dec->io->read_data);
-                if (readed > (dec->file.size - dec->input_filled))
-                {
-                    dec->last_error = MP3D_E_IOERROR;
-                    readed = 0;
-                }
-                if (readed != (dec->file.size - dec->input_filled))
-                    eof = 1;
-                dec->input_filled += readed;
-                if (eof)
-                    mp3dec_skip_id3v1((uint8_t*)dec->file.buffer, &dec->input_filled);
+                int ret = mp3dec_refill_io(dec->io, (uint8_t*)dec->file.buffer, dec->file.size, dec->is_ring, &dec->input_consumed, &dec->input_filled);
+                if (ret < 0)
+                    dec->last_error = ret;
+                eof = ret != 0;
             }
             dec_buf = dec->file.buffer + dec->input_consumed;
             if (!(dec->input_filled - dec->input_consumed))
@@ -973,27 +992,94 @@ size_t mp3dec_ex_read(mp3dec_ex_t *dec, mp3d_sample_t *buf, size_t samples)
     return samples_requested - samples;
 }
 
+#if MINIMP3_ENABLE_RING && defined(__linux__) && defined(_GNU_SOURCE)
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#ifdef __NR_memfd_create
+#define MINIMP3_HAVE_RING
+static void mp3dec_close_ring(mp3dec_map_info_t *map_info)
+{
+    if (map_info->buffer)
+        munmap((void *)map_info->buffer, map_info->size*2);
+    map_info->buffer = 0;
+    map_info->size   = 0;
+}
+
+static int mp3dec_open_ring(mp3dec_map_info_t *map_info, size_t size)
+{   /* the same pages mapped twice back to back, so reads wrapping past the end land at the start */
+    int memfd, res;
+    long page_size = sysconf(_SC_PAGESIZE);
+    void *buffer;
+    memset(map_info, 0, sizeof(*map_info));
+    if (page_size <= 0)
+        return MP3D_E_MEMORY;
+    size = (size + page_size - 1)/page_size*page_size;
+
+    /* memfd_create() wrapper needs glibc 2.27 / Android API 30, the syscall is older */
+    memfd = (int)syscall(__NR_memfd_create, "mp3_ring", 0);
+    if (memfd < 0)
+        return MP3D_E_MEMORY;
+retry_ftruncate:
+    res = ftruncate(memfd, (off_t)size);
+    if (res && (errno == EAGAIN || errno == EINTR))
+        goto retry_ftruncate;
+    if (res)
+        goto error;
+
+retry_mmap:
+    buffer = mmap(NULL, size*2, PROT_NONE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+    if (MAP_FAILED == buffer && (errno == EAGAIN || errno == EINTR))
+        goto retry_mmap;
+    if (MAP_FAILED == buffer)
+        goto error;
+    map_info->buffer = (const uint8_t *)buffer;
+    map_info->size   = size;
+retry_mmap2:
+    buffer = mmap((void *)map_info->buffer, size, PROT_READ | PROT_WRITE, MAP_FIXED | MAP_SHARED, memfd, 0);
+    if (MAP_FAILED == buffer && (errno == EAGAIN || errno == EINTR))
+        goto retry_mmap2;
+    if (buffer != (void *)map_info->buffer)
+        goto error;
+retry_mmap3:
+    buffer = mmap((void *)(map_info->buffer + size), size, PROT_READ | PROT_WRITE, MAP_FIXED | MAP_SHARED, memfd, 0);
+    if (MAP_FAILED == buffer && (errno == EAGAIN || errno == EINTR))
+        goto retry_mmap3;
+    if (buffer != (void *)(map_info->buffer + size))
+        goto error;
+
+    close(memfd);
+    return 0;
+error:
+    close(memfd);
+    mp3dec_close_ring(map_info);
+    return MP3D_E_MEMORY;
+}
+#endif /* __NR_memfd_create */
+#endif /* MINIMP3_ENABLE_RING */
+
 int mp3dec_ex_open_cb(mp3dec_ex_t *dec, mp3dec_io_t *io, int flags)
 {
     if (!dec || !io || (flags & (~MP3D_FLAGS_MASK)))
         return MP3D_E_PARAM;
     memset(dec, 0, sizeof(*dec));
 #ifdef MINIMP3_HAVE_RING
-    int ret;
-    if (ret = mp3dec_open_ring(&dec->file, MINIMP3_IO_SIZE))
-        return ret;
-#else
-    dec->file.size = MINIMP3_IO_SIZE;
-    dec->file.buffer = (const uint8_t*)malloc(dec->file.size);
-    if (!dec->file.buffer)
-        return MP3D_E_MEMORY;
+    dec->is_ring = !mp3dec_open_ring(&dec->file, MINIMP3_IO_SIZE);
 #endif
+    if (!dec->is_ring)
+    {   /* no ring buffer, refills memmove the unconsumed input to the start */
+        dec->file.size = MINIMP3_IO_SIZE;
+        dec->file.buffer = (const uint8_t*)malloc(dec->file.size);
+        if (!dec->file.buffer)
+            return MP3D_E_MEMORY;
+    }
     dec->flags = flags;
     dec->io = io;
     mp3dec_init(&dec->mp3d);
     if (io->seek(0, io->seek_data))
         return MP3D_E_IOERROR;
-    int ret = mp3dec_iterate_cb(io, (uint8_t *)dec->file.buffer, dec->file.size, mp3dec_load_index, dec);
+    int ret = mp3dec_iterate_io(io, (uint8_t *)dec->file.buffer, dec->file.size, dec->is_ring, mp3dec_load_index, dec);
     if (ret && MP3D_E_USER != ret)
         return ret;
     if (dec->io->seek(dec->start_offset, dec->io->seek_data))
@@ -1015,10 +1101,6 @@ int mp3dec_ex_open_cb(mp3dec_ex_t *dec, mp3dec_io_t *io, int flags)
 #include <sys/stat.h>
 #include <unistd.h>
 #include <fcntl.h>
-#if !defined(_GNU_SOURCE)
-#include <sys/ipc.h>
-#include <sys/shm.h>
-#endif
 #if !defined(MAP_POPULATE) && defined(__linux__)
 #define MAP_POPULATE 0x08000
 #elif !defined(MAP_POPULATE)
@@ -1061,101 +1143,6 @@ retry_mmap:
     return 0;
 }
 
-#if MINIMP3_ENABLE_RING && defined(__linux__) && defined(_GNU_SOURCE)
-#define MINIMP3_HAVE_RING
-static void mp3dec_close_ring(mp3dec_map_info_t *map_info)
-{
-#if defined(__linux__) && defined(_GNU_SOURCE)
-    if (map_info->buffer && MAP_FAILED != map_info->buffer)
-        munmap((void *)map_info->buffer, map_info->size*2);
-#else
-    if (map_info->buffer)
-    {
-        shmdt(map_info->buffer);
-        shmdt(map_info->buffer + map_info->size);
-    }
-#endif
-    map_info->buffer = 0;
-    map_info->size   = 0;
-}
-
-static int mp3dec_open_ring(mp3dec_map_info_t *map_info, size_t size)
-{
-    int memfd, page_size;
-#if defined(__linux__) && defined(_GNU_SOURCE)
-    void *buffer;
-    int res;
-#endif
-    memset(map_info, 0, sizeof(*map_info));
-
-#ifdef _SC_PAGESIZE
-    page_size = sysconf(_SC_PAGESIZE);
-#else
-    page_size = getpagesize();
-#endif
-    map_info->size = (size + page_size - 1)/page_size*page_size;
-
-#if defined(__linux__) && defined(_GNU_SOURCE)
-    memfd = memfd_create("mp3_ring", 0);
-    if (memfd < 0)
-        return MP3D_E_MEMORY;
-
-retry_ftruncate:
-    res = ftruncate(memfd, map_info->size);
-    if (res && (errno == EAGAIN || errno == EINTR))
-        goto retry_ftruncate;
-    if (res)
-        goto error;
-
-retry_mmap:
-    map_info->buffer = (const uint8_t *)mmap(NULL, map_info->size*2, PROT_NONE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
-    if (MAP_FAILED == map_info->buffer && (errno == EAGAIN || errno == EINTR))
-        goto retry_mmap;
-    if (MAP_FAILED == map_info->buffer || !map_info->buffer)
-        goto error;
-retry_mmap2:
-    buffer = mmap((void *)map_info->buffer, map_info->size, PROT_READ | PROT_WRITE, MAP_FIXED | MAP_SHARED, memfd, 0);
-    if (MAP_FAILED == map_info->buffer && (errno == EAGAIN || errno == EINTR))
-        goto retry_mmap2;
-    if (MAP_FAILED == map_info->buffer || buffer != (void *)map_info->buffer)
-        goto error;
-retry_mmap3:
-    buffer = mmap((void *)map_info->buffer + map_info->size, map_info->size, PROT_READ | PROT_WRITE, MAP_FIXED | MAP_SHARED, memfd, 0);
-    if (MAP_FAILED == map_info->buffer && (errno == EAGAIN || errno == EINTR))
-        goto retry_mmap3;
-    if (MAP_FAILED == map_info->buffer || buffer != (void *)(map_info->buffer + map_info->size))
-        goto error;
-
-    close(memfd);
-    return 0;
-error:
-    close(memfd);
-    mp3dec_close_ring(map_info);
-    return MP3D_E_MEMORY;
-#else
-    memfd = shmget(IPC_PRIVATE, map_info->size, IPC_CREAT | 0700);
-    if (memfd < 0)
-        return MP3D_E_MEMORY;
-retry_mmap:
-    map_info->buffer = (const uint8_t *)mmap(NULL, map_info->size*2, PROT_NONE, MAP_PRIVATE, -1, 0);
-    if (MAP_FAILED == map_info->buffer && (errno == EAGAIN || errno == EINTR))
-        goto retry_mmap;
-    if (MAP_FAILED == map_info->buffer)
-        goto error;
-    if (map_info->buffer != shmat(memfd, map_info->buffer, 0))
-        goto error;
-    if ((map_info->buffer + map_info->size) != shmat(memfd, map_info->buffer + map_info->size, 0))
-        goto error;
-    if (shmctl(memfd, IPC_RMID, NULL) < 0)
-        return MP3D_E_MEMORY;
-    return 0;
-error:
-    shmctl(memfd, IPC_RMID, NULL);
-    mp3dec_close_ring(map_info);
-    return MP3D_E_MEMORY;
-#endif
-}
-#endif /*MINIMP3_ENABLE_RING*/
 #elif defined(_WIN32)
 #include <windows.h>
 
@@ -1329,12 +1316,12 @@ int mp3dec_ex_open(mp3dec_ex_t *dec, const char *file_name, int flags)
 void mp3dec_ex_close(mp3dec_ex_t *dec)
 {
 #ifdef MINIMP3_HAVE_RING
-    if (dec->io)
+    if (dec->is_ring)
         mp3dec_close_ring(&dec->file);
-#else
+    else
+#endif
     if (dec->io && dec->file.buffer)
         free((void*)dec->file.buffer);
-#endif
     if (dec->is_file)
         mp3dec_close_file(&dec->file);
     if (dec->index.frames)
@@ -1382,12 +1369,12 @@ int mp3dec_ex_open_w(mp3dec_ex_t *dec, const wchar_t *file_name, int flags)
 void mp3dec_ex_close(mp3dec_ex_t *dec)
 {
 #ifdef MINIMP3_HAVE_RING
-    if (dec->io)
+    if (dec->is_ring)
         mp3dec_close_ring(&dec->file);
-#else
+    else
+#endif
     if (dec->io && dec->file.buffer)
         free((void*)dec->file.buffer);
-#endif
     if (dec->index.frames)
         free(dec->index.frames);
     memset(dec, 0, sizeof(*dec));
@@ -0,0 +1,19 @@
+_FILENAME=${0##*/}
+CUR_DIR=${0/${_FILENAME}}
+CUR_DIR=$(cd $(dirname ${CUR_DIR}); pwd)/$(basename ${CUR_DIR})/
+
+pushd $CUR_DIR/..
+
+set -e
+
+# decode throughput, per-frame and seek latency: SIMD vs scalar, int16 vs float output
+CFLAGS="-O2 -std=c89 -Wall -Wextra -Wmissing-prototypes -Werror"
+LONG=vectors/l3-sin1k0db.bit
+
+for SIMD in "" "-DMINIMP3_NO_SIMD"; do
+for OUTPUT in "" "-DMINIMP3_FLOAT_OUTPUT"; do
+gcc $CFLAGS $SIMD $OUTPUT -o minimp3_bench minimp3_bench.c -lm
+./minimp3_bench -i 3 -s 100 vectors/*.bit
+./minimp3_bench -r 50 -s 1000 $LONG
+done
+done
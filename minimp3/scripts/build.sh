@@ -16,6 +16,11 @@ scripts/test_mode.sh 3 0 0
 echo testing stream mode...
 scripts/test_mode.sh 6 -1 -1
 
+echo testing callback stream mode w ring buffer...
+gcc $CFLAGS -D_GNU_SOURCE -o minimp3 minimp3_test.c -lm
+scripts/test_mode.sh 8 -1 -1
+scripts/test_mode.sh 8 -2 -1
+
 echo testing coverage x86 w sse...
 gcc -coverage -O0 -m32 -std=c89 -msse2 -DMINIMP3_TEST -DMINIMP3_NO_WAV -o minimp3 minimp3_test.c -lm
 scripts/test.sh
@@ -0,0 +1,16 @@
+_FILENAME=${0##*/}
+CUR_DIR=${0/${_FILENAME}}
+CUR_DIR=$(cd $(dirname ${CUR_DIR}); pwd)/$(basename ${CUR_DIR})/
+
+pushd $CUR_DIR/..
+
+# callback IO streaming (mp3dec_ex_open_cb) with memmove refills vs the magic ring buffer
+CFLAGS="-O2 -D_GNU_SOURCE -DMINIMP3_NO_WAV"
+gcc $CFLAGS -DMINIMP3_ENABLE_RING=0 -o minimp3_memmove minimp3_test.c -lm
+gcc $CFLAGS -DMINIMP3_ENABLE_RING=1 -o minimp3_ring minimp3_test.c -lm
+
+for i in vectors/*.bit; do
+for APP in ./minimp3_memmove ./minimp3_ring; do
+perf stat -e cycles,instructions $APP -m 8 $i ${i%.*}.pcm
+done
+done
@@ -0,0 +1,195 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <algorithm>
+#include <stdlib.h>
+#include <string.h>
+
+#include "BufferedInputStream.h"
+
+namespace parselib {
+
+// Windows start on (and are multiples of) this boundary
+static constexpr int32_t kWindowAlignment = 4096;
+
+static unsigned char *allocWindowBuffer(int32_t size) {
+    void *buffer = nullptr;
+    if (posix_memalign(&buffer, kWindowAlignment, size) != 0) {
+        return nullptr;
+    }
+    return static_cast<unsigned char *>(buffer);
+}
+
+BufferedInputStream::BufferedInputStream(InputStream *source, int32_t bufferSize, bool prefetch)
+        : mSource(source),
+          mBufferSize(std::max((bufferSize + kWindowAlignment - 1) & ~(kWindowAlignment - 1),
+                               kWindowAlignment)),
+          mSourceHasReadAt(false), mPos(0), mPrefetchEnabled(false),
+          mPrefetchState(PrefetchState::Idle), mPrefetchRunning(false) {
+    mCurrent.data = allocWindowBuffer(mBufferSize);
+
+    // probe for positional reads, which the prefetch thread needs
+    unsigned char probe;
+    mSourceHasReadAt = mSource->readAt(0, &probe, 0) >= 0;
+
+    if (prefetch && mSourceHasReadAt) {
+        mNext.data = allocWindowBuffer(mBufferSize);
+        mPrefetchEnabled = mNext.data != nullptr;
+    }
+    if (mPrefetchEnabled) {
+        mPrefetchRunning = true;
+        mPrefetchThread = std::thread(&BufferedInputStream::prefetchLoop, this);
+    }
+}
+
+BufferedInputStream::~BufferedInputStream() {
+    if (mPrefetchThread.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(mPrefetchMutex);
+            mPrefetchRunning = false;
+        }
+        mPrefetchCondition.notify_all();
+        mPrefetchThread.join();
+    }
+    free(mCurrent.data);
+    free(mNext.data);
+}
+
+int32_t BufferedInputStream::read(void *buff, int32_t numBytes) {
+    int32_t numRead = peek(buff, numBytes);
+    mPos += numRead;
+    return numRead;
+}
+
+int32_t BufferedInputStream::peek(void *buff, int32_t numBytes) {
+    unsigned char *dest = static_cast<unsigned char *>(buff);
+    int64_t pos = mPos;
+    int32_t numRead = 0;
+    while (numRead < numBytes) {
+        if (!mCurrent.contains(pos) && !loadWindow(pos)) {
+            break; // end of the source
+        }
+        int32_t offset = (int32_t) (pos - mCurrent.start);
+        int32_t numCopy = std::min(numBytes - numRead, mCurrent.length - offset);
+        memcpy(dest + numRead, mCurrent.data + offset, numCopy);
+        numRead += numCopy;
+        pos += numCopy;
+    }
+    return numRead;
+}
+
+void BufferedInputStream::advance(int64_t numBytes) {
+    if (numBytes > 0) {
+        mPos += numBytes;
+    }
+}
+
+int64_t BufferedInputStream::getPos() {
+    return mPos;
+}
+
+void BufferedInputStream::setPos(int64_t pos) {
+    if (pos >= 0) {
+        mPos = pos;
+    }
+}
+
+const unsigned char *BufferedInputStream::peekPointer(int32_t numBytes) {
+    if (numBytes < 0 || !mCurrent.contains(mPos)
+            || mPos + numBytes > mCurrent.start + mCurrent.length) {
+        return nullptr;
+    }
+    return mCurrent.data + (mPos - mCurrent.start);
+}
+
+int32_t BufferedInputStream::readAt(int64_t pos, void *buff, int32_t numBytes) {
+    return mSource->readAt(pos, buff, numBytes);
+}
+
+int32_t BufferedInputStream::readSource(int64_t pos, unsigned char *buff) {
+    if (mSourceHasReadAt) {
+        return std::max(mSource->readAt(pos, buff, mBufferSize), 0);
+    }
+    mSource->setPos(pos);
+    return std::max(mSource->read(buff, mBufferSize), 0);
+}
+
+bool BufferedInputStream::loadWindow(int64_t pos) {
+    if (mCurrent.data == nullptr) {
+        return false;
+    }
+    int64_t windowStart = pos - (pos % mBufferSize);
+
+    bool loaded = false;
+    if (mPrefetchEnabled) {
+        std::unique_lock<std::mutex> lock(mPrefetchMutex);
+        if (mPrefetchState == PrefetchState::Loading && windowStart == mNext.start) {
+            mPrefetchCondition.wait(lock, [this] { return mPrefetchState != PrefetchState::Loading; });
+        }
+        if (mPrefetchState == PrefetchState::Ready && mNext.start == windowStart) {
+            std::swap(mCurrent, mNext);
+            mPrefetchState = PrefetchState::Idle;
+            loaded = true;
+        }
+    }
+
+    if (!loaded) {
+        mCurrent.start = windowStart;
+        mCurrent.length = readSource(windowStart, mCurrent.data);
+    }
+
+    if (mCurrent.length == mBufferSize) {
+        requestPrefetch(mCurrent.start + mBufferSize);
+    }
+    return mCurrent.contains(pos);
+}
+
+void BufferedInputStream::requestPrefetch(int64_t pos) {
+    if (!mPrefetchEnabled) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mPrefetchMutex);
+        if (mPrefetchState == PrefetchState::Loading
+                || (mPrefetchState == PrefetchState::Ready && mNext.start == pos)) {
+            return; // busy, or already there
+        }
+        mNext.start = pos;
+        mNext.length = 0;
+        mPrefetchState = PrefetchState::Loading;
+    }
+    mPrefetchCondition.notify_all();
+}
+
+void BufferedInputStream::prefetchLoop() {
+    std::unique_lock<std::mutex> lock(mPrefetchMutex);
+    while (true) {
+        mPrefetchCondition.wait(lock, [this] {
+            return !mPrefetchRunning || mPrefetchState == PrefetchState::Loading;
+        });
+        if (!mPrefetchRunning) {
+            break;
+        }
+
+        int64_t start = mNext.start;
+        lock.unlock();
+        int32_t length = std::max(mSource->readAt(start, mNext.data, mBufferSize), 0);
+        lock.lock();
+
+        mNext.length = length;
+        mPrefetchState = PrefetchState::Ready;
+        mPrefetchCondition.notify_all();
+    }
+}
+
+} // namespace parselib
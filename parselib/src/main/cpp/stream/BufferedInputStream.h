@@ -0,0 +1,98 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef _IO_STREAM_BUFFEREDINPUTSTREAM_H_
+#define _IO_STREAM_BUFFEREDINPUTSTREAM_H_
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "InputStream.h"
+
+namespace parselib {
+
+/**
+ * An InputStream decorator that reads its source in large, page aligned windows, so that
+ * small reads, peeks and seeks (e.g. while parsing chunk headers) are served from memory
+ * instead of each costing a syscall.
+ *
+ * With prefetch enabled, a background thread reads the window following the current one
+ * while it is being consumed, so sequential reads see the throughput of the device. The
+ * source must support InputStream::readAt() for that (FileInputStream does), otherwise
+ * windows are loaded with setPos()/read() on the calling thread.
+ *
+ * The source is not owned and must outlive the BufferedInputStream.
+ */
+class BufferedInputStream : public InputStream {
+public:
+    static constexpr int32_t kDefaultBufferSize = 256 * 1024;
+
+    BufferedInputStream(InputStream *source, int32_t bufferSize = kDefaultBufferSize,
+                        bool prefetch = false);
+    virtual ~BufferedInputStream();
+
+    virtual int32_t read(void *buff, int32_t numBytes);
+
+    virtual int32_t peek(void *buff, int32_t numBytes);
+
+    virtual void advance(int64_t numBytes);
+
+    virtual int64_t getPos();
+
+    virtual void setPos(int64_t pos);
+
+    /** Only succeeds if the bytes are in the current window */
+    virtual const unsigned char *peekPointer(int32_t numBytes);
+
+    virtual int32_t readAt(int64_t pos, void *buff, int32_t numBytes);
+
+private:
+    struct Window {
+        unsigned char *data = nullptr;
+        int64_t start = 0;
+        int32_t length = 0; // valid bytes, less than the buffer size at the end of the source
+
+        bool contains(int64_t pos) const { return pos >= start && pos < start + length; }
+    };
+
+    enum class PrefetchState { Idle, Loading, Ready };
+
+    /** Makes the window containing pos current. Returns false at the end of the source. */
+    bool loadWindow(int64_t pos);
+    int32_t readSource(int64_t pos, unsigned char *buff);
+    void requestPrefetch(int64_t pos);
+    void prefetchLoop();
+
+    InputStream *mSource;
+    int32_t mBufferSize;
+    bool mSourceHasReadAt;
+
+    /** The index of the next byte to read */
+    int64_t mPos;
+
+    Window mCurrent;
+
+    // Prefetch (mNext belongs to the prefetch thread while mPrefetchState is Loading)
+    bool mPrefetchEnabled;
+    Window mNext;
+    PrefetchState mPrefetchState;
+    bool mPrefetchRunning;
+    std::mutex mPrefetchMutex;
+    std::condition_variable mPrefetchCondition;
+    std::thread mPrefetchThread;
+};
+
+} // namespace parselib
+
+#endif // _IO_STREAM_BUFFEREDINPUTSTREAM_H_
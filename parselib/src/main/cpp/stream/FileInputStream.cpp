@@ -24,25 +24,28 @@ int32_t FileInputStream::read(void *buff, int32_t numBytes) {
 }
 
 int32_t FileInputStream::peek(void *buff, int32_t numBytes) {
-    int32_t numRead = ::read(mFH, buff, numBytes);
-    ::lseek(mFH, -numBytes, SEEK_CUR);
-    return numRead;
+    // pread() leaves the file offset alone, so no seek back is needed
+    return ::pread64(mFH, buff, numBytes, ::lseek64(mFH, 0L, SEEK_CUR));
 }
 
-void FileInputStream::advance(int32_t numBytes) {
+void FileInputStream::advance(int64_t numBytes) {
     if (numBytes > 0) {
-        ::lseek(mFH, numBytes, SEEK_CUR);
+        ::lseek64(mFH, numBytes, SEEK_CUR);
     }
 }
 
-int32_t FileInputStream::getPos() {
-    return ::lseek(mFH, 0L, SEEK_CUR);
+int64_t FileInputStream::getPos() {
+    return ::lseek64(mFH, 0L, SEEK_CUR);
 }
 
-void FileInputStream::setPos(int32_t pos) {
+void FileInputStream::setPos(int64_t pos) {
     if (pos > 0) {
-        ::lseek(mFH, pos, SEEK_SET);
+        ::lseek64(mFH, pos, SEEK_SET);
     }
 }
 
+int32_t FileInputStream::readAt(int64_t pos, void *buff, int32_t numBytes) {
+    return ::pread64(mFH, buff, numBytes, pos);
+}
+
 } /* namespace parselib */
@@ -33,11 +33,13 @@ public:
 
     virtual int32_t peek(void *buff, int32_t numBytes);
 
-    virtual void advance(int32_t numBytes);
+    virtual void advance(int64_t numBytes);
 
-    virtual int32_t getPos();
+    virtual int64_t getPos();
 
-    virtual void setPos(int32_t pos);
+    virtual void setPos(int64_t pos);
+
+    virtual int32_t readAt(int64_t pos, void *buff, int32_t numBytes);
 
 private:
     /** File handle of the data file to read from */
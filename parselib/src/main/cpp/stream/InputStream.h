@@ -22,6 +22,7 @@ namespace parselib {
 
 /**
  * An interface declaration for a stream of bytes. Concrete implements for File and Memory Buffers
+ * Positions are 64-bit so that streams larger than 2 GB (e.g. RF64 files) can be addressed.
  */
 class InputStream {
 public:
@@ -45,17 +46,32 @@ public:
     /**
      * Moves the read position forward the (positive) number of bytes specified.
      */
-    virtual void advance(int32_t numBytes) = 0;
+    virtual void advance(int64_t numBytes) = 0;
 
     /**
      * Returns the read position of the stream
      */
-    virtual int32_t getPos() = 0;
+    virtual int64_t getPos() = 0;
 
     /**
      * Sets the read position of the stream to the 0 or positive position.
      */
-    virtual void setPos(int32_t pos) = 0;
+    virtual void setPos(int64_t pos) = 0;
+
+    /**
+     * Returns a pointer to the next numBytes bytes of the stream WITHOUT copying them or
+     * advancing the read position, or nullptr if the stream is not memory backed or fewer
+     * than numBytes bytes remain.
+     */
+    virtual const unsigned char *peekPointer(int32_t numBytes) { return nullptr; }
+
+    /**
+     * Retrieve up to numBytes bytes starting at the absolute position pos. DOES NOT use or
+     * change the read position, so it may be called from another thread.
+     * Returns: The number of bytes actually retrieved, or -1 if the stream does not
+     * support positional reads.
+     */
+    virtual int32_t readAt(int64_t pos, void *buff, int32_t numBytes) { return -1; }
 };
 
 } // namespace parselib
@@ -0,0 +1,64 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <errno.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <android/log.h>
+
+#include "MappedInputStream.h"
+
+static const char *TAG = "MappedInputStream";
+
+namespace parselib {
+
+MappedInputStream::MappedInputStream(int fd, off64_t offset, int64_t length)
+        : MemInputStream(nullptr, 0), mMapAddress(nullptr), mMapLength(0) {
+    if (fd < 0 || offset < 0 || length <= 0) {
+        return;
+    }
+
+    // mmap() wants a page aligned file offset, so map from the page containing offset
+    off64_t pageSize = sysconf(_SC_PAGESIZE);
+    off64_t mapOffset = offset & ~(pageSize - 1);
+    size_t lead = static_cast<size_t>(offset - mapOffset);
+
+    if ((uint64_t) (lead + length) > SIZE_MAX) {
+        __android_log_print(ANDROID_LOG_ERROR, TAG, "%lld bytes do not fit the address space",
+                            (long long) length);
+        return;
+    }
+
+    void *address = mmap64(nullptr, lead + length, PROT_READ, MAP_PRIVATE, fd, mapOffset);
+    if (address == MAP_FAILED) {
+        __android_log_print(ANDROID_LOG_ERROR, TAG, "mmap(%lld bytes @ %lld) failed: %s",
+                            (long long) length, (long long) offset, strerror(errno));
+        return;
+    }
+
+    mMapAddress = address;
+    mMapLength = lead + length;
+    mBuffer = static_cast<unsigned char *>(address) + lead;
+    mBufferLen = length;
+}
+
+MappedInputStream::~MappedInputStream() {
+    if (mMapAddress != nullptr) {
+        munmap(mMapAddress, mMapLength);
+    }
+}
+
+} // namespace parselib
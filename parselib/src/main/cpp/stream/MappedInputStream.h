@@ -0,0 +1,49 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef _IO_STREAM_MAPPEDINPUTSTREAM_H_
+#define _IO_STREAM_MAPPEDINPUTSTREAM_H_
+
+#include <sys/types.h>
+
+#include "MemInputStream.h"
+
+namespace parselib {
+
+/**
+ * A MemInputStream over a read-only memory mapping of (a region of) a file, e.g. an
+ * uncompressed asset described by an AssetFileDescriptor (fd, start offset, length).
+ * The mapping is released when the stream is deleted, so anything that keeps pointers
+ * obtained from peekPointer() must keep the stream alive.
+ */
+class MappedInputStream : public MemInputStream {
+public:
+    /**
+     * Maps length bytes of the file fd starting at offset. The offset need not be page aligned.
+     * The fd may be closed once the stream has been constructed.
+     */
+    MappedInputStream(int fd, off64_t offset, int64_t length);
+    virtual ~MappedInputStream();
+
+    /** true if the region could be mapped */
+    bool isValid() const { return mMapAddress != nullptr; }
+
+private:
+    /** Page aligned start and length of the mapping (mBuffer points into it) */
+    void *mMapAddress;
+    size_t mMapLength;
+};
+
+} // namespace parselib
+
+#endif // _IO_STREAM_MAPPEDINPUTSTREAM_H_
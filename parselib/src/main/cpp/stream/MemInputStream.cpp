@@ -21,8 +21,8 @@
 namespace parselib {
 
 int32_t MemInputStream::read(void *buff, int32_t numBytes) {
-    int32_t numAvail = mBufferLen - mPos;
-    numBytes = std::min(numBytes, numAvail);
+    int64_t numAvail = mBufferLen - mPos;
+    numBytes = (int32_t) std::min((int64_t) numBytes, numAvail);
 
     peek(buff, numBytes);
     mPos += numBytes;
@@ -30,24 +30,24 @@ int32_t MemInputStream::read(void *buff, int32_t numBytes) {
 }
 
 int32_t MemInputStream::peek(void *buff, int32_t numBytes) {
-    int32_t numAvail = mBufferLen - mPos;
-    numBytes = std::min(numBytes, numAvail);
+    int64_t numAvail = mBufferLen - mPos;
+    numBytes = (int32_t) std::min((int64_t) numBytes, numAvail);
     memcpy(buff, mBuffer + mPos, numBytes);
     return numBytes;
 }
 
-void MemInputStream::advance(int32_t numBytes) {
+void MemInputStream::advance(int64_t numBytes) {
     if (numBytes > 0) {
-        int32_t numAvail = mBufferLen - mPos;
+        int64_t numAvail = mBufferLen - mPos;
         mPos += std::min(numAvail, numBytes);
     }
 }
 
-int32_t MemInputStream::getPos() {
+int64_t MemInputStream::getPos() {
     return mPos;
 }
 
-void MemInputStream::setPos(int32_t pos) {
+void MemInputStream::setPos(int64_t pos) {
     if (pos > 0) {
         if (pos < mBufferLen) {
             mPos = pos;
@@ -57,4 +57,20 @@ void MemInputStream::setPos(int32_t pos) {
     }
 }
 
+const unsigned char *MemInputStream::peekPointer(int32_t numBytes) {
+    if (numBytes < 0 || numBytes > mBufferLen - mPos) {
+        return nullptr;
+    }
+    return mBuffer + mPos;
+}
+
+int32_t MemInputStream::readAt(int64_t pos, void *buff, int32_t numBytes) {
+    if (pos < 0 || pos >= mBufferLen) {
+        return 0;
+    }
+    numBytes = (int32_t) std::min((int64_t) numBytes, mBufferLen - pos);
+    memcpy(buff, mBuffer + pos, numBytes);
+    return numBytes;
+}
+
 } // namespace parselib
@@ -0,0 +1,154 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <string.h>
+
+#include "SampleConversion.h"
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define SAMPLECONVERSION_USE_NEON
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define SAMPLECONVERSION_USE_SSE2
+#if defined(__SSSE3__)
+#include <tmmintrin.h>
+#endif
+#endif
+
+namespace parselib {
+
+static constexpr float kInverseScale8 = 1.0f / (float) 0x80;
+static constexpr float kInverseScale16 = 1.0f / (float) 0x8000;
+// 24-bit samples are placed in the upper bytes of an int32 and scaled like PCM32
+static constexpr float kInverseScale32 = 1.0f / (float) 0x80000000;
+
+void convertPCM8ToFloat(const unsigned char *src, float *dst, int32_t numSamples) {
+    int32_t index = 0;
+#if defined(SAMPLECONVERSION_USE_NEON)
+    const uint8x16_t signBit = vdupq_n_u8(0x80);
+    for (; index + 16 <= numSamples; index += 16) {
+        // flipping the top bit turns unsigned (0x80 = 0) into signed
+        int8x16_t samples = vreinterpretq_s8_u8(veorq_u8(vld1q_u8(src + index), signBit));
+        int16x8_t low = vmovl_s8(vget_low_s8(samples));
+        int16x8_t high = vmovl_s8(vget_high_s8(samples));
+        vst1q_f32(dst + index, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(low))), kInverseScale8));
+        vst1q_f32(dst + index + 4, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(low))), kInverseScale8));
+        vst1q_f32(dst + index + 8, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(high))), kInverseScale8));
+        vst1q_f32(dst + index + 12, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(high))), kInverseScale8));
+    }
+#elif defined(SAMPLECONVERSION_USE_SSE2)
+    const __m128i signBit = _mm_set1_epi8((char) 0x80);
+    const __m128 scale = _mm_set1_ps(kInverseScale8);
+    for (; index + 16 <= numSamples; index += 16) {
+        __m128i samples = _mm_xor_si128(
+                _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + index)), signBit);
+        // sign-extend by placing each value in the upper half of a wider lane and shifting back
+        __m128i low = _mm_srai_epi16(_mm_unpacklo_epi8(samples, samples), 8);
+        __m128i high = _mm_srai_epi16(_mm_unpackhi_epi8(samples, samples), 8);
+        __m128i words[2] = {low, high};
+        for (int half = 0; half < 2; half++) {
+            __m128i first = _mm_srai_epi32(_mm_unpacklo_epi16(words[half], words[half]), 16);
+            __m128i second = _mm_srai_epi32(_mm_unpackhi_epi16(words[half], words[half]), 16);
+            _mm_storeu_ps(dst + index + half * 8, _mm_mul_ps(_mm_cvtepi32_ps(first), scale));
+            _mm_storeu_ps(dst + index + half * 8 + 4, _mm_mul_ps(_mm_cvtepi32_ps(second), scale));
+        }
+    }
+#endif
+    for (; index < numSamples; index++) {
+        dst[index] = ((float) src[index] - (float) 0x80) * kInverseScale8;
+    }
+}
+
+void convertPCM16ToFloat(const unsigned char *src, float *dst, int32_t numSamples) {
+    int32_t index = 0;
+#if defined(SAMPLECONVERSION_USE_NEON)
+    for (; index + 8 <= numSamples; index += 8) {
+        int16x8_t samples = vreinterpretq_s16_u8(vld1q_u8(src + index * 2));
+        vst1q_f32(dst + index, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(samples))), kInverseScale16));
+        vst1q_f32(dst + index + 4, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(samples))), kInverseScale16));
+    }
+#elif defined(SAMPLECONVERSION_USE_SSE2)
+    const __m128 scale = _mm_set1_ps(kInverseScale16);
+    for (; index + 8 <= numSamples; index += 8) {
+        __m128i samples = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + index * 2));
+        __m128i low = _mm_srai_epi32(_mm_unpacklo_epi16(samples, samples), 16);
+        __m128i high = _mm_srai_epi32(_mm_unpackhi_epi16(samples, samples), 16);
+        _mm_storeu_ps(dst + index, _mm_mul_ps(_mm_cvtepi32_ps(low), scale));
+        _mm_storeu_ps(dst + index + 4, _mm_mul_ps(_mm_cvtepi32_ps(high), scale));
+    }
+#endif
+    for (; index < numSamples; index++) {
+        int16_t sample;
+        memcpy(&sample, src + index * 2, sizeof(sample));
+        dst[index] = (float) sample * kInverseScale16;
+    }
+}
+
+void convertPCM24ToFloat(const unsigned char *src, float *dst, int32_t numSamples) {
+    int32_t index = 0;
+#if defined(SAMPLECONVERSION_USE_NEON)
+    const uint8x16_t zero = vdupq_n_u8(0);
+    for (; index + 16 <= numSamples; index += 16) {
+        // de-interleave the 3 bytes of 16 samples and re-interleave them as [0, b0, b1, b2]
+        uint8x16x3_t bytes = vld3q_u8(src + index * 3);
+        uint8x16x2_t lowWords = vzipq_u8(zero, bytes.val[0]);
+        uint8x16x2_t highWords = vzipq_u8(bytes.val[1], bytes.val[2]);
+        for (int half = 0; half < 2; half++) {
+            uint16x8x2_t words = vzipq_u16(vreinterpretq_u16_u8(lowWords.val[half]),
+                                           vreinterpretq_u16_u8(highWords.val[half]));
+            float *out = dst + index + half * 8;
+            vst1q_f32(out, vmulq_n_f32(vcvtq_f32_s32(vreinterpretq_s32_u16(words.val[0])), kInverseScale32));
+            vst1q_f32(out + 4, vmulq_n_f32(vcvtq_f32_s32(vreinterpretq_s32_u16(words.val[1])), kInverseScale32));
+        }
+    }
+#elif defined(SAMPLECONVERSION_USE_SSE2) && defined(__SSSE3__)
+    // moves the 3 bytes of 4 samples to the top of 4 int32 lanes (-1 clears the low byte)
+    const __m128i shuffle = _mm_setr_epi8(-1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11);
+    const __m128 scale = _mm_set1_ps(kInverseScale32);
+    // each 16 byte load uses 12 bytes, stay clear of the end of src
+    for (; index + 6 <= numSamples; index += 4) {
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + index * 3));
+        __m128i samples = _mm_shuffle_epi8(bytes, shuffle);
+        _mm_storeu_ps(dst + index, _mm_mul_ps(_mm_cvtepi32_ps(samples), scale));
+    }
+#endif
+    for (; index < numSamples; index++) {
+        const unsigned char *bytes = src + index * 3;
+        int32_t sample = (bytes[0] << 8) | (bytes[1] << 16) | (bytes[2] << 24);
+        dst[index] = (float) sample * kInverseScale32;
+    }
+}
+
+void convertPCM32ToFloat(const unsigned char *src, float *dst, int32_t numSamples) {
+    int32_t index = 0;
+#if defined(SAMPLECONVERSION_USE_NEON)
+    for (; index + 4 <= numSamples; index += 4) {
+        int32x4_t samples = vreinterpretq_s32_u8(vld1q_u8(src + index * 4));
+        vst1q_f32(dst + index, vmulq_n_f32(vcvtq_f32_s32(samples), kInverseScale32));
+    }
+#elif defined(SAMPLECONVERSION_USE_SSE2)
+    const __m128 scale = _mm_set1_ps(kInverseScale32);
+    for (; index + 4 <= numSamples; index += 4) {
+        __m128i samples = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + index * 4));
+        _mm_storeu_ps(dst + index, _mm_mul_ps(_mm_cvtepi32_ps(samples), scale));
+    }
+#endif
+    for (; index < numSamples; index++) {
+        int32_t sample;
+        memcpy(&sample, src + index * 4, sizeof(sample));
+        dst[index] = (float) sample * kInverseScale32;
+    }
+}
+
+} // namespace parselib
@@ -0,0 +1,41 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef _IO_WAV_SAMPLECONVERSION_H_
+#define _IO_WAV_SAMPLECONVERSION_H_
+
+#include <cstdint>
+
+namespace parselib {
+
+/*
+ * Conversion of (little endian, interleaved) WAV sample data to float.
+ * src need not be aligned. NEON / SSE2 (SSSE3 for 24-bit) is used where available.
+ */
+typedef void (*SampleConverter)(const unsigned char *src, float *dst, int32_t numSamples);
+
+/** Unsigned 8-bit, 0x80 is silence */
+void convertPCM8ToFloat(const unsigned char *src, float *dst, int32_t numSamples);
+
+/** Signed 16-bit */
+void convertPCM16ToFloat(const unsigned char *src, float *dst, int32_t numSamples);
+
+/** Signed 24-bit, packed in 3 bytes */
+void convertPCM24ToFloat(const unsigned char *src, float *dst, int32_t numSamples);
+
+/** Signed 32-bit */
+void convertPCM32ToFloat(const unsigned char *src, float *dst, int32_t numSamples);
+
+} // namespace parselib
+
+#endif // _IO_WAV_SAMPLECONVERSION_H_
@@ -0,0 +1,41 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "stream/InputStream.h"
+
+#include "WavDS64ChunkHeader.h"
+
+namespace parselib {
+
+const RiffID WavDS64ChunkHeader::RIFFID_DS64 = makeRiffID('d', 's', '6', '4');
+
+WavDS64ChunkHeader::WavDS64ChunkHeader() : WavChunkHeader(RIFFID_DS64) {
+    mRiffSize = 0;
+    mDataSize = 0;
+    mSampleCount = 0;
+}
+
+WavDS64ChunkHeader::WavDS64ChunkHeader(RiffID tag) : WavChunkHeader(tag) {
+    mRiffSize = 0;
+    mDataSize = 0;
+    mSampleCount = 0;
+}
+
+void WavDS64ChunkHeader::read(InputStream *stream) {
+    WavChunkHeader::read(stream);
+    stream->read(&mRiffSize, sizeof(mRiffSize));
+    stream->read(&mDataSize, sizeof(mDataSize));
+    stream->read(&mSampleCount, sizeof(mSampleCount));
+}
+
+} // namespace parselib
@@ -0,0 +1,45 @@
+/*
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef _IO_WAV_WAVDS64CHUNKHEADER_H_
+#define _IO_WAV_WAVDS64CHUNKHEADER_H_
+
+#include "WavChunkHeader.h"
+
+namespace parselib {
+
+class InputStream;
+
+/**
+ * The 'ds64' chunk of RF64/BW64 files. It holds the 64-bit sizes of the RIFF and 'data'
+ * chunks, whose 32-bit size fields are then set to 0xFFFFFFFF.
+ */
+class WavDS64ChunkHeader : public WavChunkHeader {
+public:
+    static const RiffID RIFFID_DS64;
+
+    RiffInt64 mRiffSize;
+    RiffInt64 mDataSize;
+    RiffInt64 mSampleCount;
+
+    WavDS64ChunkHeader();
+
+    WavDS64ChunkHeader(RiffID tag);
+
+    // The optional table of other chunk sizes is not read
+    virtual void read(InputStream *stream);
+};
+
+} // namespace parselib
+
+#endif // _IO_WAV_WAVDS64CHUNKHEADER_H_
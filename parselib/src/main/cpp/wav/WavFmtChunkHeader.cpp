@@ -64,7 +64,19 @@ void WavFmtChunkHeader::read(InputStream *stream) {
     stream->read(&mBlockAlign, sizeof(mBlockAlign));
     stream->read(&mSampleSize, sizeof(mSampleSize));
 
-    if (mEncodingId != ENCODING_PCM && mEncodingId != ENCODING_IEEE_FLOAT) {
+    if (mEncodingId == ENCODING_EXTENSIBLE) {
+        stream->read(&mExtraBytes, sizeof(mExtraBytes));
+        if (mExtraBytes >= 22) {
+            RiffInt16 validBitsPerSample;
+            RiffInt32 channelMask;
+            RiffInt16 subFormat;
+            stream->read(&validBitsPerSample, sizeof(validBitsPerSample));
+            stream->read(&channelMask, sizeof(channelMask));
+            // The first two bytes of the sub-format GUID are the Microsoft encoding ID
+            stream->read(&subFormat, sizeof(subFormat));
+            mEncodingId = subFormat;
+        }
+    } else if (mEncodingId != ENCODING_PCM && mEncodingId != ENCODING_IEEE_FLOAT) {
         // only read this if NOT PCM
         stream->read(&mExtraBytes, sizeof(mExtraBytes));
     } else {
@@ -19,6 +19,8 @@
 namespace parselib {
 
 const RiffID WavRIFFChunkHeader::RIFFID_RIFF = makeRiffID('R', 'I', 'F', 'F');
+const RiffID WavRIFFChunkHeader::RIFFID_RF64 = makeRiffID('R', 'F', '6', '4');
+const RiffID WavRIFFChunkHeader::RIFFID_BW64 = makeRiffID('B', 'W', '6', '4');
 const RiffID WavRIFFChunkHeader::RIFFID_WAVE = makeRiffID('W', 'A', 'V', 'E');
 
 WavRIFFChunkHeader::WavRIFFChunkHeader() : WavChunkHeader(RIFFID_RIFF) {
@@ -25,6 +25,9 @@ class InputStream;
 class WavRIFFChunkHeader : public WavChunkHeader {
 public:
     static const RiffID RIFFID_RIFF;
+    // 64-bit variants, sizes are in the 'ds64' chunk (EBU Tech 3306 / ITU-R BS.2088)
+    static const RiffID RIFFID_RF64;
+    static const RiffID RIFFID_BW64;
 
     static const RiffID RIFFID_WAVE;
 
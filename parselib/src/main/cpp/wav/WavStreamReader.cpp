@@ -14,6 +14,7 @@
  * limitations under the License.
  */
 #include <algorithm>
+#include <memory>
 #include <string.h>
 
 #include <android/log.h>
@@ -28,7 +29,8 @@
 
 static const char *TAG = "WavStreamReader";
 
-static constexpr int kConversionBufferFrames = 16;
+// Size of the blocks read from streams that are not memory backed
+static constexpr int kConversionBufferBytes = 64 * 1024;
 
 namespace parselib {
 
@@ -40,6 +42,10 @@ WavStreamReader::WavStreamReader(InputStream *stream) {
     mDataChunk = nullptr;
 
     mAudioDataStartPos = -1;
+    mDataSize = 0;
+    mFramePos = 0;
+
+    mConversionBufferBytes = 0;
 }
 
 int WavStreamReader::getSampleEncoding() {
@@ -69,149 +75,156 @@ int WavStreamReader::getSampleEncoding() {
 
 void WavStreamReader::parse() {
     RiffID tag;
+    std::shared_ptr<WavDS64ChunkHeader> ds64Chunk = nullptr;
 
     while (true) {
         int numRead = mStream->peek(&tag, sizeof(tag));
-        if (numRead <= 0) {
+        if (numRead < (int) sizeof(tag)) {
             break; // done
         }
+        int64_t chunkPos = mStream->getPos();
 
 //        char *tagStr = (char *) &tag;
 //        __android_log_print(ANDROID_LOG_INFO, TAG, "[%c%c%c%c]",
 //                            tagStr[0], tagStr[1], tagStr[2], tagStr[3]);
 
         std::shared_ptr<WavChunkHeader> chunk = nullptr;
-        if (tag == WavRIFFChunkHeader::RIFFID_RIFF) {
+        if (tag == WavRIFFChunkHeader::RIFFID_RIFF || tag == WavRIFFChunkHeader::RIFFID_RF64
+                || tag == WavRIFFChunkHeader::RIFFID_BW64) {
             chunk = mWavChunk = std::make_shared<WavRIFFChunkHeader>(WavRIFFChunkHeader(tag));
             mWavChunk->read(mStream);
-        } else if (tag == WavFmtChunkHeader::RIFFID_FMT) {
+            mChunkMap[tag] = chunk;
+            continue; // the sub-chunks follow
+        }
+
+        // Sizes are unsigned, 0xFFFFFFFF means "see the ds64 chunk" in RF64 files
+        int64_t bodySize;
+        if (tag == WavFmtChunkHeader::RIFFID_FMT) {
             chunk = mFmtChunk = std::make_shared<WavFmtChunkHeader>(WavFmtChunkHeader(tag));
             mFmtChunk->read(mStream);
+        } else if (tag == WavDS64ChunkHeader::RIFFID_DS64) {
+            chunk = ds64Chunk = std::make_shared<WavDS64ChunkHeader>(WavDS64ChunkHeader(tag));
+            ds64Chunk->read(mStream);
         } else if (tag == WavChunkHeader::RIFFID_DATA) {
             chunk = mDataChunk = std::make_shared<WavChunkHeader>(WavChunkHeader(tag));
             mDataChunk->read(mStream);
             // We are now positioned at the start of the audio data.
             mAudioDataStartPos = mStream->getPos();
-            mStream->advance(mDataChunk->mChunkSize);
+            mDataSize = (uint32_t) mDataChunk->mChunkSize;
+            if (mDataChunk->mChunkSize == -1 && ds64Chunk != nullptr) {
+                mDataSize = ds64Chunk->mDataSize;
+            }
         } else {
             chunk = std::make_shared<WavChunkHeader>(WavChunkHeader(tag));
             chunk->read(mStream);
-            mStream->advance(chunk->mChunkSize); // skip the body
         }
 
         mChunkMap[tag] = chunk;
-    }
 
-    if (mDataChunk != 0) {
-        mStream->setPos(mAudioDataStartPos);
+        // skip whatever of the body was not read, chunks are padded to an even size
+        bodySize = (chunk == mDataChunk) ? mDataSize : (uint32_t) chunk->mChunkSize;
+        mStream->setPos(chunkPos + 8 + bodySize + (bodySize & 1));
     }
+
+    positionToAudio();
 }
 
 // Data access
 void WavStreamReader::positionToAudio() {
     if (mDataChunk != 0) {
         mStream->setPos(mAudioDataStartPos);
+        mFramePos = 0;
     }
 }
 
-/**
- * Read and convert samples in PCM8 format to float
- */
-int WavStreamReader::getDataFloat_PCM8(float *buff, int numFrames) {
-    int numChannels = mFmtChunk->mNumChannels;
-
-    int buffOffset = 0;
-    int totalFramesRead = 0;
-
-    static constexpr int kSampleSize = sizeof(u_int8_t);
-    static constexpr float kSampleFullScale = (float)0x80;
-    static constexpr float kInverseScale = 1.0f / kSampleFullScale;
-
-    u_int8_t readBuff[kConversionBufferFrames * numChannels];
-    int framesLeft = numFrames;
-    while (framesLeft > 0) {
-        int framesThisRead = std::min(framesLeft, kConversionBufferFrames);
-        //__android_log_print(ANDROID_LOG_INFO, TAG, "read(%d)", framesThisRead);
-        int numFramesRead =
-                mStream->read(readBuff, framesThisRead *  kSampleSize * numChannels) /
-                (kSampleSize * numChannels);
-        totalFramesRead += numFramesRead;
-
-        // Convert & Scale
-        for (int offset = 0; offset < numFramesRead * numChannels; offset++) {
-            // PCM8 is unsigned, so we need to make it signed before scaling/converting
-            buff[buffOffset++] = ((float) readBuff[offset] - kSampleFullScale)
-                    * kInverseScale;
-        }
+bool WavStreamReader::seekToFrame(int64_t frame) {
+    if (mDataChunk == nullptr || mFmtChunk == nullptr || frame < 0) {
+        return false;
+    }
+    mFramePos = std::min(frame, getNumSampleFrames());
+    mStream->setPos(mAudioDataStartPos + mFramePos * getFrameSize());
+    return true;
+}
 
-        if (numFramesRead < framesThisRead) {
-            break; // none left
-        }
+const unsigned char *WavStreamReader::getAudioDataPointer() {
+    if (mDataChunk == nullptr || mAudioDataStartPos < 0) {
+        return nullptr;
+    }
 
-        framesLeft -= framesThisRead;
+    if (mDataSize > INT32_MAX) {
+        return nullptr;
     }
 
-    return totalFramesRead;
+    int64_t pos = mStream->getPos();
+    mStream->setPos(mAudioDataStartPos);
+    const unsigned char *data = mStream->peekPointer((int32_t) mDataSize);
+    mStream->setPos(pos);
+    return data;
 }
 
 /**
- * Read and convert samples in PCM16 format to float
+ * Read samples of sampleSize bytes and convert them to float with converter.
+ * Memory backed streams are converted straight out of their memory, anything else is read
+ * in large blocks.
  */
-int WavStreamReader::getDataFloat_PCM16(float *buff, int numFrames) {
+int WavStreamReader::getDataFloat_Converted(float *buff, int numFrames, int sampleSize,
+                                            SampleConverter converter) {
     int numChannels = mFmtChunk->mNumChannels;
+    int frameSize = sampleSize * numChannels;
 
-    int buffOffset = 0;
-    int totalFramesRead = 0;
+    const unsigned char *data = mStream->peekPointer(numFrames * frameSize);
+    if (data != nullptr) {
+        converter(data, buff, numFrames * numChannels);
+        mStream->advance(numFrames * frameSize);
+        return numFrames;
+    }
 
-    static constexpr int kSampleSize = sizeof(int16_t);
-    static constexpr float kSampleFullScale = (float) 0x8000;
-    static constexpr float kInverseScale = 1.0f / kSampleFullScale;
-
-    int16_t readBuff[kConversionBufferFrames * numChannels];
-    int framesLeft = numFrames;
-    while (framesLeft > 0) {
-        int framesThisRead = std::min(framesLeft, kConversionBufferFrames);
-        //__android_log_print(ANDROID_LOG_INFO, TAG, "read(%d)", framesThisRead);
-        int numFramesRead =
-                mStream->read(readBuff, framesThisRead * kSampleSize * numChannels) /
-                (kSampleSize * numChannels);
-        totalFramesRead += numFramesRead;
+    int framesPerRead = std::max(kConversionBufferBytes / frameSize, 1);
+    if (mConversionBufferBytes < framesPerRead * frameSize) {
+        mConversionBufferBytes = framesPerRead * frameSize;
+        mConversionBuffer.reset(new unsigned char[mConversionBufferBytes]);
+    }
+    unsigned char *readBuff = mConversionBuffer.get();
 
-        // Convert & Scale
-        for (int offset = 0; offset < numFramesRead * numChannels; offset++) {
-            buff[buffOffset++] = (float) readBuff[offset] * kInverseScale;
+    int totalFramesRead = 0;
+    while (totalFramesRead < numFrames) {
+        int framesThisRead = std::min(numFrames - totalFramesRead, framesPerRead);
+        int numFramesRead = mStream->read(readBuff, framesThisRead * frameSize) / frameSize;
+        if (numFramesRead <= 0) {
+            break; // none left
         }
 
+        // Convert & Scale
+        converter(readBuff, buff + (totalFramesRead * numChannels), numFramesRead * numChannels);
+        totalFramesRead += numFramesRead;
+
         if (numFramesRead < framesThisRead) {
             break; // none left
         }
-
-        framesLeft -= framesThisRead;
     }
 
     return totalFramesRead;
 }
 
 /**
- * Read and convert samples in PCM24 format to float
+ * Read and convert samples in PCM8 format to float
  */
-int WavStreamReader::getDataFloat_PCM24(float *buff, int numFrames) {
-    int numChannels = mFmtChunk->mNumChannels;
-    int numSamples = numFrames * numChannels;
-
-    static constexpr float kSampleFullScale = (float) 0x80000000;
-    static constexpr float kInverseScale = 1.0f / kSampleFullScale;
+int WavStreamReader::getDataFloat_PCM8(float *buff, int numFrames) {
+    return getDataFloat_Converted(buff, numFrames, sizeof(uint8_t), convertPCM8ToFloat);
+}
 
-    uint8_t buffer[3];
-    for(int sampleIndex = 0; sampleIndex < numSamples; sampleIndex++) {
-        if (mStream->read(buffer, 3) < 3) {
-            break; // no more data
-        }
-        int32_t sample = (buffer[0] << 8) | (buffer[1] << 16) | (buffer[2] << 24);
-        buff[sampleIndex] = (float)sample * kInverseScale;
-    }
+/**
+ * Read and convert samples in PCM16 format to float
+ */
+int WavStreamReader::getDataFloat_PCM16(float *buff, int numFrames) {
+    return getDataFloat_Converted(buff, numFrames, sizeof(int16_t), convertPCM16ToFloat);
+}
 
-    return numFrames;
+/**
+ * Read and convert samples in PCM24 format to float
+ */
+int WavStreamReader::getDataFloat_PCM24(float *buff, int numFrames) {
+    return getDataFloat_Converted(buff, numFrames, 3, convertPCM24ToFloat);
 }
 
 /**
@@ -229,47 +242,20 @@ int WavStreamReader::getDataFloat_Float32(float *buff, int numFrames) {
  * Read and convert samples in PCM32 format to float
  */
 int WavStreamReader::getDataFloat_PCM32(float *buff, int numFrames) {
-    int numChannels = mFmtChunk->mNumChannels;
-
-    int buffOffset = 0;
-    int totalFramesRead = 0;
-
-    static constexpr int kSampleSize = sizeof(int32_t);
-    static constexpr float kSampleFullScale = (float) 0x80000000;
-    static constexpr float kInverseScale = 1.0f / kSampleFullScale;
-
-    int32_t readBuff[kConversionBufferFrames * numChannels];
-    int framesLeft = numFrames;
-    while (framesLeft > 0) {
-        int framesThisRead = std::min(framesLeft, kConversionBufferFrames);
-        //__android_log_print(ANDROID_LOG_INFO, TAG, "read(%d)", framesThisRead);
-        int numFramesRead =
-                mStream->read(readBuff, framesThisRead *  kSampleSize* numChannels) /
-                    (kSampleSize * numChannels);
-        totalFramesRead += numFramesRead;
-
-        // convert & Scale
-        for (int offset = 0; offset < numFramesRead * numChannels; offset++) {
-            buff[buffOffset++] = (float) readBuff[offset] * kInverseScale;
-        }
-
-        if (numFramesRead < framesThisRead) {
-            break; // none left
-        }
-
-        framesLeft -= framesThisRead;
-    }
-
-    return totalFramesRead;
+    return getDataFloat_Converted(buff, numFrames, sizeof(int32_t), convertPCM32ToFloat);
 }
 
-int WavStreamReader::getDataFloat(float *buff, int numFrames) {
-    // __android_log_print(ANDROID_LOG_INFO, TAG, "getData(%d)", numFrames);
-
+int WavStreamReader::readFrames(float *buff, int numFrames) {
     if (mDataChunk == nullptr || mFmtChunk == nullptr) {
         return ERR_INVALID_STATE;
     }
 
+    // don't read past the data chunk into whatever chunk follows it
+    numFrames = (int) std::min((int64_t) numFrames, getNumSampleFrames() - mFramePos);
+    if (numFrames <= 0) {
+        return 0;
+    }
+
     int numFramesRead = 0;
     switch (mFmtChunk->mSampleSize) {
         case 8:
@@ -286,6 +272,7 @@ int WavStreamReader::getDataFloat(float *buff, int numFrames) {
             } else {
                 __android_log_print(ANDROID_LOG_INFO, TAG, "invalid encoding:%d mSampleSize:%d",
                                     mFmtChunk->mEncodingId, mFmtChunk->mSampleSize);
+                return ERR_INVALID_FORMAT;
             }
             break;
 
@@ -297,6 +284,7 @@ int WavStreamReader::getDataFloat(float *buff, int numFrames) {
             } else {
                 __android_log_print(ANDROID_LOG_INFO, TAG, "invalid encoding:%d mSampleSize:%d",
                                     mFmtChunk->mEncodingId, mFmtChunk->mSampleSize);
+                return ERR_INVALID_FORMAT;
             }
             break;
 
@@ -306,11 +294,24 @@ int WavStreamReader::getDataFloat(float *buff, int numFrames) {
             return ERR_INVALID_FORMAT;
     }
 
+    mFramePos += numFramesRead;
+    return numFramesRead;
+}
+
+int WavStreamReader::getDataFloat(float *buff, int numFrames) {
+    // __android_log_print(ANDROID_LOG_INFO, TAG, "getData(%d)", numFrames);
+
+    int numFramesRead = readFrames(buff, numFrames);
+    if (numFramesRead == ERR_INVALID_STATE) {
+        return numFramesRead;
+    }
+
     // Zero out any unread frames
-    if (numFramesRead < numFrames) {
+    int numValidFrames = std::max(numFramesRead, 0);
+    if (numValidFrames < numFrames) {
         int numChannels = getNumChannels();
-        memset(buff + (numFramesRead * numChannels), 0,
-                (numFrames - numFramesRead) * sizeof(buff[0]) * numChannels);
+        memset(buff + (numValidFrames * numChannels), 0,
+                (numFrames - numValidFrames) * sizeof(buff[0]) * numChannels);
     }
 
     return numFramesRead;
@@ -16,11 +16,15 @@
 #ifndef _IO_WAV_WAVSTREAMREADER_H_
 #define _IO_WAV_WAVSTREAMREADER_H_
 
+#include <cstdint>
 #include <map>
+#include <memory>
 
 #include "AudioEncoding.h"
 #include "WavRIFFChunkHeader.h"
 #include "WavFmtChunkHeader.h"
+#include "WavDS64ChunkHeader.h"
+#include "SampleConversion.h"
 
 /*
  * WAV format documentation can be found:
@@ -37,8 +41,9 @@ public:
 
     int getSampleRate() { return mFmtChunk->mSampleRate; }
 
-    int getNumSampleFrames() {
-        return mDataChunk->mChunkSize / (mFmtChunk->mSampleSize / 8) / mFmtChunk->mNumChannels;
+    int64_t getNumSampleFrames() {
+        int frameSize = getFrameSize();
+        return frameSize > 0 ? mDataSize / frameSize : 0;
     }
 
     int getNumChannels() { return mFmtChunk != 0 ? mFmtChunk->mNumChannels : 0; }
@@ -47,6 +52,11 @@ public:
 
     int getBitsPerSample() { return mFmtChunk->mSampleSize; }
 
+    /** Size of one (multi-channel) sample frame in bytes */
+    int getFrameSize() {
+        return mFmtChunk != 0 ? (mFmtChunk->mSampleSize / 8) * mFmtChunk->mNumChannels : 0;
+    }
+
     void parse();
 
     // Data access
@@ -55,8 +65,33 @@ public:
     static constexpr int ERR_INVALID_FORMAT    = -1;
     static constexpr int ERR_INVALID_STATE    = -2;
 
+    /**
+     * Reads and converts numFrames frames (or all that are left) like readFrames(), and zeroes
+     * the frames that could not be read. Returns the number of frames read or an ERR_ code.
+     */
     int getDataFloat(float *buff, int numFrames);
 
+    /*
+     * Streaming access: pull the audio data through a small buffer instead of loading it
+     * whole. readFrames() continues where the last read or seekToFrame() left off and stops
+     * at the end of the data chunk.
+     */
+    /** Returns the number of frames read (0 at the end of the data) or an ERR_ code */
+    int readFrames(float *buff, int numFrames);
+
+    /** Positions the stream at frame (clipped to the end of the data) */
+    bool seekToFrame(int64_t frame);
+
+    /** The frame readFrames() will read next */
+    int64_t getFramePosition() { return mFramePos; }
+
+    /**
+     * Returns a pointer to the raw (unconverted) audio data, in the encoding reported by
+     * getSampleEncoding(), if the stream is memory backed and holds the whole data chunk.
+     * Otherwise returns nullptr. Does not change the read position.
+     */
+    const unsigned char *getAudioDataPointer();
+
     // int getData16(short *buff, int numFramees);
 
 protected:
@@ -66,11 +101,20 @@ protected:
     std::shared_ptr<WavFmtChunkHeader> mFmtChunk;
     std::shared_ptr<WavChunkHeader> mDataChunk;
 
-    long mAudioDataStartPos;
+    int64_t mAudioDataStartPos;
+    int64_t mDataSize;  // from the 'data' chunk, or the 'ds64' chunk for RF64
+    int64_t mFramePos;
 
     std::map<RiffID, std::shared_ptr<WavChunkHeader>> mChunkMap;
 
 private:
+    // Blocks read from streams that are not memory backed, allocated on the first such read
+    std::unique_ptr<unsigned char[]> mConversionBuffer;
+    int mConversionBufferBytes;
+
+    int getDataFloat_Converted(float *buff, int numFrames, int sampleSize,
+                               SampleConverter converter);
+
     /*
      * Individual Format Readers/Converters
      */
@@ -24,6 +24,7 @@ namespace parselib {
 typedef unsigned int RiffID;    // A "four character code" (i.e. FOURCC)
 typedef int RiffInt32;          // A 32-bit signed integer
 typedef short RiffInt16;        // A 16-bit signed integer
+typedef long long RiffInt64;    // A 64-bit signed integer
 
 /*
  * Packs the specified characters into a 32-bit value in accordance with the Microsoft
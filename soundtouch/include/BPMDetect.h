@@ -19,6 +19,8 @@
 /// - After whole sound data file has been analyzed as above, the bpm level is
 ///   detected by function 'getBpm' that finds the highest peak of the autocorrelation
 ///   function, calculates it's precise location and converts this reading to bpm's.
+/// - Alternatively, function 'analyze' takes a whole decoded song at once and
+///   calculates the same autocorrelations with FFTs in several threads.
 ///
 /// Author        : Copyright (c) Olli Parviainen
 /// Author e-mail : oparviai 'at' iki.fi
@@ -163,6 +165,32 @@ namespace soundtouch
         // Detect individual beat positions
         void updateBeatPos(int process_samples);
 
+        /// Scale of the beat correlations of the next update, compensates for the
+        /// correlations missing at the beginning of the song
+        float getBeatScale(int skipstep);
+
+        /// Updates beat detection with the beat correlation of the next decimated
+        /// sample position
+        void detectBeat(float corr, float scale, int skipstep, double posScale, int resetDur);
+
+        /// Clears the results and the state of earlier input
+        void reset();
+
+#ifdef SOUNDTOUCH_FLOAT_SAMPLES
+        /// Calculates the correlations of the update blocks 'first' ... 'last - 1'
+        /// of 'numBlocks' for 'analyze': the decayed sum of the absolute auto-
+        /// correlations to 'xcorrSum', and the positive beat correlations of the
+        /// decimated positions from 'first * skipstep' on to 'beatSum'.
+        void analyzeBlocks(const float *data,
+            int numBlocks,
+            int first,
+            int last,
+            const class CorrelationFFT &fft,
+            float *xcorrSum,
+            float *beatSum
+        ) const;
+#endif
+
 
     public:
         /// Constructor.
@@ -183,6 +211,18 @@ namespace soundtouch
             int numSamples                            ///< Number of samples in buffer
         );
 
+        /// Analyzes a whole song at once, instead of inputting it in blocks with
+        /// 'inputSamples'. Gives the same results, but calculates the autocorrelations
+        /// with FFTs and splits the song to 'numThreads' threads (0 = one per CPU core),
+        /// which is many times faster. Clears the results of any earlier input, read
+        /// the new results with 'getBpm' and 'getBeats'.
+        ///
+        /// Integer sample builds input the song to 'inputSamples' instead.
+        void analyze(const soundtouch::SAMPLETYPE *samples,    ///< Pointer to the whole song data
+            int numSamples,                           ///< Number of sample frames in the song
+            int numThreads = 0                        ///< Number of threads to use
+        );
+
         /// Analyzes the results and returns the BPM rate. Use this function to read result
         /// after whole song data has been input to the class by consecutive calls of
         /// 'inputSamples' function.
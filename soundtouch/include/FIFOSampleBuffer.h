@@ -47,6 +47,12 @@ namespace soundtouch
 /// Sample buffer working in FIFO (first-in-first-out) principle. The class takes
 /// care of storage size adjustment and data moving during input/output operations.
 ///
+/// Where the platform allows (Linux & Android), the storage is a ring buffer whose
+/// memory is mapped twice in consecutive virtual addresses, so that the samples
+/// are contiguous in memory also across the wrap-around point and never need
+/// to be moved. Otherwise the samples are moved to the beginning of the storage
+/// when new samples are inserted.
+///
 /// Notice that in case of stereo audio, one sample is considered to consist of
 /// both channel data.
 class FIFOSampleBuffer : public FIFOSamplePipe
@@ -62,21 +68,29 @@ private:
     /// Sample buffer size in bytes
     uint sizeInBytes;
 
+    /// True if 'buffer' is a mirrored ring buffer mapping of 2 * 'sizeInBytes'
+    /// bytes, where the second half maps the same memory as the first half.
+    bool mirrored;
+
     /// How many samples are currently in buffer.
     uint samplesInBuffer;
 
     /// Channels, 1=mono, 2=stereo.
     uint channels;
 
-    /// Current position pointer to the buffer. This pointer is increased when samples are
-    /// removed from the pipe so that it's necessary to actually rewind buffer (move data)
-    /// only new data when is put to the pipe.
+    /// Current position pointer to the buffer, in SAMPLETYPE units. This pointer is
+    /// increased when samples are removed from the pipe so that it's necessary to
+    /// actually rewind buffer (move data) only new data when is put to the pipe. With
+    /// the mirrored buffer it wraps around at the end of the first half instead.
     uint bufferPos;
 
     /// Rewind the buffer by moving data from position pointed by 'bufferPos' to real
-    /// beginning of the buffer.
+    /// beginning of the buffer. Not needed for the mirrored buffer.
     void rewind();
 
+    /// Releases the current storage.
+    void freeBuffer();
+
     /// Ensures that the buffer has capacity for at least this many samples.
     void ensureCapacity(uint capacityRequirement);
 
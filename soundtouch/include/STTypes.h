@@ -145,6 +145,9 @@ namespace soundtouch
             #endif
         #endif
 
+        // AVX2 and NEON routines are for float samples only
+        #undef SOUNDTOUCH_ALLOW_AVX2
+
     #else
 
         // floating point samples
@@ -158,6 +161,18 @@ namespace soundtouch
             #define SOUNDTOUCH_ALLOW_SSE       1
         #endif
 
+        // AVX2 optimizations are enabled by the build system defining
+        // SOUNDTOUCH_ALLOW_AVX2 when it can compile 'avx2_optimized.cpp' with
+        // AVX2 & FMA, which requires GCC or Clang vector extensions.
+        #if !(defined(SOUNDTOUCH_ALLOW_X86_OPTIMIZATIONS) && defined(__GNUC__))
+            #undef SOUNDTOUCH_ALLOW_AVX2
+        #endif
+
+        #if defined(SOUNDTOUCH_USE_NEON) && defined(__GNUC__) && (defined(__ARM_NEON) || defined(__ARM_NEON__))
+            // Allow NEON optimizations
+            #define SOUNDTOUCH_ALLOW_NEON      1
+        #endif
+
     #endif  // SOUNDTOUCH_INTEGER_SAMPLES
 
     #if ((SOUNDTOUCH_ALLOW_SSE) || (__SSE__) || (SOUNDTOUCH_USE_NEON))
@@ -165,6 +165,23 @@ namespace soundtouch
 #define SETTING_INITIAL_LATENCY             8
 
 
+/// Enable/disable calculating the correlations of the (non-quick) seeking algorithm
+/// with FFTs, for seek windows & overlaps long enough for that to be faster. Gives
+/// the same result as the direct calculation within float rounding, for floating
+/// point samples only. Enabled by default.
+#define SETTING_USE_FFT_CORRELATION         9
+
+/// Interpolation algorithm of the rate transposer of this instance, one of the
+/// TransposerBase::ALGORITHM values (0 = linear, 1 = cubic, 2 = shannon,
+/// 3 = polyphase). Defaults to the algorithm set with TransposerBase::setAlgorithm()
+/// when the instance was created. Can be changed while processing, the
+/// interpolator restarts from the current position. Switching between linear and
+/// the last other algorithm used doesn't allocate, e.g. to drop to linear under
+/// load from the audio thread. Integer sample builds always interpolate linearly
+/// and ignore this setting.
+#define SETTING_INTERPOLATION               10
+
+
 class SoundTouch : public FIFOProcessor
 {
 private:
@@ -306,6 +323,22 @@ public:
     virtual uint receiveSamples(uint maxSamples   ///< Remove this many samples from the beginning of pipe.
         ) override;
 
+    /// Gives direct access to the processed samples that are ready for output,
+    /// without copying them. The samples are contiguous in memory and stay valid
+    /// until the next call of a function that processes or receives samples.
+    /// Call 'consume' to remove the samples from the output after use.
+    ///
+    /// \return Number of samples available at 'samples'.
+    uint peekOutput(const SAMPLETYPE **samples  ///< Receives pointer to the first output sample.
+        );
+
+    /// Removes 'maxSamples' samples from the beginning of the output after
+    /// accessing them with 'peekOutput'. Same as 'receiveSamples(maxSamples)'.
+    ///
+    /// \return Number of samples removed.
+    uint consume(uint maxSamples    ///< How many samples to remove at max.
+        );
+
     /// Clears all the samples in the object's output and internal processing
     /// buffers.
     virtual void clear() override;
@@ -328,6 +361,34 @@ public:
     /// Returns number of samples currently unprocessed.
     virtual uint numUnprocessedSamples() const;
 
+    /// Returns how many of the samples put in have not come out yet, in input
+    /// samples: the distance from the input position back to the position that
+    /// the next output sample stands for. Counts the samples buffered anywhere
+    /// in the pipeline, also inside the current time-stretch sequence, and is
+    /// exact over time for a steady tempo & rate.
+    double getPendingInputSamples() const;
+
+    /// Aligns this instance to 'reference', which processes another stream with the
+    /// same settings, e.g. a track played in sync with it: this instance restarts
+    /// at the input position of 'reference' and from then on splices its stream at
+    /// the same positions, so that its output lines up sample by sample with that
+    /// of 'reference' (up to rounding when the rate isn't 1).
+    ///
+    /// Clears this instance and returns how many input samples to put next, the
+    /// ones that end where the input of 'reference' ends so far, then call
+    /// finishAlignment(). Returns 0 when the instances can't be aligned, because
+    /// their settings differ or 'reference' doesn't remember its stream that far
+    /// back (see SEQUENCE_HISTORY).
+    uint prepareAlignment(const SoundTouch &reference);
+
+    /// Returns true if this instance processes with the same settings as
+    /// 'reference', which prepareAlignment() needs
+    bool isAlignableTo(const SoundTouch &reference) const;
+
+    /// Completes prepareAlignment() once its input is put. Returns false if the
+    /// input didn't line up, the instance then has to be cleared.
+    bool finishAlignment(const SoundTouch &reference);
+
     /// Return number of channels
     uint numChannels() const
     {
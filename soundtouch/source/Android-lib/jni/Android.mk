@@ -8,11 +8,13 @@ LOCAL_C_INCLUDES += $(LOCAL_PATH)/../../../include $(LOCAL_PATH)/../../SoundStre
 LOCAL_MODULE    := soundtouch
 LOCAL_SRC_FILES := soundtouch-jni.cpp ../../SoundTouch/AAFilter.cpp  ../../SoundTouch/FIFOSampleBuffer.cpp \
                 ../../SoundTouch/FIRFilter.cpp ../../SoundTouch/cpu_detect_x86.cpp \
-                ../../SoundTouch/sse_optimized.cpp ../../SoundStretch/WavFile.cpp \
+                ../../SoundTouch/sse_optimized.cpp ../../SoundTouch/neon_optimized.cpp \
+                ../../SoundStretch/WavFile.cpp \
                 ../../SoundTouch/RateTransposer.cpp ../../SoundTouch/SoundTouch.cpp \
                 ../../SoundTouch/InterpolateCubic.cpp ../../SoundTouch/InterpolateLinear.cpp \
-                ../../SoundTouch/InterpolateShannon.cpp ../../SoundTouch/TDStretch.cpp \
-                ../../SoundTouch/BPMDetect.cpp ../../SoundTouch/PeakFinder.cpp 
+                ../../SoundTouch/InterpolateShannon.cpp ../../SoundTouch/InterpolatePolyphase.cpp ../../SoundTouch/TDStretch.cpp \
+                ../../SoundTouch/BPMDetect.cpp ../../SoundTouch/PeakFinder.cpp \
+                ../../SoundTouch/CorrelationFFT.cpp 
 
 # for native audio
 LOCAL_SHARED_LIBRARIES += -lgcc 
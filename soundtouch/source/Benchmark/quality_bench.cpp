@@ -0,0 +1,710 @@
+////////////////////////////////////////////////////////////////////////////////
+///
+/// Quality and cost benchmark of SoundTouch processing configurations.
+///
+/// Runs synthetic test signals (a sine sweep, a drum loop, a speech-like voice
+/// and a dense mix) through a set of SoundTouch configurations at a grid of
+/// tempo & pitch changes. The signals are generated from parameters, so the
+/// ideal tempo/pitch changed version of each can be generated as well and
+/// the output is measured against it:
+///
+/// - ns/sample : processing time per input sample
+/// - lsd       : log-spectral distance to the ideal output in dB, average
+///               over 2048 sample frames
+/// - smear     : average extra attack time of the drum hits in milliseconds
+/// - jitter    : average timing error of the drum hits in milliseconds
+/// - lost      : percentage of drum hits weakened by more than 6 dB
+///
+/// soundtouch_quality_bench [seconds] [-csv]
+///
+////////////////////////////////////////////////////////////////////////////////
+//
+// License :
+//
+//  SoundTouch audio processing library
+//  Copyright (c) Olli Parviainen
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU Lesser General Public
+//  License as published by the Free Software Foundation; either
+//  version 2.1 of the License, or (at your option) any later version.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include "SoundTouch.h"
+#include "../SoundTouch/CorrelationFFT.h"
+#include "../SoundTouch/RateTransposer.h"
+
+using namespace soundtouch;
+using namespace std;
+
+#define SAMPLE_RATE     44100
+#define CHANNELS        2
+#define BUFF_SIZE       6720
+
+// Drum & mix signal tempo, one hit per eighth note
+#define SIGNAL_BPM      120
+#define STEP_SECONDS    (60.0 / SIGNAL_BPM / 2)
+
+// Spectral distortion frames, and the level below the average spectrum level
+// at which differences are ignored
+#define LSD_FRAME       2048
+#define LSD_HOP         512
+#define LSD_FLOOR       1e-6
+
+// Block length of the transient envelope
+#define ENV_BLOCK       32
+
+enum SignalType
+{
+    SWEEP,
+    DRUMS,
+    SPEECH,
+    MIX
+};
+
+struct Signal
+{
+    const char *name;
+    SignalType type;
+    bool transients;    // has drum hits for the transient measures
+};
+
+static const Signal signals[] =
+{
+    { "sweep",  SWEEP,  false },
+    { "drums",  DRUMS,  true  },
+    { "speech", SPEECH, false },
+    { "mix",    MIX,    true  },
+};
+
+struct Config
+{
+    const char *name;
+    int sequenceMs;     // 0 = automatic
+    int seekWindowMs;   // 0 = automatic
+    int overlapMs;
+    bool quickSeek;
+    int aaFilterLength;
+    TransposerBase::ALGORITHM interpolator;
+    bool transposerOnly;    // differs from 'auto' only by the rate transposer
+};
+
+// 'auto' is the library default. The rest change one thing each: the time-stretch
+// parameters, or the anti-alias filter and the interpolator, which are used
+// only when the pitch changes.
+static const Config configs[] =
+{
+    { "auto",       0,  0,  8,  false, 64,  TransposerBase::POLYPHASE, false },
+    { "quickseek",  0,  0,  8,  true,  64,  TransposerBase::POLYPHASE, false },
+    { "speech",     40, 15, 8,  false, 64,  TransposerBase::POLYPHASE, false },
+    { "long-seq",   82, 28, 12, false, 64,  TransposerBase::POLYPHASE, false },
+    { "overlap-16", 0,  0,  16, false, 64,  TransposerBase::POLYPHASE, false },
+    { "aa-32",      0,  0,  8,  false, 32,  TransposerBase::POLYPHASE, true  },
+    { "aa-128",     0,  0,  8,  false, 128, TransposerBase::POLYPHASE, true  },
+    { "linear",     0,  0,  8,  false, 64,  TransposerBase::LINEAR,    true  },
+    { "cubic",      0,  0,  8,  false, 64,  TransposerBase::CUBIC,     true  },
+    { "shannon",    0,  0,  8,  false, 64,  TransposerBase::SHANNON,   true  },
+};
+
+struct GridPoint
+{
+    double tempo;
+    double pitchSemiTones;
+};
+
+static const GridPoint grid[] =
+{
+    { 0.5,  0 },
+    { 0.8,  0 },
+    { 1.25, 0 },
+    { 2.0,  0 },
+    { 1.0, -7 },
+    { 1.0, -2 },
+    { 1.0,  3 },
+    { 1.0,  7 },
+    { 0.8,  2 },
+};
+
+struct Result
+{
+    double nsPerSample;
+    double lsd;
+    double smear;
+    double jitter;
+    double lost;
+};
+
+
+//////////////////////////////////////////////////////////////////////////////
+//
+// Test signals. Each is rendered from a 'score' at the given tempo & pitch
+// change, so the same function gives both the input (1, 1) and the ideal
+// output: score time runs 'tempo' times faster and all frequencies are
+// multiplied by 'pitch'. Drum hits keep their own length, as a time-stretch
+// should keep them.
+
+// Sine partials from 'start' to 'end' seconds, with linear fades and an
+// exponential decay (decay 0 = none), all in output seconds
+static void addPartials(vector<float> &out, double start, double end, const double *freqs,
+                        const double *amps, int count, double fade, double decay)
+{
+    int first = max(0, (int)ceil(start * SAMPLE_RATE));
+    int last = min((int)out.size(), (int)ceil(end * SAMPLE_RATE));
+
+    for (int n = first; n < last; n ++)
+    {
+        double t = (double)n / SAMPLE_RATE - start;
+        double gain = min(1.0, min(t, end - start - t) / fade);
+        if (decay > 0) gain *= exp(-t / decay);
+
+        double sum = 0;
+        for (int k = 0; k < count; k ++)
+        {
+            sum += amps[k] * sin(2 * M_PI * freqs[k] * t);
+        }
+        out[n] += (float)(gain * sum);
+    }
+}
+
+
+// Pseudo random numbers in [0, 1[ for a repeatable signal
+static double random01(uint &seed)
+{
+    seed = seed * 1664525u + 1013904223u;
+    return (double)(seed >> 8) / (1 << 24);
+}
+
+
+// One drum step starting at 'start' output seconds: hihat, plus a kick or a snare
+static void addDrumHit(vector<float> &out, double start, int step, double pitch, double gain)
+{
+    const int bar = step % 8;
+    int first = max(0, (int)ceil(start * SAMPLE_RATE));
+    int last = min((int)out.size(), first + (int)(0.4 * SAMPLE_RATE));
+
+    // inharmonic partials of the hihat (an analog drum machine recipe) and of the snare rattle
+    static const double hatFreqs[] = { 2053, 3044, 3696, 5227, 5400, 8000 };
+    double snareFreqs[24];
+    double snarePhases[24];
+    uint seed = 12345;
+    for (int k = 0; k < 24; k ++)
+    {
+        snareFreqs[k] = 1000 + 6000 * random01(seed);
+        snarePhases[k] = 2 * M_PI * random01(seed);
+    }
+
+    const bool kick = (bar == 0 || bar == 3 || bar == 4);
+    const bool snare = (bar == 2 || bar == 6);
+
+    for (int n = first; n < last; n ++)
+    {
+        double t = (double)n / SAMPLE_RATE - start;
+        double sum = 0;
+
+        if (t < 0.1)
+        {
+            double hat = 0;
+            for (double f : hatFreqs) hat += sin(2 * M_PI * f * pitch * t);
+            sum += 0.04 * hat * exp(-t / 0.03);
+        }
+        if (kick)
+        {
+            // pitch drops from 135 to 45 Hz
+            double phase = 2 * M_PI * pitch * (45 * t + 90 * 0.04 * (1 - exp(-t / 0.04)));
+            sum += 0.6 * sin(phase) * exp(-t / 0.2);
+        }
+        if (snare)
+        {
+            double body = sin(2 * M_PI * 185 * pitch * t) + sin(2 * M_PI * 330 * pitch * t);
+            double rattle = 0;
+            for (int k = 0; k < 24; k ++) rattle += sin(2 * M_PI * snareFreqs[k] * pitch * t + snarePhases[k]);
+            sum += 0.25 * body * exp(-t / 0.07) + 0.04 * rattle * exp(-t / 0.06);
+        }
+        out[n] += (float)(gain * sum);
+    }
+}
+
+
+static void renderDrums(vector<float> &out, double tempo, double pitch, double scoreLength, double gain)
+{
+    for (int step = 0; step * STEP_SECONDS < scoreLength; step ++)
+    {
+        addDrumHit(out, step * STEP_SECONDS / tempo, step, pitch, gain);
+    }
+}
+
+
+// Exponential sine sweep from 50 Hz to 12 kHz over the whole signal
+static void renderSweep(vector<float> &out, double tempo, double pitch, double scoreLength)
+{
+    double phase = 0;
+    for (size_t n = 0; n < out.size(); n ++)
+    {
+        double s = (double)n * tempo / SAMPLE_RATE;
+        double freq = 50 * pow(12000.0 / 50, s / scoreLength) * pitch;
+        out[n] = (float)(0.5 * sin(phase));
+        phase = fmod(phase + 2 * M_PI * freq / SAMPLE_RATE, 2 * M_PI);
+    }
+}
+
+
+// Voice-like signal: syllables of vowels with moving formants, sung on a
+// gliding pitch. The formants move with the pitch change, as in the
+// SoundTouch output.
+static void renderSpeech(vector<float> &out, double tempo, double pitch)
+{
+    static const double formants[5][3] =
+    {
+        { 730, 1090, 2440 },    // a
+        { 530, 1840, 2480 },    // e
+        { 270, 2290, 3010 },    // i
+        { 570, 840,  2410 },    // o
+        { 300, 870,  2240 },    // u
+    };
+    const double syllable = 0.25;
+    const int maxHarmonics = 48;
+    double amps[maxHarmonics] = { 0 };
+    double phase = 0;
+
+    for (size_t n = 0; n < out.size(); n ++)
+    {
+        double s = (double)n * tempo / SAMPLE_RATE;
+        int index = (int)(s / syllable);
+        double pos = s / syllable - index;
+        double f0 = 110 + 25 * sin(2 * M_PI * 0.5 * s) + 10 * sin(2 * M_PI * 3.1 * s);
+
+        // voiced 70% of each syllable, every sixth syllable is a pause
+        double env = (index % 6 == 5 || pos > 0.7) ? 0 : pow(sin(M_PI * pos / 0.7), 2);
+
+        if (n % 64 == 0)
+        {
+            // harmonic amplitudes from the formant envelope, gliding to the next vowel
+            const double *v0 = formants[index % 5];
+            const double *v1 = formants[(index + 1) % 5];
+            double glide = max(0.0, pos - 0.4) / 0.3;
+            for (int k = 1; k < maxHarmonics; k ++)
+            {
+                double f = k * f0;
+                double a = 0;
+                for (int i = 0; i < 3; i ++)
+                {
+                    double formant = v0[i] + glide * (v1[i] - v0[i]);
+                    double d = (f - formant) / (60 + 0.05 * formant);
+                    a += (1.0 - 0.3 * i) / (1 + d * d);
+                }
+                amps[k] = (f < 4000) ? a / sqrt((double)k) : 0;
+            }
+        }
+
+        double sum = 0;
+        if (env > 0)
+        {
+            for (int k = 1; k < maxHarmonics; k ++)
+            {
+                if (amps[k] > 0) sum += amps[k] * sin(k * phase);
+            }
+        }
+        out[n] = (float)(0.15 * env * sum);
+        phase = fmod(phase + 2 * M_PI * f0 * pitch / SAMPLE_RATE, 2 * M_PI);
+    }
+}
+
+
+// Drums, bass and chords
+static void renderMix(vector<float> &out, double tempo, double pitch, double scoreLength)
+{
+    static const double bassNotes[4] = { 55.0, 55.0, 65.41, 49.0 };
+    static const double chords[4][3] =
+    {
+        { 220.0, 261.63, 329.63 },
+        { 174.61, 220.0, 261.63 },
+        { 261.63, 329.63, 392.0 },
+        { 196.0, 246.94, 293.66 },
+    };
+
+    renderDrums(out, tempo, pitch, scoreLength, 0.6);
+
+    // bass note every quarter, decaying in score time
+    for (int i = 0; i * 2 * STEP_SECONDS < scoreLength; i ++)
+    {
+        double f = bassNotes[(i / 2) % 4] * pitch;
+        double freqs[3] = { f, 2 * f, 3 * f };
+        double amps[3] = { 0.25, 0.12, 0.06 };
+        double start = i * 2 * STEP_SECONDS / tempo;
+        addPartials(out, start, start + 2 * STEP_SECONDS / tempo, freqs, amps, 3, 0.005, 0.4 / tempo);
+    }
+
+    // sustained chord every bar
+    for (int i = 0; i * 8 * STEP_SECONDS < scoreLength; i ++)
+    {
+        double freqs[18];
+        double amps[18];
+        for (int note = 0; note < 3; note ++)
+        {
+            for (int k = 0; k < 6; k ++)
+            {
+                freqs[6 * note + k] = chords[i % 4][note] * (k + 1) * pitch;
+                amps[6 * note + k] = 0.05 / (k + 1);
+            }
+        }
+        double start = i * 8 * STEP_SECONDS / tempo;
+        addPartials(out, start, start + 8 * STEP_SECONDS / tempo, freqs, amps, 18, 0.02, 0);
+    }
+}
+
+
+// Renders 'signal' at the given tempo & pitch change, mono
+static vector<float> render(const Signal &signal, double seconds, double tempo, double pitchSemiTones)
+{
+    vector<float> out((size_t)(seconds * SAMPLE_RATE / tempo + 0.5), 0.0f);
+    double pitch = pow(2.0, pitchSemiTones / 12);
+
+    switch (signal.type)
+    {
+        case SWEEP:
+            renderSweep(out, tempo, pitch, seconds);
+            break;
+
+        case DRUMS:
+            renderDrums(out, tempo, pitch, seconds, 1.0);
+            break;
+
+        case SPEECH:
+            renderSpeech(out, tempo, pitch);
+            break;
+
+        case MIX:
+            renderMix(out, tempo, pitch, seconds);
+            break;
+    }
+    return out;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+//
+// Processing & measures
+
+// Processes the stereo signal, returns the left channel of the output and the
+// processing time in seconds
+static double process(const vector<float> &input, const Config &config, const GridPoint &point,
+                      vector<float> &output)
+{
+    // the transposer is created with the SoundTouch instance
+    TransposerBase::setAlgorithm(config.interpolator);
+    SoundTouch soundTouch;
+    TransposerBase::setAlgorithm(TransposerBase::POLYPHASE);
+
+    float buffer[BUFF_SIZE];
+    int numFrames = (int)(input.size() / CHANNELS);
+
+    soundTouch.setSampleRate(SAMPLE_RATE);
+    soundTouch.setChannels(CHANNELS);
+    soundTouch.setTempo(point.tempo);
+    soundTouch.setPitchSemiTones(point.pitchSemiTones);
+    soundTouch.setSetting(SETTING_SEQUENCE_MS, config.sequenceMs);
+    soundTouch.setSetting(SETTING_SEEKWINDOW_MS, config.seekWindowMs);
+    soundTouch.setSetting(SETTING_OVERLAP_MS, config.overlapMs);
+    soundTouch.setSetting(SETTING_USE_QUICKSEEK, config.quickSeek);
+    soundTouch.setSetting(SETTING_AA_FILTER_LENGTH, config.aaFilterLength);
+    output.clear();
+
+    auto receive = [&]()
+    {
+        int n;
+        while ((n = soundTouch.receiveSamples(buffer, BUFF_SIZE / CHANNELS)) != 0)
+        {
+            for (int i = 0; i < n; i ++) output.push_back(buffer[CHANNELS * i]);
+        }
+    };
+
+    auto start = chrono::steady_clock::now();
+    for (int i = 0; i < numFrames; i += BUFF_SIZE / CHANNELS)
+    {
+        soundTouch.putSamples(&input[CHANNELS * i], min(BUFF_SIZE / CHANNELS, numFrames - i));
+        receive();
+    }
+    soundTouch.flush();
+    receive();
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+
+// Average log-spectral distance of 'output' to 'reference' in dB
+static double spectralDistortion(const vector<float> &reference, const vector<float> &output)
+{
+    CorrelationFFT fft;
+    fft.setSize(LSD_FRAME);
+
+    vector<float> window(LSD_FRAME);
+    double windowPower = 0;
+    for (int i = 0; i < LSD_FRAME; i ++)
+    {
+        window[i] = (float)(0.5 - 0.5 * cos(2 * M_PI * (i + 0.5) / LSD_FRAME));
+        windowPower += (double)window[i] * window[i];
+    }
+
+    // differences this far below the average spectrum level don't count
+    double power = 0;
+    for (float x : reference) power += (double)x * x;
+    const double floor = LSD_FLOOR * windowPower * power / max<size_t>(1, reference.size()) + 1e-20;
+
+    vector<float> refRe(LSD_FRAME), refIm(LSD_FRAME), outRe(LSD_FRAME), outIm(LSD_FRAME);
+    const size_t length = min(reference.size(), output.size());
+    double sum = 0;
+    int numFrames = 0;
+
+    for (size_t pos = 0; pos + LSD_FRAME <= length; pos += LSD_HOP)
+    {
+        for (int i = 0; i < LSD_FRAME; i ++)
+        {
+            refRe[i] = reference[pos + i] * window[i];
+            outRe[i] = output[pos + i] * window[i];
+        }
+        fill(refIm.begin(), refIm.end(), 0.0f);
+        fill(outIm.begin(), outIm.end(), 0.0f);
+        fft.forward(refRe.data(), refIm.data());
+        fft.forward(outRe.data(), outIm.data());
+
+        // the bins are in a permuted order, but the same for both
+        double frameSum = 0;
+        for (int k = 0; k < LSD_FRAME; k ++)
+        {
+            double ref = (double)refRe[k] * refRe[k] + (double)refIm[k] * refIm[k] + floor;
+            double out = (double)outRe[k] * outRe[k] + (double)outIm[k] * outIm[k] + floor;
+            double d = 10 * log10(out / ref);
+            frameSum += d * d;
+        }
+        sum += sqrt(frameSum / LSD_FRAME);
+        numFrames ++;
+    }
+    return numFrames ? sum / numFrames : 0;
+}
+
+
+// Envelope of the high-passed signal in ENV_BLOCK blocks, follows the hihat &
+// snare attacks without the kick & bass tails
+static vector<float> transientEnvelope(const vector<float> &signal)
+{
+    vector<float> env(signal.size() / ENV_BLOCK);
+    for (size_t b = 0; b < env.size(); b ++)
+    {
+        double sum = 0;
+        for (size_t i = b * ENV_BLOCK; i < (b + 1) * ENV_BLOCK; i ++)
+        {
+            double d = signal[i] - (i ? signal[i - 1] : 0.0f);
+            sum += d * d;
+        }
+        env[b] = (float)sqrt(sum / ENV_BLOCK);
+    }
+    return env;
+}
+
+
+// Peak block of 'env' in [first, last[, and the 10% to 90% rise time before it in blocks
+static int findAttack(const vector<float> &env, int first, int last, float &peak, int &rise)
+{
+    first = max(first, 1);
+    last = min(last, (int)env.size());
+    int peakBlock = first;
+    peak = 0;
+    for (int b = first; b < last; b ++)
+    {
+        if (env[b] > peak)
+        {
+            peak = env[b];
+            peakBlock = b;
+        }
+    }
+
+    int b90 = peakBlock;
+    while (b90 > first && env[b90 - 1] >= 0.9f * peak) b90 --;
+    int b10 = b90;
+    while (b10 > first && env[b10 - 1] >= 0.1f * peak) b10 --;
+    rise = b90 - b10;
+    return peakBlock;
+}
+
+
+// Attack smearing, timing error & lost hits of the drum steps in 'output'
+static void measureTransients(const vector<float> &reference, const vector<float> &output, double tempo,
+                              Result &result)
+{
+    vector<float> refEnv = transientEnvelope(reference);
+    vector<float> outEnv = transientEnvelope(output);
+    const double blocksPerSecond = (double)SAMPLE_RATE / ENV_BLOCK;
+    const double stepBlocks = STEP_SECONDS / tempo * blocksPerSecond;
+
+    // the output hits may move by a part of the stretch sequence
+    const int searchBlocks = (int)min(0.1 * blocksPerSecond, 0.4 * stepBlocks);
+    double smear = 0;
+    double jitter = 0;
+    int numHits = 0;
+    int numLost = 0;
+
+    for (int step = 1; (step + 1) * stepBlocks < min(refEnv.size(), outEnv.size()); step ++)
+    {
+        int expected = (int)(step * stepBlocks);
+        float refPeak, outPeak;
+        int refRise, outRise;
+        int refPos = findAttack(refEnv, expected - 2, expected + (int)(0.02 * blocksPerSecond), refPeak, refRise);
+        int outPos = findAttack(outEnv, expected - searchBlocks, expected + searchBlocks, outPeak, outRise);
+
+        numHits ++;
+        if (outPeak < 0.5f * refPeak)
+        {
+            numLost ++;
+            continue;
+        }
+        smear += (outRise - refRise) / blocksPerSecond;
+        jitter += abs(outPos - refPos) / blocksPerSecond;
+    }
+
+    int numFound = numHits - numLost;
+    result.smear = numFound ? 1000 * smear / numFound : 0;
+    result.jitter = numFound ? 1000 * jitter / numFound : 0;
+    result.lost = numHits ? 100.0 * numLost / numHits : 0;
+}
+
+
+int main(int argc, const char *argv[])
+{
+    double seconds = 10;
+    bool csv = false;
+
+    for (int i = 1; i < argc; i ++)
+    {
+        if (strcmp(argv[i], "-csv") == 0)
+        {
+            csv = true;
+        }
+        else
+        {
+            seconds = atof(argv[i]);
+        }
+    }
+    if (seconds < 1)
+    {
+        fprintf(stderr, "usage: soundtouch_quality_bench [seconds] [-csv]\n");
+        return 1;
+    }
+
+    // averages of the tempo only and of the pitch changing points
+    const int numConfigs = sizeof(configs) / sizeof(configs[0]);
+    vector<Result> totals[2];
+    vector<int> numRuns[2];
+    vector<int> numTransientRuns[2];
+    for (int g = 0; g < 2; g ++)
+    {
+        totals[g].assign(numConfigs, Result{ 0, 0, 0, 0, 0 });
+        numRuns[g].assign(numConfigs, 0);
+        numTransientRuns[g].assign(numConfigs, 0);
+    }
+
+    if (csv)
+    {
+        printf("signal,config,tempo,pitch,ns_per_sample,lsd_db,smear_ms,jitter_ms,lost_percent\n");
+    }
+    else
+    {
+        printf("%.0f s of %d Hz stereo per signal\n\n", seconds, SAMPLE_RATE);
+        printf("%-7s %-11s %5s %5s %9s %7s %8s %8s %6s\n",
+               "signal", "config", "tempo", "pitch", "ns/sample", "lsd dB", "smear ms", "jitter", "lost %");
+    }
+
+    for (const Signal &signal : signals)
+    {
+        vector<float> mono = render(signal, seconds, 1.0, 0);
+        vector<float> input(mono.size() * CHANNELS);
+        for (size_t i = 0; i < mono.size(); i ++)
+        {
+            for (int c = 0; c < CHANNELS; c ++) input[CHANNELS * i + c] = mono[i];
+        }
+
+        for (const GridPoint &point : grid)
+        {
+            vector<float> reference = render(signal, seconds, point.tempo, point.pitchSemiTones);
+            vector<float> output;
+            const int g = (point.pitchSemiTones != 0);
+
+            for (int c = 0; c < numConfigs; c ++)
+            {
+                const Config &config = configs[c];
+                if (config.transposerOnly && point.pitchSemiTones == 0) continue;
+
+                Result result{ 0, 0, 0, 0, 0 };
+                double time = process(input, config, point, output);
+                result.nsPerSample = time * 1e9 / (double)input.size();
+                result.lsd = spectralDistortion(reference, output);
+                if (signal.transients)
+                {
+                    measureTransients(reference, output, point.tempo, result);
+                    totals[g][c].smear += result.smear;
+                    totals[g][c].jitter += result.jitter;
+                    totals[g][c].lost += result.lost;
+                    numTransientRuns[g][c] ++;
+                }
+                totals[g][c].nsPerSample += result.nsPerSample;
+                totals[g][c].lsd += result.lsd;
+                numRuns[g][c] ++;
+
+                if (csv)
+                {
+                    printf("%s,%s,%g,%g,%.3f,%.3f,%.3f,%.3f,%.2f\n", signal.name, config.name, point.tempo,
+                           point.pitchSemiTones, result.nsPerSample, result.lsd, result.smear, result.jitter,
+                           result.lost);
+                }
+                else if (signal.transients)
+                {
+                    printf("%-7s %-11s %5.2f %+5.0f %9.2f %7.2f %8.2f %8.2f %6.1f\n", signal.name, config.name,
+                           point.tempo, point.pitchSemiTones, result.nsPerSample, result.lsd, result.smear,
+                           result.jitter, result.lost);
+                }
+                else
+                {
+                    printf("%-7s %-11s %5.2f %+5.0f %9.2f %7.2f %8s %8s %6s\n", signal.name, config.name,
+                           point.tempo, point.pitchSemiTones, result.nsPerSample, result.lsd, "-", "-", "-");
+                }
+                fflush(stdout);
+            }
+        }
+    }
+
+    if (!csv)
+    {
+        // the transposer-only configurations run only at the pitch changes,
+        // so the averages are kept apart
+        static const char *groupNames[2] = { "tempo changes", "pitch changes" };
+        for (int g = 0; g < 2; g ++)
+        {
+            printf("\nAverage over all signals, %s:\n", groupNames[g]);
+            printf("%-11s %9s %7s %8s %8s %6s\n", "config", "ns/sample", "lsd dB", "smear ms", "jitter", "lost %");
+            for (int c = 0; c < numConfigs; c ++)
+            {
+                const Result &total = totals[g][c];
+                if (!numRuns[g][c]) continue;
+                int n = max(1, numTransientRuns[g][c]);
+                printf("%-11s %9.2f %7.2f %8.2f %8.2f %6.1f\n", configs[c].name, total.nsPerSample / numRuns[g][c],
+                       total.lsd / numRuns[g][c], total.smear / n, total.jitter / n, total.lost / n);
+            }
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,204 @@
+////////////////////////////////////////////////////////////////////////////////
+///
+/// Benchmark of the instruction set specific SoundTouch routines.
+///
+/// Runs the same synthetic stereo signal through SoundTouch once per
+/// instruction set available on this CPU, from plain C to AVX2 or NEON, by
+/// masking extensions with 'disableExtensions' before the SoundTouch instance
+/// is created. Reports the processing time per sample and the deviation of
+/// each output from the plain C output.
+///
+/// soundtouch_bench [seconds]
+///
+////////////////////////////////////////////////////////////////////////////////
+//
+// License :
+//
+//  SoundTouch audio processing library
+//  Copyright (c) Olli Parviainen
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU Lesser General Public
+//  License as published by the Free Software Foundation; either
+//  version 2.1 of the License, or (at your option) any later version.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include "SoundTouch.h"
+#include "../SoundTouch/cpu_detect.h"
+
+using namespace soundtouch;
+using namespace std;
+
+#define SAMPLE_RATE     44100
+#define CHANNELS        2
+#define BUFF_SIZE       6720
+
+struct IsaLevel
+{
+    const char *name;
+    uint disableMask;   // extensions masked out for this run
+    uint required;      // extension that selects the routines tested
+};
+
+// Plain C first, it is the reference output
+static const IsaLevel isaLevels[] =
+{
+    { "c",    0xffffffff,   0 },
+    { "sse",  SUPPORT_AVX2, SUPPORT_SSE },
+    { "avx2", 0,            SUPPORT_AVX2 },
+    { "neon", 0,            SUPPORT_NEON },
+};
+
+struct Case
+{
+    const char *name;
+    double tempo;
+    double pitchSemiTones;
+    bool quickSeek;
+    bool fftCorrelation;
+};
+
+// 'tempo' runs TDStretch only: cross-correlation search & overlap, 'tempo-fft'
+// the same with the FFT correlation, which the seek window is long enough for. 'pitch'
+// adds the rate transposer with its anti-alias FIR filter.
+static const Case cases[] =
+{
+    { "tempo",       1.1,  0, false, false },
+    { "tempo-fft",   1.1,  0, false, true  },
+    { "tempo-quick", 1.1,  0, true,  false },
+    { "pitch",       1.0,  3, false, false },
+};
+
+
+// Sum of a few tones and some noise, a music-like stereo signal
+static vector<float> makeSignal(int numFrames)
+{
+    vector<float> signal(numFrames * CHANNELS);
+    uint seed = 1;
+
+    for (int i = 0; i < numFrames; i ++)
+    {
+        double t = (double)i / SAMPLE_RATE;
+        double tones = 0.3 * sin(2 * M_PI * 110 * t) + 0.2 * sin(2 * M_PI * 440 * t * (1 + 0.1 * sin(t)))
+                     + 0.1 * sin(2 * M_PI * 3520 * t);
+        for (int c = 0; c < CHANNELS; c ++)
+        {
+            seed = seed * 1664525u + 1013904223u;
+            signal[CHANNELS * i + c] = (float)(tones + 0.05 * ((double)(seed >> 8) / (1 << 24) - 0.5));
+        }
+    }
+    return signal;
+}
+
+
+// Processes the signal, returns the output and the processing time in seconds
+static double process(const vector<float> &input, const Case &test, vector<float> &output)
+{
+    SoundTouch soundTouch;
+    float buffer[BUFF_SIZE];
+    int numFrames = (int)(input.size() / CHANNELS);
+
+    soundTouch.setSampleRate(SAMPLE_RATE);
+    soundTouch.setChannels(CHANNELS);
+    soundTouch.setTempo(test.tempo);
+    soundTouch.setPitchSemiTones(test.pitchSemiTones);
+    soundTouch.setSetting(SETTING_USE_QUICKSEEK, test.quickSeek);
+    soundTouch.setSetting(SETTING_USE_FFT_CORRELATION, test.fftCorrelation);
+    output.clear();
+
+    auto start = chrono::steady_clock::now();
+    for (int i = 0; i < numFrames; i += BUFF_SIZE / CHANNELS)
+    {
+        int n = min(BUFF_SIZE / CHANNELS, numFrames - i);
+        soundTouch.putSamples(&input[CHANNELS * i], n);
+        while ((n = soundTouch.receiveSamples(buffer, BUFF_SIZE / CHANNELS)) != 0)
+        {
+            output.insert(output.end(), buffer, buffer + n * CHANNELS);
+        }
+    }
+    soundTouch.flush();
+    int n;
+    while ((n = soundTouch.receiveSamples(buffer, BUFF_SIZE / CHANNELS)) != 0)
+    {
+        output.insert(output.end(), buffer, buffer + n * CHANNELS);
+    }
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+
+// Signal to difference ratio of 'output' against 'reference', in dB
+static double compare(const vector<float> &reference, const vector<float> &output)
+{
+    double signal = 0;
+    double diff = 0;
+
+    if (reference.size() != output.size()) return -INFINITY;
+
+    for (size_t i = 0; i < reference.size(); i ++)
+    {
+        signal += (double)reference[i] * reference[i];
+        diff += ((double)reference[i] - output[i]) * ((double)reference[i] - output[i]);
+    }
+    return diff > 0 ? 10 * log10(signal / diff) : INFINITY;
+}
+
+
+int main(int argc, const char *argv[])
+{
+    double seconds = (argc > 1) ? atof(argv[1]) : 30;
+    int numFrames = (int)(seconds * SAMPLE_RATE);
+
+    if (numFrames <= 0)
+    {
+        fprintf(stderr, "usage: soundtouch_bench [seconds]\n");
+        return 1;
+    }
+
+    vector<float> input = makeSignal(numFrames);
+    vector<float> reference;
+    vector<float> output;
+
+    disableExtensions(0);
+    uint available = detectCPUextensions();
+    printf("%.0f s of %d Hz stereo, extensions 0x%x\n", seconds, SAMPLE_RATE, available);
+
+    for (const Case &test : cases)
+    {
+        double referenceTime = 0;
+
+        for (const IsaLevel &isa : isaLevels)
+        {
+            if ((available & isa.required) != isa.required) continue;
+            disableExtensions(isa.disableMask);
+
+            vector<float> &out = referenceTime ? output : reference;
+            double time = process(input, test, out);
+            if (!referenceTime) referenceTime = time;
+
+            printf("%-12s %-5s %7.2f ns/sample  %6.1fx realtime  speedup %.2f", test.name, isa.name,
+                   time * 1e9 / ((double)numFrames * CHANNELS), seconds / time, referenceTime / time);
+            if (&out == &output)
+            {
+                printf("  SNR vs c %.1f dB", compare(reference, output));
+            }
+            printf("\n");
+        }
+    }
+    disableExtensions(0);
+    return 0;
+}
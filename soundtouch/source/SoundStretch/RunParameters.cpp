@@ -31,6 +31,7 @@
 
 #include <string>
 #include <cstdlib>
+#include <fstream>
 
 #include "RunParameters.h"
 
@@ -72,9 +73,16 @@ static const char whatText[] =
 static const char usage[] =
     "Usage :\n"
     "    soundstretch infilename outfilename [switches]\n"
+    "    soundstretch -batch=manifest [-jobs=n] [switches]\n"
     "\n"
     "To use standard input/output pipes, give 'stdin' and 'stdout' as filenames.\n"
     "\n"
+    "In batch mode each line of the manifest is a job 'infilename outfilename\n"
+    "[switches]', e.g. 'song.wav song_slow.wav -tempo=-20 -pitch=-2'. Names with\n"
+    "spaces can be quoted, lines starting with '#' are comments. Switches given on\n"
+    "the command line apply to all jobs, the jobs run on n threads (default: one\n"
+    "per CPU core).\n"
+    "\n"
     "Available switches are:\n"
     "  -tempo=n : Change sound tempo by n percents  (n=-95..+5000 %)\n"
     "  -pitch=n : Change sound pitch by n semitones (n=-60..+60 semitones)\n"
@@ -103,6 +111,12 @@ RunParameters::RunParameters(int nParams, const CHARTYPE* paramStr[])
     int i;
     int nFirstParam;
 
+    if (nParams > 1 && STRING(paramStr[1]).compare(0, 7, STRING_CONST("-batch=")) == 0)
+    {
+        parseBatchParams(nParams, paramStr);
+        return;
+    }
+
     if (nParams < 3)
     {
         // Too few parameters
@@ -142,6 +156,116 @@ RunParameters::RunParameters(int nParams, const CHARTYPE* paramStr[])
 }
 
 
+// Parses the command line of batch mode: "-batch=manifest [switches]"
+void RunParameters::parseBatchParams(int nParams, const CHARTYPE* paramStr[])
+{
+    batchFileName = STRING(paramStr[1]).substr(7);
+    if (batchFileName.empty())
+    {
+        throwIllegalParamExp(paramStr[1]);
+    }
+
+    // check the switches now, they are parsed again for each job
+    for (int i = 2; i < nParams; i ++)
+    {
+        parseSwitchParam(paramStr[i]);
+        batchSwitches.push_back(paramStr[i]);
+    }
+    checkLimits();
+}
+
+
+// Splits a manifest line into whitespace separated words, double quotes group
+// words with spaces into one
+static vector<STRING> splitManifestLine(const string& line)
+{
+    vector<STRING> words;
+    STRING word;
+    bool quoted = false;
+    bool inWord = false;
+
+    for (char c : line)
+    {
+        if (c == '"')
+        {
+            quoted = !quoted;
+            inWord = true;
+        }
+        else if (!quoted && (c == ' ' || c == '\t' || c == '\r'))
+        {
+            if (inWord) words.push_back(word);
+            word.clear();
+            inWord = false;
+        }
+        else
+        {
+            word += (CHARTYPE)c;
+            inWord = true;
+        }
+    }
+    if (inWord) words.push_back(word);
+    return words;
+}
+
+
+vector<RunParameters> RunParameters::readBatchJobs() const
+{
+    vector<RunParameters> jobs;
+    ifstream manifest(batchFileName.c_str());
+    string line;
+    int lineNumber = 0;
+
+    if (!manifest)
+    {
+        ST_THROW_RT_ERROR("Error : Unable to open batch manifest for reading.");
+    }
+
+    while (getline(manifest, line))
+    {
+        lineNumber ++;
+        vector<STRING> words = splitManifestLine(line);
+        if (words.empty() || words[0][0] == '#') continue;
+
+        // build the command line of a single file run: program name, file names,
+        // then the common switches followed by the switches of this job
+        vector<const CHARTYPE*> args;
+        args.push_back(STRING_CONST("soundstretch"));
+        for (size_t i = 0; i < words.size(); i ++)
+        {
+            args.push_back(words[i].c_str());
+            if (i == 1)
+            {
+                for (const STRING& sw : batchSwitches) args.push_back(sw.c_str());
+            }
+        }
+
+        string error;
+        if (words.size() < 2 || words[0][0] == '-' || words[1][0] == '-')
+        {
+            error = "input and output file names expected";
+        }
+        else if (words[0] == STRING_CONST("stdin") || words[1] == STRING_CONST("stdout"))
+        {
+            error = "stdin and stdout can't be used in batch mode";
+        }
+        else
+        {
+            try
+            {
+                jobs.emplace_back((int)args.size(), args.data());
+                continue;
+            }
+            catch (const runtime_error& e)
+            {
+                error = e.what();
+            }
+        }
+        ST_THROW_RT_ERROR("ERROR : Invalid job on line " + to_string(lineNumber) + " of the batch manifest: " + error);
+    }
+    return jobs;
+}
+
+
 // Checks parameter limits
 void RunParameters::checkLimits()
 {
@@ -273,6 +397,12 @@ void RunParameters::parseSwitchParam(const STRING& str)
             noAntiAlias = 1;
             break;
 
+        case 'j' :
+            // switch '-jobs=xx'
+            numThreads = (int)parseSwitchValue(str);
+            if (numThreads < 0) numThreads = 0;
+            break;
+
         case 'l' :
             // switch '-license'
             throwLicense();
@@ -33,6 +33,7 @@
 #define RUNPARAMETERS_H
 
 #include <string>
+#include <vector>
 #include "STTypes.h"
 #include "SS_CharTypes.h"
 #include "WavFile.h"
@@ -49,6 +50,7 @@ private:
     void parseSwitchParam(const STRING& str);
     void checkLimits();
     float parseSwitchValue(const STRING& tr) const;
+    void parseBatchParams(int nParams, const CHARTYPE* paramStr[]);
 
 public:
     STRING inFileName;
@@ -62,9 +64,23 @@ public:
     bool  detectBPM{ false };
     bool  speech{ false };
 
+    /// Batch mode: manifest file of jobs, number of worker threads (0 = one per
+    /// CPU core) and the switches given on the command line, which apply to
+    /// every job of the manifest.
+    STRING batchFileName;
+    int   numThreads{ 0 };
+    std::vector<STRING> batchSwitches;
+
     RunParameters(int nParams, const CHARTYPE* paramStr[]);
+
+    /// Reads the jobs of the batch manifest 'batchFileName'. Throws 'runtime_error'
+    /// if the manifest can't be read or a line of it is invalid.
+    std::vector<RunParameters> readBatchJobs() const;
 };
 
+/// Converts STRING to std::string for printing
+std::string convertString(const STRING& str);
+
 }
 
 #endif
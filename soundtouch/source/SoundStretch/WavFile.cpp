@@ -178,7 +178,7 @@ void* WavFileBase::getConvBuffer(int sizeBytes)
 // Class WavInFile
 //
 
-WavInFile::WavInFile(const STRING& fileName)
+WavInFile::WavInFile(const STRING& fileName, size_t bufferSize)
 {
     // Try to open the file for reading
     fptr = FOPEN(fileName.c_str(), "rb");
@@ -186,6 +186,11 @@ WavInFile::WavInFile(const STRING& fileName)
     {
         ST_THROW_RT_ERROR("Error : Unable to open file for reading.");
     }
+    if (bufferSize > 0)
+    {
+        // must be set before the first read
+        setvbuf(fptr, nullptr, _IOFBF, bufferSize);
+    }
 
     init();
 }
@@ -704,7 +709,7 @@ uint WavInFile::getElapsedMS() const
 // Class WavOutFile
 //
 
-WavOutFile::WavOutFile(const STRING& fileName, int sampleRate, int bits, int channels)
+WavOutFile::WavOutFile(const STRING& fileName, int sampleRate, int bits, int channels, size_t bufferSize)
 {
     bytesWritten = 0;
     fptr = FOPEN(fileName.c_str(), "wb");
@@ -712,6 +717,11 @@ WavOutFile::WavOutFile(const STRING& fileName, int sampleRate, int bits, int cha
     {
         ST_THROW_RT_ERROR("Error : Unable to open file for writing.");
     }
+    if (bufferSize > 0)
+    {
+        // must be set before the first write
+        setvbuf(fptr, nullptr, _IOFBF, bufferSize);
+    }
 
     fillInHeader(sampleRate, bits, channels);
     writeHeader();
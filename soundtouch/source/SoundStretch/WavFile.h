@@ -149,8 +149,9 @@ private:
 
 public:
     /// Constructor: Opens the given WAV file. If the file can't be opened,
-    /// throws 'runtime_error' exception.
-    WavInFile(const STRING& filename);
+    /// throws 'runtime_error' exception. A nonzero 'bufferSize' sets the size of
+    /// the stdio read buffer in bytes, so that the file is read in large blocks.
+    WavInFile(const STRING& filename, size_t bufferSize = 0);
 
     WavInFile(FILE *file);
 
@@ -249,7 +250,8 @@ public:
     WavOutFile(const STRING& fileName,  ///< Filename
                int sampleRate,          ///< Sample rate (e.g. 44100 etc)
                int bits,                ///< Bits per sample (8 or 16 bits)
-               int channels             ///< Number of channels (1=mono, 2=stereo)
+               int channels,            ///< Number of channels (1=mono, 2=stereo)
+               size_t bufferSize = 0    ///< stdio write buffer size in bytes, 0 for default
                );
 
     WavOutFile(FILE *file, int sampleRate, int bits, int channels);
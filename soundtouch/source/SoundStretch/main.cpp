@@ -29,10 +29,17 @@
 //
 ////////////////////////////////////////////////////////////////////////////////
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <deque>
 #include <iostream>
 #include <memory>
+#include <mutex>
 #include <stdexcept>
 #include <string>
+#include <thread>
+#include <vector>
 #include <cstdio>
 #include <ctime>
 #include "RunParameters.h"
@@ -49,6 +56,10 @@ namespace soundstretch
 // Processing chunk size (size chosen to be divisible by 2, 4, 6, 8, 10, 12, 14, 16 channels ...)
 #define BUFF_SIZE           6720
 
+// stdio buffer size of the batch mode files, so that they are read & written in large
+// blocks instead of seeking back and forth between files on a disk busy with many jobs
+#define BATCH_IO_BUFFER_SIZE    (1024 * 1024)
+
 #if _WIN32
 #include <io.h>
 #include <fcntl.h>
@@ -129,6 +140,15 @@ static void setup(SoundTouch& soundTouch, const WavInFile& inFile, const RunPara
         soundTouch.setSetting(SETTING_SEQUENCE_MS, 40);
         soundTouch.setSetting(SETTING_SEEKWINDOW_MS, 15);
         soundTouch.setSetting(SETTING_OVERLAP_MS, 8);
+    }
+}
+
+
+// Prints the processing settings of a single file run
+static void printSetup(const RunParameters& params)
+{
+    if (params.speech)
+    {
         fprintf(stderr, "Tune processing parameters for speech processing.\n");
     }
 
@@ -206,16 +226,12 @@ static void process(SoundTouch& soundTouch, WavInFile& inFile, WavOutFile& outFi
 }
 
 
-// Detect BPM rate of inFile and adjust tempo setting accordingly if necessary
-static void detectBPM(WavInFile& inFile, RunParameters& params)
+// Detects the BPM rate of inFile and rewinds the file for processing
+static float detectBPMRate(WavInFile& inFile)
 {
     BPMDetect bpm(inFile.getNumChannels(), inFile.getSampleRate());
     SAMPLETYPE sampleBuffer[BUFF_SIZE];
 
-    // detect bpm rate
-    fprintf(stderr, "Detecting BPM rate...");
-    fflush(stderr);
-
     const int nChannels = (int)inFile.getNumChannels();
     int readSize = BUFF_SIZE - BUFF_SIZE % nChannels;   // round read size down to multiple of num.channels
 
@@ -231,13 +247,24 @@ static void detectBPM(WavInFile& inFile, RunParameters& params)
         bpm.inputSamples(sampleBuffer, samples);
     }
 
-    // Now the whole song data has been analyzed. Read the resulting bpm.
-    const float bpmValue = bpm.getBpm();
-    fprintf(stderr, "Done!\n");
-
     // rewind the file after bpm detection
     inFile.rewind();
 
+    // Now the whole song data has been analyzed. Read the resulting bpm.
+    return bpm.getBpm();
+}
+
+
+// Detect BPM rate of inFile and adjust tempo setting accordingly if necessary
+static void detectBPM(WavInFile& inFile, RunParameters& params)
+{
+    // detect bpm rate
+    fprintf(stderr, "Detecting BPM rate...");
+    fflush(stderr);
+
+    const float bpmValue = detectBPMRate(inFile);
+    fprintf(stderr, "Done!\n");
+
     if (bpmValue > 0)
     {
         fprintf(stderr, "Detected BPM rate %.1f\n\n", bpmValue);
@@ -256,6 +283,203 @@ static void detectBPM(WavInFile& inFile, RunParameters& params)
     }
 }
 
+// Work-stealing job queues of the batch mode. Each worker thread takes jobs from
+// the front of its own queue and, once that runs empty, steals from the back of
+// the longest other queue, so threads that drew short files keep helping the ones
+// that drew long files until the whole batch is done.
+class BatchQueues
+{
+private:
+    struct Queue
+    {
+        mutex lock;
+        deque<int> jobs;
+    };
+    vector<Queue> queues;
+
+public:
+    // Deals the jobs out round robin in the given order
+    BatchQueues(int numQueues, const vector<int>& order) : queues(numQueues)
+    {
+        for (size_t i = 0; i < order.size(); i ++)
+        {
+            queues[i % numQueues].jobs.push_back(order[i]);
+        }
+    }
+
+    // Gets the next job for 'worker', returns false when all queues are empty
+    bool next(int worker, int& job)
+    {
+        {
+            lock_guard<mutex> guard(queues[worker].lock);
+            if (!queues[worker].jobs.empty())
+            {
+                job = queues[worker].jobs.front();
+                queues[worker].jobs.pop_front();
+                return true;
+            }
+        }
+
+        for (;;)
+        {
+            // jobs aren't added once the batch runs, so an empty snapshot is final
+            int victim = -1;
+            size_t longest = 0;
+            for (int i = 0; i < (int)queues.size(); i ++)
+            {
+                lock_guard<mutex> guard(queues[i].lock);
+                if (queues[i].jobs.size() > longest)
+                {
+                    longest = queues[i].jobs.size();
+                    victim = i;
+                }
+            }
+            if (victim < 0) return false;
+
+            lock_guard<mutex> guard(queues[victim].lock);
+            if (!queues[victim].jobs.empty())
+            {
+                job = queues[victim].jobs.back();
+                queues[victim].jobs.pop_back();
+                return true;
+            }
+            // someone else got there first, look again
+        }
+    }
+};
+
+
+// Processes one job of the batch, returns the input duration in seconds
+static double processBatchJob(RunParameters& params, float& bpmValue)
+{
+    WavInFile inFile(params.inFileName, BATCH_IO_BUFFER_SIZE);
+
+    bpmValue = 0;
+    if (params.detectBPM)
+    {
+        bpmValue = detectBPMRate(inFile);
+        if (bpmValue > 0 && params.goalBPM > 0)
+        {
+            params.tempoDelta = (params.goalBPM / bpmValue - 1.0f) * 100.0f;
+        }
+    }
+
+    WavOutFile outFile(params.outFileName, (int)inFile.getSampleRate(), (int)inFile.getNumBits(),
+                       (int)inFile.getNumChannels(), BATCH_IO_BUFFER_SIZE);
+    SoundTouch soundTouch;
+    setup(soundTouch, inFile, params);
+    process(soundTouch, inFile, outFile);
+
+    return inFile.getNumSamples() / (double)inFile.getSampleRate();
+}
+
+
+// Runs the jobs of the batch manifest on a pool of worker threads
+static void ss_batch(const RunParameters& batch)
+{
+    vector<RunParameters> jobs = batch.readBatchJobs();
+    const int numJobs = (int)jobs.size();
+
+    int numThreads = batch.numThreads;
+    if (numThreads <= 0)
+    {
+        numThreads = max(1, (int)thread::hardware_concurrency());
+    }
+    numThreads = max(1, min(numThreads, numJobs));
+
+    // Start the longest files first so that no thread is left with a long file
+    // at the end while the others idle. Unreadable files get size 0, their jobs
+    // fail quickly and report the error.
+    vector<double> dataSize(numJobs, 0);
+    vector<int> order(numJobs);
+    for (int i = 0; i < numJobs; i ++)
+    {
+        order[i] = i;
+        try
+        {
+            dataSize[i] = WavInFile(jobs[i].inFileName).getDataSizeInBytes();
+        }
+        catch (const exception&)
+        {
+        }
+    }
+    stable_sort(order.begin(), order.end(), [&](int a, int b) { return dataSize[a] > dataSize[b]; });
+
+    fprintf(stderr, "Processing %d files on %d threads.\n\n", numJobs, numThreads);
+    fflush(stderr);
+
+    BatchQueues queues(numThreads, order);
+    mutex printLock;
+    atomic<int> numDone(0);
+    atomic<int> numFailed(0);
+    double audioSeconds = 0;
+    const auto start = chrono::steady_clock::now();
+
+    auto worker = [&](int index)
+    {
+        int job;
+        while (queues.next(index, job))
+        {
+            RunParameters& params = jobs[job];
+            const auto jobStart = chrono::steady_clock::now();
+            string error;
+            float bpmValue = 0;
+            double seconds = 0;
+            try
+            {
+                seconds = processBatchJob(params, bpmValue);
+            }
+            catch (const exception& e)
+            {
+                error = e.what();
+            }
+            const double elapsed = chrono::duration<double>(chrono::steady_clock::now() - jobStart).count();
+
+            lock_guard<mutex> guard(printLock);
+            const int done = ++ numDone;
+            if (error.empty())
+            {
+                audioSeconds += seconds;
+                fprintf(stderr, "[%d/%d] %s: %.1f s in %.2f s", done, numJobs,
+                        convertString(params.outFileName).c_str(), seconds, elapsed);
+                if (params.detectBPM)
+                {
+                    fprintf(stderr, ", %.1f BPM", bpmValue);
+                }
+                fprintf(stderr, "\n");
+            }
+            else
+            {
+                numFailed ++;
+                fprintf(stderr, "[%d/%d] %s: %s\n", done, numJobs,
+                        convertString(params.inFileName).c_str(), error.c_str());
+            }
+            fflush(stderr);
+        }
+    };
+
+    vector<thread> threads;
+    for (int i = 1; i < numThreads; i ++)
+    {
+        threads.emplace_back(worker, i);
+    }
+    worker(0);
+    for (thread& t : threads)
+    {
+        t.join();
+    }
+
+    const double elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    fprintf(stderr, "\nDone! %.1f s of audio in %.2f s (%.1fx realtime).\n", audioSeconds, elapsed,
+            elapsed > 0 ? audioSeconds / elapsed : 0);
+
+    if (numFailed > 0)
+    {
+        ST_THROW_RT_ERROR("ERROR : " + to_string(numFailed) + " of " + to_string(numJobs) + " jobs failed.");
+    }
+}
+
+
 void printHelloText()
 {
     SoundTouch soundTouch;
@@ -280,6 +504,7 @@ void ss_main(RunParameters& params)
 
     // Setup the 'SoundTouch' object for processing the sound
     setup(soundTouch, *inFile, params);
+    printSetup(params);
 
     // clock_t cs = clock();    // for benchmarking processing duration
     // Process the sound
@@ -305,7 +530,14 @@ int main(int argc, const char* args[])
     {
         soundstretch::printHelloText();
         soundstretch::RunParameters params(argc, args);
-        soundstretch::ss_main(params);
+        if (params.batchFileName.empty())
+        {
+            soundstretch::ss_main(params);
+        }
+        else
+        {
+            soundstretch::ss_batch(params);
+        }
     }
     catch (const runtime_error& e)
     {
@@ -37,6 +37,10 @@
 #include <assert.h>
 #include <math.h>
 #include <stdlib.h>
+#include <map>
+#include <mutex>
+#include <utility>
+#include <vector>
 #include "AAFilter.h"
 #include "FIRFilter.h"
 
@@ -45,6 +49,13 @@ using namespace soundtouch;
 #define PI       3.14159265358979323846
 #define TWOPI    (2 * PI)
 
+// Cut-off frequencies are rounded to multiples of 0.5 / AAFILTER_CUTOFF_STEPS,
+// so that a pitch setting used before finds its filter in the cache
+#define AAFILTER_CUTOFF_STEPS   4096
+
+// Max number of filter designs cached, the cache is emptied when it's full
+#define AAFILTER_CACHE_SIZE     256
+
 // define this to save AA filter coefficients to a file
 // #define _DEBUG_SAVE_AAFILTER_COEFFICIENTS   1
 
@@ -68,6 +79,23 @@ using namespace soundtouch;
     #define _DEBUG_SAVE_AAFIR_COEFFS(x, y)
 #endif
 
+namespace
+{
+    /// Filter designs shared by all AAFilter instances, by filter length and
+    /// cut-off frequency step
+    struct CoeffCache
+    {
+        std::mutex mutex;
+        std::map<std::pair<uint, int>, std::vector<SAMPLETYPE> > designs;
+    };
+
+    CoeffCache &getCoeffCache()
+    {
+        static CoeffCache cache;
+        return cache;
+    }
+}
+
 /*****************************************************************************
  *
  * Implementation of the class 'AAFilter'
@@ -106,31 +134,61 @@ void AAFilter::setLength(uint newLength)
 }
 
 
-// Calculates coefficients for a low-pass FIR filter using Hamming window
+// Sets the coefficients of the low-pass FIR filter for the current length and
+// cut-off frequency, designed by 'designCoeffs' unless found in the cache
 void AAFilter::calculateCoeffs()
 {
-    uint i;
-    double cntTemp, temp, tempCoeff,h, w;
-    double wc;
-    double scaleCoeff, sum;
-    double *work;
-    SAMPLETYPE *coeffs;
+    CoeffCache &cache = getCoeffCache();
+    int step;
 
     assert(length >= 2);
     assert(length % 4 == 0);
     assert(cutoffFreq >= 0);
     assert(cutoffFreq <= 0.5);
 
+    step = (int)(cutoffFreq * 2 * AAFILTER_CUTOFF_STEPS + 0.5);
+    std::pair<uint, int> key(length, step);
+
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    auto found = cache.designs.find(key);
+    if (found == cache.designs.end())
+    {
+        if (cache.designs.size() >= AAFILTER_CACHE_SIZE) cache.designs.clear();
+
+        std::vector<SAMPLETYPE> coeffs(length);
+        designCoeffs(coeffs.data(), length, 0.5 * step / AAFILTER_CUTOFF_STEPS);
+        found = cache.designs.emplace(key, std::move(coeffs)).first;
+    }
+
+    // Set coefficients. Use divide factor 14 => divide result by 2^14 = 16384
+    pFIR->setCoefficients(found->second.data(), length, 14);
+
+    _DEBUG_SAVE_AAFIR_COEFFS(found->second.data(), length);
+}
+
+
+// Calculates coefficients for a low-pass FIR filter using Hamming window. The
+// filter is symmetric around tap 'length / 2', so only that half is calculated.
+// At the half-band cut-off 0.25 every other tap rounds to zero, which the
+// FIRFilter leaves out of the convolution.
+void AAFilter::designCoeffs(SAMPLETYPE *coeffs, uint length, double cutoffFreq)
+{
+    uint i;
+    uint half = length / 2;
+    double cntTemp, temp, tempCoeff,h, w;
+    double wc;
+    double scaleCoeff, sum;
+    double *work;
+
     work = new double[length];
-    coeffs = new SAMPLETYPE[length];
 
     wc = 2.0 * PI * cutoffFreq;
     tempCoeff = TWOPI / (double)length;
 
     sum = 0;
-    for (i = 0; i < length; i ++)
+    for (i = 0; i <= half; i ++)
     {
-        cntTemp = (double)i - (double)(length / 2);
+        cntTemp = (double)i - (double)half;
 
         temp = cntTemp * wc;
         if (temp != 0)
@@ -145,9 +203,14 @@ void AAFilter::calculateCoeffs()
 
         temp = w * h;
         work[i] = temp;
-
-        // calc net sum of coefficients
         sum += temp;
+
+        // mirror to the other side of the centre tap, tap 0 has no pair
+        if ((i > 0) && (i < half))
+        {
+            work[length - i] = temp;
+            sum += temp;
+        }
     }
 
     // ensure the sum of coefficients is larger than zero
@@ -164,21 +227,14 @@ void AAFilter::calculateCoeffs()
 
     for (i = 0; i < length; i ++)
     {
-        temp = work[i] * scaleCoeff;
-        // scale & round to nearest integer
-        temp += (temp >= 0) ? 0.5 : -0.5;
+        // scale & round to nearest integer, also with floating point samples
+        temp = floor(work[i] * scaleCoeff + 0.5);
         // ensure no overfloods
         assert(temp >= -32768 && temp <= 32767);
         coeffs[i] = (SAMPLETYPE)temp;
     }
 
-    // Set coefficients. Use divide factor 14 => divide result by 2^14 = 16384
-    pFIR->setCoefficients(coeffs, length, 14);
-
-    _DEBUG_SAVE_AAFIR_COEFFS(coeffs, length);
-
     delete[] work;
-    delete[] coeffs;
 }
 
 
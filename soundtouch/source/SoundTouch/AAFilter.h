@@ -56,6 +56,9 @@ protected:
 
     /// Calculate the FIR coefficients realizing the given cutoff-frequency
     void calculateCoeffs();
+
+    /// Design 'length' low-pass filter taps for the given cutoff-frequency
+    static void designCoeffs(SAMPLETYPE *coeffs, uint length, double cutoffFreq);
 public:
     AAFilter(uint length);
 
@@ -63,7 +66,8 @@ public:
 
     /// Sets new anti-alias filter cut-off edge frequency, scaled to sampling
     /// frequency (nyquist frequency = 0.5). The filter will cut off the
-    /// frequencies than that.
+    /// frequencies than that. The frequency is rounded to 1/8192 steps, and
+    /// the filters designed for the steps are cached for all instances.
     void setCutoffFreq(double newCutoffFreq);
 
     /// Sets number of FIR filter taps, i.e. ~filter complexity
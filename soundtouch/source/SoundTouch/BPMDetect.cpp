@@ -54,9 +54,12 @@
 #include <string.h>
 #include <stdio.h>
 #include <cfloat>
+#include <thread>
+#include <vector>
 #include "FIFOSampleBuffer.h"
 #include "PeakFinder.h"
 #include "BPMDetect.h"
+#include "CorrelationFFT.h"
 
 using namespace soundtouch;
 
@@ -361,8 +364,22 @@ void BPMDetect::updateBeatPos(int process_samples)
     }
 
     int skipstep = XCORR_UPDATE_SEQUENCE / OVERLAP_FACTOR;
+    float scale = getBeatScale(skipstep);
 
-    // compensate empty buffer at beginning by scaling coefficient
+    // detect beats
+    for (int i = 0; i < skipstep; i++)
+    {
+        detectBeat(beatcorr_ringbuff[beatcorr_ringbuffpos], scale, skipstep, posScale, resetDur);
+
+        beatcorr_ringbuff[beatcorr_ringbuffpos] = 0;
+        beatcorr_ringbuffpos = (beatcorr_ringbuffpos + 1) % windowLen;
+    }
+}
+
+
+// compensate empty buffer at beginning by scaling coefficient
+float BPMDetect::getBeatScale(int skipstep)
+{
     float scale = (float)windowLen / (float)(skipstep * init_scaler);
     if (scale > 1.0f)
     {
@@ -372,38 +389,36 @@ void BPMDetect::updateBeatPos(int process_samples)
     {
         scale = 1.0f;
     }
+    return scale;
+}
 
-    // detect beats
-    for (int i = 0; i < skipstep; i++)
-    {
-        float sum = beatcorr_ringbuff[beatcorr_ringbuffpos];
-        sum -= beat_lpf.update(sum);
 
-        if (sum > peakVal)
-        {
-            // found new local largest value
-            peakVal = sum;
-            peakPos = pos;
-        }
-        if (pos > peakPos + resetDur)
-        {
-            // largest value not updated for 200msec => accept as beat
-            peakPos += skipstep;
-            if (peakVal > 0)
-            {
-                // add detected beat to end of "beats" vector
-                BEAT temp = { (float)(peakPos * posScale), (float)(peakVal * scale) };
-                beats.push_back(temp);
-            }
+void BPMDetect::detectBeat(float corr, float scale, int skipstep, double posScale, int resetDur)
+{
+    float sum = corr;
+    sum -= beat_lpf.update(sum);
 
-            peakVal = 0;
-            peakPos = pos;
+    if (sum > peakVal)
+    {
+        // found new local largest value
+        peakVal = sum;
+        peakPos = pos;
+    }
+    if (pos > peakPos + resetDur)
+    {
+        // largest value not updated for 200msec => accept as beat
+        peakPos += skipstep;
+        if (peakVal > 0)
+        {
+            // add detected beat to end of "beats" vector
+            BEAT temp = { (float)(peakPos * posScale), (float)(peakVal * scale) };
+            beats.push_back(temp);
         }
 
-        beatcorr_ringbuff[beatcorr_ringbuffpos] = 0;
-        pos++;
-        beatcorr_ringbuffpos = (beatcorr_ringbuffpos + 1) % windowLen;
+        peakVal = 0;
+        peakPos = pos;
     }
+    pos++;
 }
 
 
@@ -569,3 +584,208 @@ int BPMDetect::getBeats(float *pos, float *values, int max_num)
     }
     return num;
 }
+
+
+// Clears the results and the state of earlier input
+void BPMDetect::reset()
+{
+    decimateSum = 0;
+    decimateCount = 0;
+    memset(xcorr, 0, windowLen * sizeof(float));
+
+    pos = 0;
+    peakPos = 0;
+    peakVal = 0;
+    init_scaler = 1;
+    beatcorr_ringbuffpos = 0;
+    memset(beatcorr_ringbuff, 0, windowLen * sizeof(float));
+    beat_lpf = IIR2_filter(_LPF_coeffs);
+    beats.clear();
+    buffer->clear();
+}
+
+
+#ifdef SOUNDTOUCH_FLOAT_SAMPLES
+
+// Calculates the correlations of 'updateXCorr' and 'updateBeatPos' for the update
+// blocks 'first' ... 'last - 1'. Block 'b' starts at decimated sample 'b * skipstep'.
+//
+// The blocks are correlated against a segment of 'data' that is transformed once
+// for as many consecutive blocks as fit in the transform without wrapping around.
+// Each block is transformed as a complex signal of its two windowed versions, the
+// xcorr one as the real and the beat one as the imaginary part, at the offset of
+// the block in the segment: the correlation of the real segment with it has the
+// xcorr result of lag 'i' at real part index 'i' and the negated beat result at
+// the imaginary part index 'i'.
+void BPMDetect::analyzeBlocks(const float *data, int numBlocks, int first, int last,
+                              const CorrelationFFT &fft, float *xcorrSum, float *beatSum) const
+{
+    const int skipstep = XCORR_UPDATE_SEQUENCE / OVERLAP_FACTOR;
+    const int fftSize = fft.getSize();
+    const int groupSize = (fftSize - XCORR_UPDATE_SEQUENCE - windowLen) / skipstep + 1;
+    const float scale = 1.0f / (float)fftSize;
+    // decay of 'updateXCorr' per block
+    const float xcorr_decay = (float)pow(0.5, 1.0 / (XCORR_DECAY_TIME_CONSTANT * TARGET_SRATE / XCORR_UPDATE_SEQUENCE));
+    std::vector<float> work(6 * fftSize);
+    float *segRe = work.data();
+    float *segIm = segRe + fftSize;
+    float *blockRe = segIm + fftSize;
+    float *blockIm = blockRe + fftSize;
+    float *corrRe = blockIm + fftSize;
+    float *corrIm = corrRe + fftSize;
+    int i;
+
+    assert(groupSize > 0);
+
+    for (int group = first; group < last; group += groupSize)
+    {
+        const float *seg = data + group * skipstep;
+
+        // zero padding past the samples the group needs, the blocks of a group
+        // end 'windowLen' samples before the end of 'data' at the latest
+        int segLen = (last - group < groupSize ? last - group : groupSize) * skipstep
+                     + XCORR_UPDATE_SEQUENCE - skipstep + windowLen;
+        if (segLen > fftSize) segLen = fftSize;
+        memset(segRe, 0, 2 * fftSize * sizeof(float));
+        memcpy(segRe, seg, segLen * sizeof(float));
+        fft.forward(segRe, segIm);
+
+        for (int b = group; (b < last) && (b < group + groupSize); b ++)
+        {
+            const float *src = data + b * skipstep;
+            const int offs = (b - group) * skipstep;
+
+            memset(blockRe, 0, 4 * fftSize * sizeof(float));
+            for (i = 0; i < XCORR_UPDATE_SEQUENCE; i ++)
+            {
+                blockRe[offs + i] = hamw[i] * hamw[i] * src[i];
+            }
+            for (i = 0; i < XCORR_UPDATE_SEQUENCE / 2; i ++)
+            {
+                blockIm[offs + i] = hamw2[i] * hamw2[i] * src[i];
+            }
+
+            fft.forward(blockRe, blockIm);
+            fft.accumulateCorrelation(segRe, segIm, blockRe, blockIm, corrRe, corrIm);
+            fft.inverse(corrRe, corrIm);
+
+            // the blocks after this one decay the xcorr result as many times
+            float weight = (float)pow(xcorr_decay, numBlocks - 1 - b) * scale;
+            float *beat = beatSum + (b - first) * skipstep;
+
+            for (i = windowStart; i < windowLen; i ++)
+            {
+                float corr = -corrIm[i] * scale;
+
+                xcorrSum[i] += (float)fabs(corrRe[i]) * weight;
+                // accumulate only positive correlations
+                beat[i] += (corr > 0) ? corr : 0;
+            }
+        }
+    }
+}
+
+#endif // SOUNDTOUCH_FLOAT_SAMPLES
+
+
+void BPMDetect::analyze(const SAMPLETYPE *samples, int numSamples, int numThreads)
+{
+    reset();
+
+#ifdef SOUNDTOUCH_FLOAT_SAMPLES
+    const int skipstep = XCORR_UPDATE_SEQUENCE / OVERLAP_FACTOR;
+    const int req = max(windowLen + XCORR_UPDATE_SEQUENCE, 2 * XCORR_UPDATE_SEQUENCE);
+    std::vector<float> data(numSamples / decimateBy + 1);
+    int numData;
+    int numBlocks;
+    int i;
+
+    // decimate the whole song, like 'inputSamples' does in blocks
+    numData = 0;
+    for (i = 0; i < numSamples; i += INPUT_BLOCK_SIZE)
+    {
+        int block = (numSamples - i > INPUT_BLOCK_SIZE) ? INPUT_BLOCK_SIZE : numSamples - i;
+        numData += decimate(data.data() + numData, samples + i * channels, block);
+    }
+
+    // 'inputSamples' processes the update blocks that have 'req' samples available
+    numBlocks = (numData >= req) ? (numData - req) / skipstep + 1 : 0;
+    if (numBlocks == 0) return;
+
+    // 'windowLen' beat correlations of each block, starting from the block position
+    const int beatLen = (numBlocks - 1) * skipstep + windowLen;
+    std::vector<float> beatcorr(beatLen, 0.0f);
+
+    CorrelationFFT fft;
+    fft.setSize(CorrelationFFT::sizeFor(windowLen + XCORR_UPDATE_SEQUENCE + 3 * skipstep));
+
+    if (numThreads <= 0) numThreads = (int)std::thread::hardware_concurrency();
+    // a thread gets at least a few seconds of blocks
+    int maxThreads = numBlocks / (4 * XCORR_UPDATE_SEQUENCE) + 1;
+    if (numThreads > maxThreads) numThreads = maxThreads;
+    if (numThreads < 1) numThreads = 1;
+
+    // each thread sums partial correlations of its share of the blocks, the
+    // calling thread does the first share
+    std::vector<std::vector<float> > xcorrParts(numThreads, std::vector<float>(windowLen, 0.0f));
+    std::vector<std::vector<float> > beatParts(numThreads);
+    std::vector<std::thread> threads;
+    std::vector<int> firstBlock(numThreads + 1);
+
+    for (i = 0; i <= numThreads; i ++)
+    {
+        firstBlock[i] = (int)((long long)numBlocks * i / numThreads);
+    }
+    for (i = 0; i < numThreads; i ++)
+    {
+        beatParts[i].assign((firstBlock[i + 1] - firstBlock[i] - 1) * skipstep + windowLen, 0.0f);
+    }
+    for (i = 1; i < numThreads; i ++)
+    {
+        threads.emplace_back([this, &data, &fft, &xcorrParts, &beatParts, &firstBlock, numBlocks, i]()
+        {
+            analyzeBlocks(data.data(), numBlocks, firstBlock[i], firstBlock[i + 1], fft,
+                          xcorrParts[i].data(), beatParts[i].data());
+        });
+    }
+    analyzeBlocks(data.data(), numBlocks, firstBlock[0], firstBlock[1], fft,
+                  xcorrParts[0].data(), beatParts[0].data());
+    for (std::thread &thread : threads)
+    {
+        thread.join();
+    }
+
+    // merge the partial correlations
+    for (i = 0; i < numThreads; i ++)
+    {
+        const float *beat = beatParts[i].data();
+        float *dest = beatcorr.data() + firstBlock[i] * skipstep;
+
+        for (int j = windowStart; j < windowLen; j ++)
+        {
+            xcorr[j] += xcorrParts[i][j];
+        }
+        for (int j = 0; j < (int)beatParts[i].size(); j ++)
+        {
+            dest[j] += beat[j];
+        }
+    }
+
+    // detect the beats as 'updateBeatPos' does after each block
+    double posScale = (double)this->decimateBy / (double)this->sampleRate;
+    int resetDur = (int)(0.12 / posScale + 0.5);
+
+    for (int b = 0; b < numBlocks; b ++)
+    {
+        float scale = getBeatScale(skipstep);
+
+        for (i = 0; i < skipstep; i ++)
+        {
+            detectBeat(beatcorr[b * skipstep + i], scale, skipstep, posScale, resetDur);
+        }
+    }
+#else
+    (void)numThreads;
+    inputSamples(samples, numSamples);
+#endif // SOUNDTOUCH_FLOAT_SAMPLES
+}
@@ -0,0 +1,390 @@
+////////////////////////////////////////////////////////////////////////////////
+///
+/// Complex FFT of power-of-two sizes for fast correlations, see
+/// 'CorrelationFFT.h'.
+///
+////////////////////////////////////////////////////////////////////////////////
+//
+// License :
+//
+//  SoundTouch audio processing library
+//  Copyright (c) Olli Parviainen
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU Lesser General Public
+//  License as published by the Free Software Foundation; either
+//  version 2.1 of the License, or (at your option) any later version.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include <assert.h>
+#include <math.h>
+#include "STTypes.h"
+#include "CorrelationFFT.h"
+
+#include "simd_vector.h"
+
+#ifdef SIMD_HAVE_FLOAT4
+    // the butterflies of a stage are independent, do 4 at a time
+    #define FFT_VECTOR  Float4
+#else
+    #define FFT_VECTOR  float
+#endif
+
+using namespace soundtouch;
+
+namespace
+{
+    // Complex values of 'Lanes<V>::count' consecutive butterflies
+    template <class V> struct Complex
+    {
+        V re;
+        V im;
+    };
+
+    template <class V> inline Complex<V> loadComplex(const float *re, const float *im)
+    {
+        Complex<V> c = { load<V>(re), load<V>(im) };
+        return c;
+    }
+
+    template <class V> inline void storeComplex(float *re, float *im, const Complex<V> &c)
+    {
+        store(re, c.re);
+        store(im, c.im);
+    }
+
+    template <class V> inline Complex<V> operator+(const Complex<V> &a, const Complex<V> &b)
+    {
+        Complex<V> c = { a.re + b.re, a.im + b.im };
+        return c;
+    }
+
+    template <class V> inline Complex<V> operator-(const Complex<V> &a, const Complex<V> &b)
+    {
+        Complex<V> c = { a.re - b.re, a.im - b.im };
+        return c;
+    }
+
+    // a * w
+    template <class V> inline Complex<V> mul(const Complex<V> &a, const Complex<V> &w)
+    {
+        Complex<V> c = { a.re * w.re - a.im * w.im, a.re * w.im + a.im * w.re };
+        return c;
+    }
+
+    // a * conj(w)
+    template <class V> inline Complex<V> mulConj(const Complex<V> &a, const Complex<V> &w)
+    {
+        Complex<V> c = { a.re * w.re + a.im * w.im, a.im * w.re - a.re * w.im };
+        return c;
+    }
+
+    // a * i
+    template <class V> inline Complex<V> mulI(const Complex<V> &a)
+    {
+        Complex<V> c = { V{} - a.im, a.re };
+        return c;
+    }
+
+
+    // Radix-4 decimation in frequency stage on groups of 4 * 'quarter' values
+    template <class V>
+    void forwardStage(float *re, float *im, int size, int quarter, const float *twRe, const float *twIm)
+    {
+        for (int start = 0; start < size; start += 4 * quarter)
+        {
+            float *r = re + start;
+            float *i = im + start;
+
+            for (int k = 0; k < quarter; k += Lanes<V>::count)
+            {
+                Complex<V> a0 = loadComplex<V>(r + k, i + k);
+                Complex<V> a1 = loadComplex<V>(r + k + quarter, i + k + quarter);
+                Complex<V> a2 = loadComplex<V>(r + k + 2 * quarter, i + k + 2 * quarter);
+                Complex<V> a3 = loadComplex<V>(r + k + 3 * quarter, i + k + 3 * quarter);
+
+                // two radix-2 steps: sums & differences of the halves, then of
+                // the quarters, with the twiddles w^k, w^2k, w^3k
+                Complex<V> s = a0 + a2;
+                Complex<V> u = a0 - a2;
+                Complex<V> t = a1 + a3;
+                Complex<V> v = mulI(a3 - a1);
+
+                storeComplex(r + k, i + k, s + t);
+                storeComplex(r + k + quarter, i + k + quarter,
+                             mul(s - t, loadComplex<V>(twRe + k + quarter, twIm + k + quarter)));
+                storeComplex(r + k + 2 * quarter, i + k + 2 * quarter,
+                             mul(u + v, loadComplex<V>(twRe + k, twIm + k)));
+                storeComplex(r + k + 3 * quarter, i + k + 3 * quarter,
+                             mul(u - v, loadComplex<V>(twRe + k + 2 * quarter, twIm + k + 2 * quarter)));
+            }
+        }
+    }
+
+
+    // Inverse of 'forwardStage' scaled by 4: decimation in time with conjugate twiddles
+    template <class V>
+    void inverseStage(float *re, float *im, int size, int quarter, const float *twRe, const float *twIm)
+    {
+        for (int start = 0; start < size; start += 4 * quarter)
+        {
+            float *r = re + start;
+            float *i = im + start;
+
+            for (int k = 0; k < quarter; k += Lanes<V>::count)
+            {
+                Complex<V> x0 = loadComplex<V>(r + k, i + k);
+                Complex<V> x1 = mulConj(loadComplex<V>(r + k + quarter, i + k + quarter),
+                                        loadComplex<V>(twRe + k + quarter, twIm + k + quarter));
+                Complex<V> x2 = mulConj(loadComplex<V>(r + k + 2 * quarter, i + k + 2 * quarter),
+                                        loadComplex<V>(twRe + k, twIm + k));
+                Complex<V> x3 = mulConj(loadComplex<V>(r + k + 3 * quarter, i + k + 3 * quarter),
+                                        loadComplex<V>(twRe + k + 2 * quarter, twIm + k + 2 * quarter));
+
+                Complex<V> s = x0 + x1;
+                Complex<V> t = x0 - x1;
+                Complex<V> u = x2 + x3;
+                Complex<V> v = mulI(x2 - x3);
+
+                storeComplex(r + k, i + k, s + u);
+                storeComplex(r + k + quarter, i + k + quarter, t + v);
+                storeComplex(r + k + 2 * quarter, i + k + 2 * quarter, s - u);
+                storeComplex(r + k + 3 * quarter, i + k + 3 * quarter, t - v);
+            }
+        }
+    }
+
+
+    // 'forwardStage' for quarter 1, where all twiddles are 1. Written on the
+    // whole arrays so that the compiler vectorizes it across the groups.
+    void forwardLastStage(float *re, float *im, int size)
+    {
+        for (int i = 0; i < size; i += 4)
+        {
+            float sr = re[i] + re[i + 2], si = im[i] + im[i + 2];
+            float ur = re[i] - re[i + 2], ui = im[i] - im[i + 2];
+            float tr = re[i + 1] + re[i + 3], ti = im[i + 1] + im[i + 3];
+            float vr = im[i + 1] - im[i + 3], vi = re[i + 3] - re[i + 1];
+
+            re[i] = sr + tr;
+            im[i] = si + ti;
+            re[i + 1] = sr - tr;
+            im[i + 1] = si - ti;
+            re[i + 2] = ur + vr;
+            im[i + 2] = ui + vi;
+            re[i + 3] = ur - vr;
+            im[i + 3] = ui - vi;
+        }
+    }
+
+
+    // 'inverseStage' for quarter 1
+    void inverseFirstStage(float *re, float *im, int size)
+    {
+        for (int i = 0; i < size; i += 4)
+        {
+            float sr = re[i] + re[i + 1], si = im[i] + im[i + 1];
+            float tr = re[i] - re[i + 1], ti = im[i] - im[i + 1];
+            float ur = re[i + 2] + re[i + 3], ui = im[i + 2] + im[i + 3];
+            float vr = im[i + 3] - im[i + 2], vi = re[i + 2] - re[i + 3];
+
+            re[i] = sr + ur;
+            im[i] = si + ui;
+            re[i + 1] = tr + vr;
+            im[i + 1] = ti + vi;
+            re[i + 2] = sr - ur;
+            im[i + 2] = si - ui;
+            re[i + 3] = tr - vr;
+            im[i + 3] = ti - vi;
+        }
+    }
+
+
+    // Radix-2 decimation in frequency stage on the two halves, with the twiddles w^k
+    template <class V>
+    void forwardHalfStage(float *re, float *im, int half, const float *twRe, const float *twIm)
+    {
+        for (int k = 0; k < half; k += Lanes<V>::count)
+        {
+            Complex<V> a = loadComplex<V>(re + k, im + k);
+            Complex<V> b = loadComplex<V>(re + k + half, im + k + half);
+
+            storeComplex(re + k, im + k, a + b);
+            storeComplex(re + k + half, im + k + half, mul(a - b, loadComplex<V>(twRe + k, twIm + k)));
+        }
+    }
+
+
+    // Inverse of 'forwardHalfStage' scaled by 2
+    template <class V>
+    void inverseHalfStage(float *re, float *im, int half, const float *twRe, const float *twIm)
+    {
+        for (int k = 0; k < half; k += Lanes<V>::count)
+        {
+            Complex<V> a = loadComplex<V>(re + k, im + k);
+            Complex<V> b = mulConj(loadComplex<V>(re + k + half, im + k + half),
+                                   loadComplex<V>(twRe + k, twIm + k));
+
+            storeComplex(re + k, im + k, a + b);
+            storeComplex(re + k + half, im + k + half, a - b);
+        }
+    }
+}
+
+
+CorrelationFFT::CorrelationFFT()
+{
+    size = 0;
+    capacity = 0;
+}
+
+
+void CorrelationFFT::reserve(int maxSize)
+{
+    if (maxSize <= capacity) return;
+
+    // at most 'size' twiddles: size / 2 for the radix-2 stage and 3/4 of
+    // each radix-4 stage's group size, the stages shrinking by four
+    twiddleRe.reserve(maxSize);
+    twiddleIm.reserve(maxSize);
+    capacity = maxSize;
+}
+
+
+void CorrelationFFT::setSize(int newSize)
+{
+    assert(newSize >= 8 && (newSize & (newSize - 1)) == 0);
+    if (newSize == size) return;
+
+    size = newSize;
+    twiddleRe.clear();
+    twiddleIm.clear();
+
+    if (isOddPower())
+    {
+        // radix-2 stage first, with twiddles w^k for k < size / 2
+        for (int k = 0; k < size / 2; k ++)
+        {
+            double angle = -2.0 * M_PI * k / size;
+            twiddleRe.push_back((float)cos(angle));
+            twiddleIm.push_back((float)sin(angle));
+        }
+    }
+
+    // a radix-4 stage combines groups of 4 * quarter values with twiddles
+    // w^k, w^2k, w^3k for k < quarter, where w = exp(-2 pi i / (4 * quarter))
+    for (int quarter = firstQuarter(); quarter >= 1; quarter /= 4)
+    {
+        for (int m = 1; m <= 3; m ++)
+        {
+            for (int k = 0; k < quarter; k ++)
+            {
+                double angle = -2.0 * M_PI * m * k / (4 * quarter);
+                twiddleRe.push_back((float)cos(angle));
+                twiddleIm.push_back((float)sin(angle));
+            }
+        }
+    }
+    assert(size > capacity || (int)twiddleRe.size() <= capacity);
+}
+
+
+int CorrelationFFT::sizeFor(int length)
+{
+    int newSize = 8;
+    while (newSize < length) newSize *= 2;
+    return newSize;
+}
+
+
+bool CorrelationFFT::isOddPower() const
+{
+    return (size & 0x55555555) == 0;
+}
+
+
+int CorrelationFFT::firstQuarter() const
+{
+    return isOddPower() ? size / 8 : size / 4;
+}
+
+
+void CorrelationFFT::forward(float *re, float *im) const
+{
+    const float *twRe = twiddleRe.data();
+    const float *twIm = twiddleIm.data();
+
+    assert(size > 0);
+
+    if (isOddPower())
+    {
+        forwardHalfStage<FFT_VECTOR>(re, im, size / 2, twRe, twIm);
+        twRe += size / 2;
+        twIm += size / 2;
+    }
+
+    for (int quarter = firstQuarter(); quarter >= 1; quarter /= 4)
+    {
+        if (quarter == 1)
+        {
+            forwardLastStage(re, im, size);
+        }
+        else
+        {
+            forwardStage<FFT_VECTOR>(re, im, size, quarter, twRe, twIm);
+        }
+        twRe += 3 * quarter;
+        twIm += 3 * quarter;
+    }
+}
+
+
+void CorrelationFFT::inverse(float *re, float *im) const
+{
+    const float *twRe = twiddleRe.data() + twiddleRe.size();
+    const float *twIm = twiddleIm.data() + twiddleIm.size();
+
+    assert(size > 0);
+
+    // stages of 'forward' in reverse order
+    for (int quarter = 1; quarter <= firstQuarter(); quarter *= 4)
+    {
+        twRe -= 3 * quarter;
+        twIm -= 3 * quarter;
+        if (quarter == 1)
+        {
+            inverseFirstStage(re, im, size);
+        }
+        else
+        {
+            inverseStage<FFT_VECTOR>(re, im, size, quarter, twRe, twIm);
+        }
+    }
+
+    if (isOddPower())
+    {
+        inverseHalfStage<FFT_VECTOR>(re, im, size / 2, twiddleRe.data(), twiddleIm.data());
+    }
+}
+
+
+void CorrelationFFT::accumulateCorrelation(const float *aRe, const float *aIm,
+                                           const float *bRe, const float *bIm,
+                                           float *accRe, float *accIm) const
+{
+    for (int i = 0; i < size; i ++)
+    {
+        accRe[i] += aRe[i] * bRe[i] + aIm[i] * bIm[i];
+        accIm[i] += aIm[i] * bRe[i] - aRe[i] * bIm[i];
+    }
+}
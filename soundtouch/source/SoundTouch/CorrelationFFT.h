@@ -0,0 +1,105 @@
+////////////////////////////////////////////////////////////////////////////////
+///
+/// Complex FFT of power-of-two sizes for fast correlations.
+///
+/// The forward transform is a decimation in frequency and leaves the spectrum
+/// in a permuted order, the inverse is a decimation in time that takes it in
+/// that order. Correlations and convolutions only multiply spectra bin by bin,
+/// so neither transform needs the bit-reversal permutation. Values are kept in
+/// separate real & imaginary arrays and the stages are radix-4, so that the
+/// butterfly loops vectorize.
+///
+/// A correlation of real signals packs two of them, e.g. the channels of a
+/// stereo signal, as the real & imaginary parts of one complex signal: the
+/// real part of the complex correlation is the sum of the two correlations.
+///
+////////////////////////////////////////////////////////////////////////////////
+//
+// License :
+//
+//  SoundTouch audio processing library
+//  Copyright (c) Olli Parviainen
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU Lesser General Public
+//  License as published by the Free Software Foundation; either
+//  version 2.1 of the License, or (at your option) any later version.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef _CorrelationFFT_H_
+#define _CorrelationFFT_H_
+
+#include <vector>
+
+namespace soundtouch
+{
+
+class CorrelationFFT
+{
+private:
+    int size;
+    int capacity;
+
+    // twiddles of the radix-2 stage if any, then w^k, w^2k, w^3k of each
+    // radix-4 stage, largest stage first
+    std::vector<float> twiddleRe;
+    std::vector<float> twiddleIm;
+
+    /// Sizes 2 * 4^k have a radix-2 stage before the radix-4 ones
+    bool isOddPower() const;
+
+    /// Quarter of the group size of the first radix-4 stage
+    int firstQuarter() const;
+
+public:
+    CorrelationFFT();
+
+    /// Sets the transform size, a power of two (minimum 8).
+    void setSize(int newSize);
+
+    int getSize() const
+    {
+        return size;
+    }
+
+    /// Allocates for sizes up to 'maxSize', setSize() with such sizes then
+    /// doesn't allocate.
+    void reserve(int maxSize);
+
+    /// Largest size that setSize() can set without allocating.
+    int getCapacity() const
+    {
+        return capacity;
+    }
+
+    /// Returns the smallest allowed transform size that is at least 'length'.
+    static int sizeFor(int length);
+
+    /// In-place forward transform, the result is in a permuted order.
+    void forward(float *re, float *im) const;
+
+    /// In-place inverse of 'forward', scaled by 'size': the result of
+    /// inverse(forward(x)) is size * x.
+    void inverse(float *re, float *im) const;
+
+    /// Multiplies spectrum 'a' with the complex conjugate of spectrum 'b' and
+    /// adds the result to 'acc', which gives the correlation of the signals of
+    /// 'a' and 'b' after the inverse transform.
+    void accumulateCorrelation(const float *aRe, const float *aIm,
+                               const float *bRe, const float *bIm,
+                               float *accRe, float *accIm) const;
+};
+
+}
+
+#endif  // _CorrelationFFT_H_
@@ -43,8 +43,57 @@
 
 #include "FIFOSampleBuffer.h"
 
+#if defined(__linux__) && !defined(SOUNDTOUCH_DISABLE_MIRRORED_FIFO)
+    #include <sys/mman.h>
+    #include <sys/syscall.h>
+    #include <unistd.h>
+    // memfd_create() wrapper needs glibc 2.27 / Android API 30, the syscall is older
+    #ifdef __NR_memfd_create
+        #define SOUNDTOUCH_MIRRORED_FIFO
+    #endif
+#endif
+
 using namespace soundtouch;
 
+#ifdef SOUNDTOUCH_MIRRORED_FIFO
+
+// Maps 'size' bytes of shared memory twice to consecutive virtual addresses.
+// 'size' must be a multiple of the page size. Returns nullptr on failure.
+static SAMPLETYPE *createMirror(uint size)
+{
+    void *reserved;
+    void *mapping;
+    int memfd;
+
+    memfd = (int)syscall(__NR_memfd_create, "soundtouch_fifo", 0);
+    if (memfd < 0) return nullptr;
+
+    // reserve address space for both halves, then map the memory over each
+    reserved = mmap(nullptr, 2 * (size_t)size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if ((ftruncate(memfd, size) != 0) || (reserved == MAP_FAILED))
+    {
+        if (reserved != MAP_FAILED) munmap(reserved, 2 * (size_t)size);
+        close(memfd);
+        return nullptr;
+    }
+    for (int half = 0; half < 2; half ++)
+    {
+        mapping = mmap((char *)reserved + half * (size_t)size, size, PROT_READ | PROT_WRITE,
+                       MAP_FIXED | MAP_SHARED, memfd, 0);
+        if (mapping == MAP_FAILED)
+        {
+            munmap(reserved, 2 * (size_t)size);
+            close(memfd);
+            return nullptr;
+        }
+    }
+    // the mappings keep the memory alive
+    close(memfd);
+    return (SAMPLETYPE *)reserved;
+}
+
+#endif // SOUNDTOUCH_MIRRORED_FIFO
+
 // Constructor
 FIFOSampleBuffer::FIFOSampleBuffer(int numChannels)
 {
@@ -52,6 +101,7 @@ FIFOSampleBuffer::FIFOSampleBuffer(int numChannels)
     sizeInBytes = 0; // reasonable initial value
     buffer = nullptr;
     bufferUnaligned = nullptr;
+    mirrored = false;
     samplesInBuffer = 0;
     bufferPos = 0;
     channels = (uint)numChannels;
@@ -62,9 +112,23 @@ FIFOSampleBuffer::FIFOSampleBuffer(int numChannels)
 // destructor
 FIFOSampleBuffer::~FIFOSampleBuffer()
 {
+    freeBuffer();
+}
+
+
+// Releases the sample storage
+void FIFOSampleBuffer::freeBuffer()
+{
+#ifdef SOUNDTOUCH_MIRRORED_FIFO
+    if (mirrored)
+    {
+        munmap(buffer, 2 * (size_t)sizeInBytes);
+    }
+#endif
     delete[] bufferUnaligned;
     bufferUnaligned = nullptr;
     buffer = nullptr;
+    mirrored = false;
 }
 
 
@@ -86,7 +150,7 @@ void FIFOSampleBuffer::setChannels(int numChannels)
 // location on to the beginning of the buffer.
 void FIFOSampleBuffer::rewind()
 {
-    if (buffer && bufferPos)
+    if (buffer && bufferPos && !mirrored)
     {
         memmove(buffer, ptrBegin(), sizeof(SAMPLETYPE) * channels * samplesInBuffer);
         bufferPos = 0;
@@ -134,7 +198,7 @@ void FIFOSampleBuffer::putSamples(uint nSamples)
 SAMPLETYPE *FIFOSampleBuffer::ptrEnd(uint slackCapacity)
 {
     ensureCapacity(samplesInBuffer + slackCapacity);
-    return buffer + samplesInBuffer * channels;
+    return ptrBegin() + samplesInBuffer * channels;
 }
 
 
@@ -148,7 +212,7 @@ SAMPLETYPE *FIFOSampleBuffer::ptrEnd(uint slackCapacity)
 SAMPLETYPE *FIFOSampleBuffer::ptrBegin()
 {
     assert(buffer);
-    return buffer + bufferPos * channels;
+    return buffer + bufferPos;
 }
 
 
@@ -156,29 +220,52 @@ SAMPLETYPE *FIFOSampleBuffer::ptrBegin()
 // 'capacityRequirement' number of samples. The buffer is grown in steps of
 // 4 kilobytes to eliminate the need for frequently growing up the buffer,
 // as well as to round the buffer size up to the virtual memory page size.
+// The mirrored buffer is rounded up to the actual page size instead.
 void FIFOSampleBuffer::ensureCapacity(uint capacityRequirement)
 {
     SAMPLETYPE *tempUnaligned, *temp;
+    uint newSize;
+    bool newMirrored = false;
 
     if (capacityRequirement > getCapacity())
     {
         // enlarge the buffer in 4kbyte steps (round up to next 4k boundary)
-        sizeInBytes = (capacityRequirement * channels * sizeof(SAMPLETYPE) + 4095) & (uint)-4096;
-        assert(sizeInBytes % 2 == 0);
-        tempUnaligned = new SAMPLETYPE[sizeInBytes / sizeof(SAMPLETYPE) + 16 / sizeof(SAMPLETYPE)];
-        if (tempUnaligned == nullptr)
+        newSize = (capacityRequirement * channels * sizeof(SAMPLETYPE) + 4095) & (uint)-4096;
+        assert(newSize % 2 == 0);
+        tempUnaligned = nullptr;
+        temp = nullptr;
+
+#ifdef SOUNDTOUCH_MIRRORED_FIFO
+        const uint pageSize = (uint)sysconf(_SC_PAGESIZE);
+        const uint mirrorSize = (newSize + pageSize - 1) / pageSize * pageSize;
+
+        temp = createMirror(mirrorSize);
+        if (temp)
+        {
+            newSize = mirrorSize;
+            newMirrored = true;
+        }
+#endif
+        if (temp == nullptr)
         {
-            ST_THROW_RT_ERROR("Couldn't allocate memory!\n");
+            // plain storage, also if the mapping fails
+            tempUnaligned = new SAMPLETYPE[newSize / sizeof(SAMPLETYPE) + 16 / sizeof(SAMPLETYPE)];
+            if (tempUnaligned == nullptr)
+            {
+                ST_THROW_RT_ERROR("Couldn't allocate memory!\n");
+            }
+            // Align the buffer to begin at 16byte cache line boundary for optimal performance
+            temp = (SAMPLETYPE *)SOUNDTOUCH_ALIGN_POINTER_16(tempUnaligned);
         }
-        // Align the buffer to begin at 16byte cache line boundary for optimal performance
-        temp = (SAMPLETYPE *)SOUNDTOUCH_ALIGN_POINTER_16(tempUnaligned);
         if (samplesInBuffer)
         {
             memcpy(temp, ptrBegin(), samplesInBuffer * channels * sizeof(SAMPLETYPE));
         }
-        delete[] bufferUnaligned;
+        freeBuffer();
         buffer = temp;
         bufferUnaligned = tempUnaligned;
+        sizeInBytes = newSize;
+        mirrored = newMirrored;
         bufferPos = 0;
     }
     else
@@ -234,7 +321,12 @@ uint FIFOSampleBuffer::receiveSamples(uint maxSamples)
     }
 
     samplesInBuffer -= maxSamples;
-    bufferPos += maxSamples;
+    bufferPos += maxSamples * channels;
+    if (mirrored && (bufferPos >= sizeInBytes / sizeof(SAMPLETYPE)))
+    {
+        // continue from the same memory in the first half of the mapping
+        bufferPos -= sizeInBytes / sizeof(SAMPLETYPE);
+    }
 
     return maxSamples;
 }
@@ -44,6 +44,7 @@
 #include <stdlib.h>
 #include "FIRFilter.h"
 #include "cpu_detect.h"
+#include "simd_vector.h"
 
 using namespace soundtouch;
 
@@ -61,6 +62,9 @@ FIRFilter::FIRFilter()
     lengthDiv8 = 0;
     filterCoeffs = nullptr;
     filterCoeffsStereo = nullptr;
+    numFoldedPairs = 0;
+    foldedPairs = nullptr;
+    foldedCoeffs = nullptr;
 }
 
 
@@ -68,6 +72,8 @@ FIRFilter::~FIRFilter()
 {
     delete[] filterCoeffs;
     delete[] filterCoeffsStereo;
+    delete[] foldedPairs;
+    delete[] foldedCoeffs;
 }
 
 
@@ -199,6 +205,71 @@ uint FIRFilter::evaluateFilterMulti(SAMPLETYPE *dest, const SAMPLETYPE *src, uin
 }
 
 
+#ifdef SOUNDTOUCH_FLOAT_SAMPLES
+
+// Filter routine for symmetric kernels, any number of channels. Uses the 4-lane
+// vectors where the compiler has them, the baseline x86-64 & ARM64 instruction
+// sets include them.
+uint FIRFilter::evaluateFolded(float *dest, const float *src, uint numSamples, uint numChannels) const
+{
+    assert(numFoldedPairs > 0);
+    assert(numSamples > length);
+
+#ifdef SIMD_HAVE_FLOAT4
+    return filterFolded<Float4>(dest, src, numSamples, numChannels, length, foldedPairs, foldedCoeffs, numFoldedPairs);
+#else
+    return filterFolded<float>(dest, src, numSamples, numChannels, length, foldedPairs, foldedCoeffs, numFoldedPairs);
+#endif
+}
+
+#endif // SOUNDTOUCH_FLOAT_SAMPLES
+
+
+// Folds a linear phase kernel, i.e. one symmetric around tap 'length / 2' like
+// the AAFilter design, or around the middle of the taps, to pairs of taps that
+// share a coefficient. A tap that has no pair, e.g. the centre tap, is paired
+// with itself at half the coefficient. Leaves 'numFoldedPairs' zero if the
+// kernel isn't symmetric.
+//
+// Integer sample builds don't fold, halving the odd taps would lose precision.
+void FIRFilter::foldCoefficients()
+{
+    numFoldedPairs = 0;
+
+#ifdef SOUNDTOUCH_FLOAT_SAMPLES
+    uint first, i, n;
+
+    for (first = 0; first < 2; first ++)
+    {
+        // symmetric over taps 'first' ... 'length - 1'?
+        for (i = first; i < length; i ++)
+        {
+            if (filterCoeffs[i] != filterCoeffs[first + length - 1 - i]) break;
+        }
+        if (i == length) break;
+    }
+    if (first == 2) return;
+
+    n = 0;
+    for (i = 0; i < length; i ++)
+    {
+        uint pair = (i < first) ? i : first + length - 1 - i;
+        SAMPLETYPE coeff = (pair == i) ? filterCoeffs[i] / 2 : filterCoeffs[i];
+
+        if (pair < i) break;            // rest of the taps paired already
+        if (coeff == 0) continue;       // e.g. zero taps of a half-band filter
+
+        foldedPairs[2 * n] = i;
+        foldedPairs[2 * n + 1] = pair;
+        foldedCoeffs[n] = coeff;
+        n ++;
+    }
+    assert(n <= length / 2 + 1);
+    numFoldedPairs = n;
+#endif // SOUNDTOUCH_FLOAT_SAMPLES
+}
+
+
 // Set filter coeffiecients and length.
 //
 // Throws an exception if filter length isn't divisible by 8
@@ -207,12 +278,19 @@ void FIRFilter::setCoefficients(const SAMPLETYPE *coeffs, uint newLength, uint u
     assert(newLength > 0);
     if (newLength % 8) ST_THROW_RT_ERROR("FIR filter length not divisible by 8");
 
-    #ifdef SOUNDTOUCH_FLOAT_SAMPLES
-        // scale coefficients already here if using floating samples
-        double scale = 1.0 / resultDivider;
-    #else
-        short scale = 1;
-    #endif
+    // reuse the buffers if only the coefficients change, e.g. with a new
+    // anti-alias filter cut-off frequency
+    if (newLength != length)
+    {
+        delete[] filterCoeffs;
+        filterCoeffs = new SAMPLETYPE[newLength];
+        delete[] filterCoeffsStereo;
+        filterCoeffsStereo = new SAMPLETYPE[newLength * 2];
+        delete[] foldedPairs;
+        foldedPairs = new uint[newLength + 2];
+        delete[] foldedCoeffs;
+        foldedCoeffs = new SAMPLETYPE[newLength / 2 + 1];
+    }
 
     lengthDiv8 = newLength / 8;
     length = lengthDiv8 * 8;
@@ -221,10 +299,13 @@ void FIRFilter::setCoefficients(const SAMPLETYPE *coeffs, uint newLength, uint u
     resultDivFactor = uResultDivFactor;
     resultDivider = (SAMPLETYPE)::pow(2.0, (int)resultDivFactor);
 
-    delete[] filterCoeffs;
-    filterCoeffs = new SAMPLETYPE[length];
-    delete[] filterCoeffsStereo;
-    filterCoeffsStereo = new SAMPLETYPE[length*2];
+    #ifdef SOUNDTOUCH_FLOAT_SAMPLES
+        // scale coefficients already here if using floating samples
+        double scale = 1.0 / resultDivider;
+    #else
+        short scale = 1;
+    #endif
+
     for (uint i = 0; i < length; i ++)
     {
         filterCoeffs[i] = (SAMPLETYPE)(coeffs[i] * scale);
@@ -233,6 +314,8 @@ void FIRFilter::setCoefficients(const SAMPLETYPE *coeffs, uint newLength, uint u
         filterCoeffsStereo[2 * i] = (SAMPLETYPE)(coeffs[i] * scale);
         filterCoeffsStereo[2 * i + 1] = (SAMPLETYPE)(coeffs[i] * scale);
     }
+
+    foldCoefficients();
 }
 
 
@@ -253,6 +336,14 @@ uint FIRFilter::evaluate(SAMPLETYPE *dest, const SAMPLETYPE *src, uint numSample
 
     if (numSamples < length) return 0;
 
+#ifdef SOUNDTOUCH_FLOAT_SAMPLES
+    if (numFoldedPairs)
+    {
+        assert(numChannels > 0);
+        return evaluateFolded(dest, src, numSamples, numChannels);
+    }
+#endif // SOUNDTOUCH_FLOAT_SAMPLES
+
 #ifndef USE_MULTICH_ALWAYS
     if (numChannels == 1)
     {
@@ -288,7 +379,7 @@ FIRFilter * FIRFilter::newInstance()
     uExtensions = detectCPUextensions();
     (void)uExtensions;
 
-    // Check if MMX/SSE instruction set extensions supported by CPU
+    // Check if MMX/SSE/AVX2/NEON instruction set extensions supported by CPU
 
 #ifdef SOUNDTOUCH_ALLOW_MMX
     // MMX routines available only with integer sample types
@@ -299,6 +390,15 @@ FIRFilter * FIRFilter::newInstance()
     else
 #endif // SOUNDTOUCH_ALLOW_MMX
 
+#ifdef SOUNDTOUCH_ALLOW_AVX2
+    if (uExtensions & SUPPORT_AVX2)
+    {
+        // AVX2 & FMA support
+        return ::new FIRFilterAVX2;
+    }
+    else
+#endif // SOUNDTOUCH_ALLOW_AVX2
+
 #ifdef SOUNDTOUCH_ALLOW_SSE
     if (uExtensions & SUPPORT_SSE)
     {
@@ -308,6 +408,15 @@ FIRFilter * FIRFilter::newInstance()
     else
 #endif // SOUNDTOUCH_ALLOW_SSE
 
+#ifdef SOUNDTOUCH_ALLOW_NEON
+    if (uExtensions & SUPPORT_NEON)
+    {
+        // ARM NEON support
+        return ::new FIRFilterNEON;
+    }
+    else
+#endif // SOUNDTOUCH_ALLOW_NEON
+
     {
         // ISA optimizations not supported, use plain C version
         return ::new FIRFilter;
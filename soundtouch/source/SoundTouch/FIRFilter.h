@@ -59,6 +59,14 @@ protected:
     SAMPLETYPE *filterCoeffs;
     SAMPLETYPE *filterCoeffsStereo;
 
+    // Linear phase kernel folded to pairs of taps that share a coefficient, so
+    // that the two samples of a pair are added before the multiply. Taps with
+    // zero coefficient, e.g. every other tap of a half-band filter, are left
+    // out. 'numFoldedPairs' is zero if the kernel isn't symmetric.
+    uint numFoldedPairs;
+    uint *foldedPairs;
+    SAMPLETYPE *foldedCoeffs;
+
     virtual uint evaluateFilterStereo(SAMPLETYPE *dest,
                                       const SAMPLETYPE *src,
                                       uint numSamples) const;
@@ -67,6 +75,13 @@ protected:
                                     uint numSamples) const;
     virtual uint evaluateFilterMulti(SAMPLETYPE *dest, const SAMPLETYPE *src, uint numSamples, uint numChannels);
 
+#ifdef SOUNDTOUCH_FLOAT_SAMPLES
+    virtual uint evaluateFolded(float *dest, const float *src, uint numSamples, uint numChannels) const;
+#endif
+
+    /// Folds the symmetric taps of 'filterCoeffs' to 'foldedPairs'
+    void foldCoefficients();
+
 public:
     FIRFilter();
     virtual ~FIRFilter();
@@ -122,19 +137,49 @@ public:
     class FIRFilterSSE : public FIRFilter
     {
     protected:
-        float *filterCoeffsUnalign;
-        float *filterCoeffsAlign;
-
         virtual uint evaluateFilterStereo(float *dest, const float *src, uint numSamples) const override;
-    public:
-        FIRFilterSSE();
-        ~FIRFilterSSE();
-
-        virtual void setCoefficients(const float *coeffs, uint newLength, uint uResultDivFactor) override;
     };
 
 #endif // SOUNDTOUCH_ALLOW_SSE
 
+
+#ifdef SOUNDTOUCH_ALLOW_AVX2
+    // AVX2/FMA routines, see 'avx2_optimized.cpp'
+    uint evaluateFilterStereoAVX2(float *dest, const float *src, uint numSamples, const float *coeffs, uint length);
+    uint evaluateFoldedAVX2(float *dest, const float *src, uint numSamples, uint numChannels, uint length,
+                            const uint *pairs, const float *coeffs, uint numPairs);
+
+    /// Class that implements AVX2/FMA optimized functions exclusive for floating point samples type.
+    /// Defined inline so that no code of the class is compiled with AVX2 enabled.
+    class FIRFilterAVX2 : public FIRFilter
+    {
+    protected:
+        virtual uint evaluateFilterStereo(float *dest, const float *src, uint numSamples) const override
+        {
+            // 'filterCoeffs' are scaled by the result divider already
+            return evaluateFilterStereoAVX2(dest, src, numSamples, filterCoeffs, length);
+        }
+
+        virtual uint evaluateFolded(float *dest, const float *src, uint numSamples, uint numChannels) const override
+        {
+            return evaluateFoldedAVX2(dest, src, numSamples, numChannels, length,
+                                      foldedPairs, foldedCoeffs, numFoldedPairs);
+        }
+    };
+
+#endif // SOUNDTOUCH_ALLOW_AVX2
+
+
+#ifdef SOUNDTOUCH_ALLOW_NEON
+    /// Class that implements ARM NEON optimized functions exclusive for floating point samples type.
+    class FIRFilterNEON : public FIRFilter
+    {
+    protected:
+        virtual uint evaluateFilterStereo(float *dest, const float *src, uint numSamples) const override;
+    };
+
+#endif // SOUNDTOUCH_ALLOW_NEON
+
 }
 
 #endif  // FIRFilter_H
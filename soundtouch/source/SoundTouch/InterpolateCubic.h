@@ -62,6 +62,16 @@ public:
     {
         return 1;
     }
+
+    virtual double getPhase() const override
+    {
+        return fract;
+    }
+
+    virtual void setPhase(double phase) override
+    {
+        fract = phase;
+    }
 };
 
 }
@@ -173,6 +173,18 @@ void InterpolateLinearInteger::setRate(double newRate)
 }
 
 
+double InterpolateLinearInteger::getPhase() const
+{
+    return (double)iFract / SCALE;
+}
+
+
+void InterpolateLinearInteger::setPhase(double phase)
+{
+    iFract = (int)(phase * SCALE);
+}
+
+
 //////////////////////////////////////////////////////////////////////////////
 //
 // InterpolateLinearFloat - floating point arithmetic implementation
@@ -65,6 +65,9 @@ public:
     {
         return 0;
     }
+
+    virtual double getPhase() const override;
+    virtual void setPhase(double phase) override;
 };
 
 
@@ -91,6 +94,16 @@ public:
     {
         return 0;
     }
+
+    virtual double getPhase() const
+    {
+        return fract;
+    }
+
+    virtual void setPhase(double phase)
+    {
+        fract = phase;
+    }
 };
 
 }
@@ -0,0 +1,311 @@
+////////////////////////////////////////////////////////////////////////////////
+///
+/// Sample interpolation routine using 8-tap Kaiser windowed sinc filters from a
+/// precomputed polyphase table.
+///
+////////////////////////////////////////////////////////////////////////////////
+//
+// License :
+//
+//  SoundTouch audio processing library
+//  Copyright (c) Olli Parviainen
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU Lesser General Public
+//  License as published by the Free Software Foundation; either
+//  version 2.1 of the License, or (at your option) any later version.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include <math.h>
+#include "InterpolatePolyphase.h"
+#include "simd_vector.h"
+#include "STTypes.h"
+
+using namespace soundtouch;
+
+#ifdef SOUNDTOUCH_FLOAT_SAMPLES
+
+#define POLYPHASE_TAPS      8
+#define POLYPHASE_PHASES    128
+
+/// Kaiser window shape parameter, trades passband flatness for stopband attenuation
+#define POLYPHASE_KAISER_BETA   5.0
+
+#ifdef SIMD_HAVE_FLOAT4
+    #define POLYPHASE_VECTOR    Float4
+#else
+    #define POLYPHASE_VECTOR    float
+#endif
+
+namespace
+{
+    /// Filter taps of each phase followed by their differences to the next
+    /// phase, so that the taps at phase 'p + t' are 'taps + t * delta'.
+    /// The stereo table repeats each tap for the left & right channel.
+    struct PolyphaseTables
+    {
+        float mono[POLYPHASE_PHASES][2][POLYPHASE_TAPS];
+        float stereo[POLYPHASE_PHASES][2][2 * POLYPHASE_TAPS];
+
+        PolyphaseTables();
+    };
+
+
+    // Zeroth order modified Bessel function of the first kind
+    double besselI0(double x)
+    {
+        double sum = 1.0;
+        double term = 1.0;
+
+        for (int k = 1; k < 50; k ++)
+        {
+            term *= (x / (2 * k)) * (x / (2 * k));
+            sum += term;
+            if (term < 1e-12 * sum) break;
+        }
+        return sum;
+    }
+
+
+    // Taps for interpolating at fraction 'fract' past the 4th input sample
+    void calcTaps(double fract, double *taps)
+    {
+        const double half = POLYPHASE_TAPS / 2;
+        double sum = 0;
+
+        for (int i = 0; i < POLYPHASE_TAPS; i ++)
+        {
+            double x = (i - (half - 1)) - fract;
+            double sinc = (fabs(x) < 1e-9) ? 1.0 : sin(M_PI * x) / (M_PI * x);
+            double w = 1.0 - (x / half) * (x / half);
+            double window = besselI0(POLYPHASE_KAISER_BETA * sqrt(w > 0 ? w : 0)) / besselI0(POLYPHASE_KAISER_BETA);
+
+            taps[i] = sinc * window;
+            sum += taps[i];
+        }
+        // unity gain at DC
+        for (int i = 0; i < POLYPHASE_TAPS; i ++)
+        {
+            taps[i] /= sum;
+        }
+    }
+
+
+    PolyphaseTables::PolyphaseTables()
+    {
+        double taps[POLYPHASE_TAPS];
+        double next[POLYPHASE_TAPS];
+
+        calcTaps(0, taps);
+        for (int p = 0; p < POLYPHASE_PHASES; p ++)
+        {
+            calcTaps((double)(p + 1) / POLYPHASE_PHASES, next);
+            for (int i = 0; i < POLYPHASE_TAPS; i ++)
+            {
+                mono[p][0][i] = (float)taps[i];
+                mono[p][1][i] = (float)(next[i] - taps[i]);
+                stereo[p][0][2 * i] = stereo[p][0][2 * i + 1] = mono[p][0][i];
+                stereo[p][1][2 * i] = stereo[p][1][2 * i + 1] = mono[p][1][i];
+                taps[i] = next[i];
+            }
+        }
+    }
+
+
+    const PolyphaseTables &getTables()
+    {
+        static const PolyphaseTables tables;
+        return tables;
+    }
+
+
+    // Sum of 'count' products of 'src' and the taps interpolated between the
+    // 'table' rows, as vectors of the same lanes. 'count' must be divisible
+    // by the vector length.
+    template <class V>
+    inline V interpolate(const float *src, const float *table, int count, float t)
+    {
+        const V vt = splat<V>(t);
+        V sum = splat<V>(0);
+
+        for (int i = 0; i < count; i += Lanes<V>::count)
+        {
+            sum += load<V>(src + i) * (load<V>(table + i) + vt * load<V>(table + count + i));
+        }
+        return sum;
+    }
+}
+
+
+InterpolatePolyphase::InterpolatePolyphase()
+{
+    fract = 0;
+    // build the tables before the first transposing
+    getTables();
+}
+
+
+void InterpolatePolyphase::resetRegisters()
+{
+    fract = 0;
+}
+
+
+/// Transpose mono audio. Returns number of produced output samples, and
+/// updates "srcSamples" to amount of consumed source samples
+int InterpolatePolyphase::transposeMono(SAMPLETYPE *pdest,
+                    const SAMPLETYPE *psrc,
+                    int &srcSamples)
+{
+    const PolyphaseTables &tables = getTables();
+    int i;
+    int srcSampleEnd = srcSamples - POLYPHASE_TAPS;
+    int srcCount = 0;
+
+    i = 0;
+    while (srcCount < srcSampleEnd)
+    {
+        assert(fract < 1.0);
+
+        // 'fract' < 1 keeps the phase index below POLYPHASE_PHASES
+        double phase = fract * POLYPHASE_PHASES;
+        int p = (int)phase;
+        float t = (float)(phase - p);
+        POLYPHASE_VECTOR sum = interpolate<POLYPHASE_VECTOR>(psrc, tables.mono[p][0], POLYPHASE_TAPS, t);
+
+        pdest[i] = sumLanes(sum);
+        i ++;
+
+        // update position fraction
+        fract += rate;
+        // update whole positions
+        int whole = (int)fract;
+        fract -= whole;
+        psrc += whole;
+        srcCount += whole;
+    }
+    srcSamples = srcCount;
+    return i;
+}
+
+
+/// Transpose stereo audio. Returns number of produced output samples, and
+/// updates "srcSamples" to amount of consumed source samples
+int InterpolatePolyphase::transposeStereo(SAMPLETYPE *pdest,
+                    const SAMPLETYPE *psrc,
+                    int &srcSamples)
+{
+    const PolyphaseTables &tables = getTables();
+    int i;
+    int srcSampleEnd = srcSamples - POLYPHASE_TAPS;
+    int srcCount = 0;
+
+    i = 0;
+    while (srcCount < srcSampleEnd)
+    {
+        assert(fract < 1.0);
+
+        // 'fract' < 1 keeps the phase index below POLYPHASE_PHASES
+        double phase = fract * POLYPHASE_PHASES;
+        int p = (int)phase;
+        float t = (float)(phase - p);
+        float out0, out1;
+
+#ifdef SIMD_HAVE_FLOAT4
+        // lanes 0 & 2 sum the left channel products, lanes 1 & 3 the right channel
+        Float4 sum = interpolate<Float4>(psrc, tables.stereo[p][0], 2 * POLYPHASE_TAPS, t);
+        float lanes[4];
+
+        store(lanes, sum);
+        out0 = lanes[0] + lanes[2];
+        out1 = lanes[1] + lanes[3];
+#else
+        out0 = out1 = 0;
+        for (int j = 0; j < POLYPHASE_TAPS; j ++)
+        {
+            float tap = tables.mono[p][0][j] + t * tables.mono[p][1][j];
+            out0 += psrc[2 * j] * tap;
+            out1 += psrc[2 * j + 1] * tap;
+        }
+#endif
+
+        pdest[2*i]   = out0;
+        pdest[2*i+1] = out1;
+        i ++;
+
+        // update position fraction
+        fract += rate;
+        // update whole positions
+        int whole = (int)fract;
+        fract -= whole;
+        psrc += 2*whole;
+        srcCount += whole;
+    }
+    srcSamples = srcCount;
+    return i;
+}
+
+
+/// Transpose multi-channel audio. Returns number of produced output samples, and
+/// updates "srcSamples" to amount of consumed source samples
+int InterpolatePolyphase::transposeMulti(SAMPLETYPE *pdest,
+                    const SAMPLETYPE *psrc,
+                    int &srcSamples)
+{
+    const PolyphaseTables &tables = getTables();
+    int i;
+    int srcSampleEnd = srcSamples - POLYPHASE_TAPS;
+    int srcCount = 0;
+
+    i = 0;
+    while (srcCount < srcSampleEnd)
+    {
+        float taps[POLYPHASE_TAPS];
+
+        assert(fract < 1.0);
+
+        // 'fract' < 1 keeps the phase index below POLYPHASE_PHASES
+        double phase = fract * POLYPHASE_PHASES;
+        int p = (int)phase;
+        float t = (float)(phase - p);
+
+        for (int j = 0; j < POLYPHASE_TAPS; j ++)
+        {
+            taps[j] = tables.mono[p][0][j] + t * tables.mono[p][1][j];
+        }
+        for (int c = 0; c < numChannels; c ++)
+        {
+            float out = 0;
+
+            for (int j = 0; j < POLYPHASE_TAPS; j ++)
+            {
+                out += psrc[numChannels * j + c] * taps[j];
+            }
+            *pdest = out;
+            pdest ++;
+        }
+        i ++;
+
+        // update position fraction
+        fract += rate;
+        // update whole positions
+        int whole = (int)fract;
+        fract -= whole;
+        psrc += numChannels * whole;
+        srcCount += whole;
+    }
+    srcSamples = srcCount;
+    return i;
+}
+
+#endif // SOUNDTOUCH_FLOAT_SAMPLES
@@ -67,6 +67,16 @@ public:
     {
         return 3;
     }
+
+    virtual double getPhase() const override
+    {
+        return fract;
+    }
+
+    virtual void setPhase(double phase) override
+    {
+        fract = phase;
+    }
 };
 
 }
@@ -32,6 +32,8 @@
 ////////////////////////////////////////////////////////////////////////////////
 
 #include <memory.h>
+#include <math.h>
+#include <algorithm>
 #include <assert.h>
 #include <stdlib.h>
 #include <stdio.h>
@@ -39,6 +41,7 @@
 #include "InterpolateLinear.h"
 #include "InterpolateCubic.h"
 #include "InterpolateShannon.h"
+#include "InterpolatePolyphase.h"
 #include "AAFilter.h"
 
 using namespace soundtouch;
@@ -60,7 +63,17 @@ RateTransposer::RateTransposer() : FIFOProcessor(&outputBuffer)
 
     // Instantiates the anti-alias filter
     pAAFilter = new AAFilter(64);
-    pTransposer = TransposerBase::newInstance();
+#ifdef SOUNDTOUCH_INTEGER_SAMPLES
+    // integer samples are always interpolated linearly
+    interpolation = TransposerBase::LINEAR;
+#else
+    interpolation = TransposerBase::getAlgorithm();
+#endif
+    pLinearTransposer = TransposerBase::newInstance(TransposerBase::LINEAR);
+    fullInterpolation = interpolation;
+    pFullTransposer = (interpolation == TransposerBase::LINEAR) ?
+        pLinearTransposer : TransposerBase::newInstance(interpolation);
+    pTransposer = pFullTransposer;
     clear();
 }
 
@@ -68,7 +81,11 @@ RateTransposer::RateTransposer() : FIFOProcessor(&outputBuffer)
 RateTransposer::~RateTransposer()
 {
     delete pAAFilter;
-    delete pTransposer;
+    if (pFullTransposer != pLinearTransposer)
+    {
+        delete pFullTransposer;
+    }
+    delete pLinearTransposer;
 }
 
 
@@ -90,6 +107,55 @@ bool RateTransposer::isAAFilterEnabled() const
 }
 
 
+void RateTransposer::setInterpolation(TransposerBase::ALGORITHM a)
+{
+#ifdef SOUNDTOUCH_INTEGER_SAMPLES
+    a = TransposerBase::LINEAR;
+#endif
+    if (a == interpolation) return;
+
+    double rate = pTransposer->rate;
+    int channels = pTransposer->numChannels;
+    TransposerBase *newTransposer;
+    if (a == TransposerBase::LINEAR)
+    {
+        newTransposer = pLinearTransposer;
+    }
+    else
+    {
+        if (a != fullInterpolation)
+        {
+            // first switch to this algorithm, not on a real-time path
+            if (pFullTransposer != pLinearTransposer)
+            {
+                delete pFullTransposer;
+            }
+            pFullTransposer = TransposerBase::newInstance(a);
+            fullInterpolation = a;
+        }
+        newTransposer = pFullTransposer;
+    }
+
+    newTransposer->setRate(rate);
+    if (channels > 0)
+    {
+        newTransposer->setChannels(channels);
+    }
+    else
+    {
+        newTransposer->resetRegisters();
+    }
+    pTransposer = newTransposer;
+    interpolation = a;
+}
+
+
+TransposerBase::ALGORITHM RateTransposer::getInterpolation() const
+{
+    return interpolation;
+}
+
+
 AAFilter *RateTransposer::getAAFilter()
 {
     return pAAFilter;
@@ -200,6 +266,43 @@ void RateTransposer::clear()
 }
 
 
+double RateTransposer::getOutputLag() const
+{
+    double rate = pTransposer->rate;
+    double before;      // samples not interpolated yet
+    double after;       // interpolated samples not output yet
+
+    before = inputBuffer.numSamples();
+    after = outputBuffer.numSamples();
+    if (bUseAAFilter && (rate >= 1.0f))
+    {
+        before += midBuffer.numSamples();
+    }
+    else
+    {
+        after += midBuffer.numSamples();
+    }
+    return before - pTransposer->getPhase() + after * rate;
+}
+
+
+void RateTransposer::setOutputLag(double lag, uint numInput)
+{
+    double rate = pTransposer->rate;
+    double first;
+    int skip;
+
+    // position of the first output sample counted from the beginning of
+    // inputBuffer, a whole number of output samples before the wanted one
+    first = inputBuffer.numSamples() + numInput - lag;
+    first -= rate * floor(first / rate);
+
+    skip = std::min((int)first, (int)inputBuffer.numSamples());
+    inputBuffer.receiveSamples(skip);
+    pTransposer->setPhase(first - skip);
+}
+
+
 // Returns nonzero if there aren't any samples available for outputting.
 int RateTransposer::isEmpty() const
 {
@@ -231,6 +334,12 @@ void TransposerBase::setAlgorithm(TransposerBase::ALGORITHM a)
 }
 
 
+TransposerBase::ALGORITHM TransposerBase::getAlgorithm()
+{
+    return TransposerBase::algorithm;
+}
+
+
 // Transposes the sample rate of the given samples using linear interpolation.
 // Returns the number of samples returned in the "dest" buffer
 int TransposerBase::transpose(FIFOSampleBuffer &dest, FIFOSampleBuffer &src)
@@ -287,14 +396,21 @@ void TransposerBase::setRate(double newRate)
 }
 
 
-// static factory function
+// static factory functions
 TransposerBase *TransposerBase::newInstance()
+{
+    return newInstance(algorithm);
+}
+
+
+TransposerBase *TransposerBase::newInstance(ALGORITHM a)
 {
 #ifdef SOUNDTOUCH_INTEGER_SAMPLES
+    (void)a;
     // Notice: For integer arithmetic support only linear algorithm (due to simplest calculus)
     return ::new InterpolateLinearInteger;
 #else
-    switch (algorithm)
+    switch (a)
     {
         case LINEAR:
             return new InterpolateLinearFloat;
@@ -305,6 +421,9 @@ TransposerBase *TransposerBase::newInstance()
         case SHANNON:
             return new InterpolateShannon;
 
+        case POLYPHASE:
+            return new InterpolatePolyphase;
+
         default:
             assert(false);
             return nullptr;
@@ -55,7 +55,8 @@ public:
         enum ALGORITHM {
         LINEAR = 0,
         CUBIC,
-        SHANNON
+        SHANNON,
+        POLYPHASE
     };
 
 protected:
@@ -85,8 +86,17 @@ public:
 
     virtual void resetRegisters() = 0;
 
-    // static factory function
+    /// Position of the next output sample between the two input samples it is
+    /// interpolated from, in range [0, 1)
+    virtual double getPhase() const = 0;
+    virtual void setPhase(double phase) = 0;
+
+    // static factory functions, for the algorithm set with setAlgorithm() or the given one
     static TransposerBase *newInstance();
+    static TransposerBase *newInstance(ALGORITHM a);
+
+    // algorithm used by newInstance()
+    static ALGORITHM getAlgorithm();
 
     // static function to set interpolation algorithm
     static void setAlgorithm(ALGORITHM a);
@@ -100,8 +110,18 @@ class RateTransposer : public FIFOProcessor
 protected:
     /// Anti-alias filter object
     AAFilter *pAAFilter;
+    /// Active interpolator, either pFullTransposer or pLinearTransposer
     TransposerBase *pTransposer;
 
+    /// Interpolator of the algorithm chosen with setInterpolation() and the linear
+    /// one, both kept allocated so that switching between them doesn't allocate
+    TransposerBase *pFullTransposer;
+    TransposerBase *pLinearTransposer;
+
+    /// Interpolation algorithms of pTransposer & pFullTransposer
+    TransposerBase::ALGORITHM interpolation;
+    TransposerBase::ALGORITHM fullInterpolation;
+
     /// Buffer for collecting samples to feed the anti-alias filter between
     /// two batches
     FIFOSampleBuffer inputBuffer;
@@ -138,6 +158,15 @@ public:
     /// Returns nonzero if anti-alias filter is enabled.
     bool isAAFilterEnabled() const;
 
+    /// Switches the interpolator to the given algorithm, keeping the rate & channels.
+    /// Samples already buffered are kept. Switching between LINEAR and the last
+    /// other algorithm used doesn't allocate, so it is safe on a real-time thread,
+    /// choosing yet another algorithm allocates its interpolator.
+    void setInterpolation(TransposerBase::ALGORITHM a);
+
+    /// Returns the interpolation algorithm in use
+    TransposerBase::ALGORITHM getInterpolation() const;
+
     /// Sets new target rate. Normal rate = 1.0, smaller values represent slower
     /// rate, larger faster rates.
     virtual void setRate(double newRate);
@@ -157,6 +186,17 @@ public:
 
     /// Return approximate initial input-output latency
     int getLatency() const;
+
+    /// Returns how far, in input samples, the position of the next sample this
+    /// object will output lies before the end of the input put so far. Output
+    /// samples stand for input positions 'rate' apart, so two instances at the
+    /// same rate output the same positions if these lags match modulo the rate.
+    double getOutputLag() const;
+
+    /// Sets the interpolation phase of a just cleared object so that once
+    /// 'numInput' more samples are put, its output positions match those of an
+    /// object whose getOutputLag() returns 'lag' at the same end of input.
+    void setOutputLag(double lag, uint numInput);
 };
 
 }
@@ -372,6 +372,17 @@ bool SoundTouch::setSetting(int settingId, int value)
             pTDStretch->enableQuickSeek((value != 0) ? true : false);
             return true;
 
+        case SETTING_USE_FFT_CORRELATION :
+            // enables / disables tempo routine FFT correlation
+            pTDStretch->enableFFTCorrelation((value != 0) ? true : false);
+            return true;
+
+        case SETTING_INTERPOLATION :
+            // changes the rate transposer interpolation algorithm
+            if (value < TransposerBase::LINEAR || value > TransposerBase::POLYPHASE) return false;
+            pRateTransposer->setInterpolation((TransposerBase::ALGORITHM)value);
+            return true;
+
         case SETTING_SEQUENCE_MS:
             // change time-stretch sequence duration parameter
             pTDStretch->setParameters(sampleRate, value, seekWindowMs, overlapMs);
@@ -412,6 +423,12 @@ int SoundTouch::getSetting(int settingId) const
         case SETTING_USE_QUICKSEEK :
             return (uint)pTDStretch->isQuickSeekEnabled();
 
+        case SETTING_USE_FFT_CORRELATION :
+            return (uint)pTDStretch->isFFTCorrelationEnabled();
+
+        case SETTING_INTERPOLATION :
+            return (int)pRateTransposer->getInterpolation();
+
         case SETTING_SEQUENCE_MS:
             pTDStretch->getParameters(nullptr, &temp, nullptr, nullptr);
             return temp;
@@ -529,6 +546,101 @@ uint SoundTouch::receiveSamples(uint maxSamples)
 }
 
 
+/// Gives direct access to the processed samples that are ready for output.
+uint SoundTouch::peekOutput(const SAMPLETYPE **samples)
+{
+    uint num = numSamples();
+
+    *samples = num ? ptrBegin() : nullptr;
+    return num;
+}
+
+
+/// Removes samples accessed with 'peekOutput' from the output.
+uint SoundTouch::consume(uint maxSamples)
+{
+    return receiveSamples(maxSamples);
+}
+
+
+/// Returns how many of the samples put in have not come out yet, in input samples
+double SoundTouch::getPendingInputSamples() const
+{
+    double pending = samplesExpectedOut - (double)samplesOutput;
+    return (pending > 0) ? pending * tempo * rate : 0;
+}
+
+
+bool SoundTouch::isAlignableTo(const SoundTouch &reference) const
+{
+    return (channels == reference.channels) && (rate == reference.rate) && (tempo == reference.tempo) &&
+           (pRateTransposer->getInterpolation() == reference.pRateTransposer->getInterpolation()) &&
+           (pRateTransposer->isAAFilterEnabled() == reference.pRateTransposer->isAAFilterEnabled()) &&
+           pTDStretch->isAlignableTo(*reference.pTDStretch);
+}
+
+
+uint SoundTouch::prepareAlignment(const SoundTouch &reference)
+{
+    clear();
+    if (!isAlignableTo(reference)) return 0;
+
+    // the rate transposer runs before the time-stretch when the rate is at most 1,
+    // see putSamples()
+    bool transposeFirst = (output == pTDStretch);
+    int latency = pRateTransposer->getLatency();
+    double lag = reference.pRateTransposer->getOutputLag();
+
+    // time-stretch output still to come out of 'reference', and the sequence to repeat from
+    uint numOutput = transposeFirst ? reference.numSamples() :
+        (uint)ceil(reference.numSamples() * rate + lag) + 1;
+    long position = reference.pTDStretch->getAlignmentPosition(numOutput);
+    if (position < 0) return 0;
+
+    pTDStretch->alignTo(*reference.pTDStretch, position);
+
+    double numStretchInput = (double)(reference.pTDStretch->getInputPosition() - position);
+    if (!transposeFirst) return (uint)numStretchInput;
+
+    // input for the rate transposer to output that, plus a margin for it to settle,
+    // interpolated at the same positions as in 'reference'
+    uint numInput = (uint)ceil(numStretchInput * rate + lag) + 2 * latency + 16;
+    pRateTransposer->setOutputLag(lag, numInput);
+    return numInput;
+}
+
+
+bool SoundTouch::finishAlignment(const SoundTouch &reference)
+{
+    long delay = 0;
+    if (output == pTDStretch)
+    {
+        // both time-stretch inputs end on the same grid of positions, but not
+        // necessarily on the same position of it
+        delay = lround((pRateTransposer->getOutputLag() - reference.pRateTransposer->getOutputLag()) / rate);
+    }
+    if (!pTDStretch->replayAlignment(*reference.pTDStretch, delay)) return false;
+    if (output == pRateTransposer)
+    {
+        pRateTransposer->setOutputLag(reference.pRateTransposer->getOutputLag(), pTDStretch->numSamples());
+        pRateTransposer->moveSamples(*pTDStretch);
+    }
+
+    // the output before the sequences of 'reference' still buffered is of no use
+    if (numSamples() < reference.numSamples()) return false;
+    FIFOProcessor::receiveSamples(numSamples() - reference.numSamples());
+
+    pTDStretch->endAlignment();
+    if (output == pRateTransposer)
+    {
+        pRateTransposer->moveSamples(*pTDStretch);
+    }
+    samplesExpectedOut = reference.samplesExpectedOut;
+    samplesOutput = reference.samplesOutput;
+    return true;
+}
+
+
 /// Get ratio between input and output audio durations, useful for calculating
 /// processed output duration: if you'll process a stream of N samples, then
 /// you can expect to get out N * getInputOutputSampleRatio() samples.
@@ -45,6 +45,7 @@
 #include <assert.h>
 #include <math.h>
 #include <float.h>
+#include <algorithm>
 
 #include "STTypes.h"
 #include "cpu_detect.h"
@@ -54,6 +55,12 @@ using namespace soundtouch;
 
 #define max(x, y) (((x) > (y)) ? (x) : (y))
 
+// Seek window length times overlap length, in sample frames, from which on the
+// FFT correlation is faster than the direct search. Measured on x86-64 with AVX2,
+// where the direct search is fastest; at 44.1 kHz and above every seek window of
+// the automatic settings is past it.
+#define FFT_CORRELATION_MIN_FRAMES  32768
+
 /*****************************************************************************
  *
  * Implementation of the class 'TDStretch'
@@ -64,15 +71,21 @@ using namespace soundtouch;
 TDStretch::TDStretch() : FIFOProcessor(&outputBuffer)
 {
     bQuickSeek = false;
+    bFFTCorrelation = true;
     channels = 2;
 
     pMidBuffer = nullptr;
     pMidBufferUnaligned = nullptr;
+    midBufferSize = 0;
     overlapLength = 0;
 
     bAutoSeqSetting = true;
     bAutoSeekSetting = true;
 
+    historyNominalSkip = 0;
+    historySeekWindowLength = 0;
+    historyOverlapLength = 0;
+
     tempo = 1.0f;
     setParameters(44100, DEFAULT_SEQUENCE_MS, DEFAULT_SEEKWINDOW_MS, DEFAULT_OVERLAP_MS);
     setTempo(1.0f);
@@ -136,6 +149,10 @@ void TDStretch::setParameters(int aSampleRate, int aSequenceMS,
 
     calculateOverlapLength(overlapMs);
 
+#ifdef SOUNDTOUCH_FLOAT_SAMPLES
+    reserveFFTCorrelation();
+#endif
+
     // set tempo to recalculate 'sampleReq'
     setTempo(tempo);
 }
@@ -202,6 +219,14 @@ void TDStretch::clearInput()
     maxnorm = 0;
     maxnormf = 1e8;
     skipFract = 0;
+    inputPosition = 0;
+    historyCount = 0;
+    historyEnd = 0;
+    replayCount = 0;
+    replayNext = 0;
+    replayPosition = 0;
+    replaySkip = 0;
+    replayHold = false;
 }
 
 
@@ -229,6 +254,20 @@ bool TDStretch::isQuickSeekEnabled() const
 }
 
 
+// Enables/disables the FFT correlation of the full seek
+void TDStretch::enableFFTCorrelation(bool enable)
+{
+    bFFTCorrelation = enable;
+}
+
+
+// Returns nonzero if the FFT correlation is enabled.
+bool TDStretch::isFFTCorrelationEnabled() const
+{
+    return bFFTCorrelation;
+}
+
+
 // Seeks for the optimal overlap-mixing position.
 int TDStretch::seekBestOverlapPosition(const SAMPLETYPE *refPos)
 {
@@ -274,6 +313,19 @@ inline void TDStretch::overlap(SAMPLETYPE *pOutput, const SAMPLETYPE *pInput, ui
 // sample sequences are 'most alike', in terms of the highest cross-correlation
 // value over the overlapping period
 int TDStretch::seekBestOverlapPositionFull(const SAMPLETYPE *refPos)
+{
+#ifdef SOUNDTOUCH_FLOAT_SAMPLES
+    if (useFFTCorrelation())
+    {
+        return seekBestOverlapPositionFFT(refPos);
+    }
+#endif
+    return seekBestOverlapPositionDirect(refPos);
+}
+
+
+// Full seek by calculating the correlation of each offset directly
+int TDStretch::seekBestOverlapPositionDirect(const SAMPLETYPE *refPos)
 {
     int bestOffs;
     double bestCorr;
@@ -631,15 +683,37 @@ void TDStretch::processSamples()
     }
     */
 
+    if (replaySkip > 0)
+    {
+        // input before the first sequence repeated by alignTo()
+        temp = (int)std::min<long>(replaySkip, (long)inputBuffer.numSamples());
+        inputBuffer.receiveSamples((uint)temp);
+        inputPosition += temp;
+        replaySkip -= temp;
+        if (replaySkip > 0) return;
+    }
+
     // Process samples as long as there are enough samples in 'inputBuffer'
     // to form a processing frame.
-    while ((int)inputBuffer.numSamples() >= sampleReq)
+    while (((int)inputBuffer.numSamples() >= sampleReq) && (replayHold == false))
     {
+        // sequences repeated from another instance by alignTo() take its overlap position
+        bool replay = (replayNext < replayCount);
+        if (replay)
+        {
+            offset = replayOffsets[replayNext ++];
+            replayHold = (replayNext == replayCount);
+        }
+
         if (isBeginning == false)
         {
             // apart from the very beginning of the track,
             // scan for the best overlapping position & do overlap-add
-            offset = seekBestOverlapPosition(inputBuffer.ptrBegin());
+            if (replay == false)
+            {
+                offset = seekBestOverlapPosition(inputBuffer.ptrBegin());
+            }
+            recordSequence(offset);
 
             // Mix the samples in the 'inputBuffer' at position of 'offset' with the
             // samples in 'midBuffer' using sliding overlapping
@@ -653,7 +727,9 @@ void TDStretch::processSamples()
         {
             // Adjust processing offset at beginning of track by not perform initial overlapping
             // and compensating that in the 'input buffer skip' calculation
+            recordSequence(-1);
             isBeginning = false;
+            offset = 0;
             int skip = (int)(tempo * overlapLength + 0.5 * seekLength + 0.5);
 
             #ifdef ST_SIMD_AVOID_UNALIGNED
@@ -700,7 +776,113 @@ void TDStretch::processSamples()
         ovlSkip = (int)skipFract;   // rounded to integer skip
         skipFract -= ovlSkip;       // maintain the fraction part, i.e. real vs. integer skip
         inputBuffer.receiveSamples((uint)ovlSkip);
+        inputPosition += ovlSkip;
+    }
+}
+
+
+// Remembers the sequence about to be processed at the head of 'inputBuffer'
+void TDStretch::recordSequence(int offset)
+{
+    if ((historyNominalSkip != nominalSkip) || (historySeekWindowLength != seekWindowLength) ||
+        (historyOverlapLength != overlapLength))
+    {
+        // sequences of another geometry can't be repeated with this one
+        historyCount = 0;
+        historyNominalSkip = nominalSkip;
+        historySeekWindowLength = seekWindowLength;
+        historyOverlapLength = overlapLength;
+    }
+
+    SequenceRecord &record = history[historyEnd];
+    record.position = inputPosition;
+    record.offset = offset;
+    record.skipFract = skipFract;
+    historyEnd = (historyEnd + 1) % SEQUENCE_HISTORY;
+    if (historyCount < SEQUENCE_HISTORY) historyCount ++;
+}
+
+
+// Output samples a remembered sequence produced
+int TDStretch::getOutputLength(const SequenceRecord &record) const
+{
+    int length = seekWindowLength - 2 * overlapLength;
+    return (record.offset < 0) ? length : length + overlapLength;
+}
+
+
+bool TDStretch::isAlignableTo(const TDStretch &other) const
+{
+    return (channels == other.channels) && (tempo == other.tempo) &&
+           (nominalSkip == other.nominalSkip) && (sampleReq == other.sampleReq) &&
+           (seekWindowLength == other.seekWindowLength) && (seekLength == other.seekLength) &&
+           (overlapLength == other.overlapLength);
+}
+
+
+long TDStretch::getAlignmentPosition(uint numOutput) const
+{
+    // sequences from the latest back until they cover the output, and one more whose end
+    // is the overlap of the first of them
+    long covered = 0;
+    for (int i = 1; i <= historyCount; i ++)
+    {
+        const SequenceRecord &record = history[(historyEnd + SEQUENCE_HISTORY - i) % SEQUENCE_HISTORY];
+        if (covered >= (long)numOutput) return record.position;
+        covered += getOutputLength(record);
+        // nothing before the beginning of the stream
+        if (record.offset < 0) return record.position;
+    }
+    return -1;
+}
+
+
+void TDStretch::alignTo(const TDStretch &reference, long position)
+{
+    clear();
+
+    // the remembered sequences from the one at 'position' on
+    int count = 1;
+    while ((count <= reference.historyCount) &&
+           (reference.history[(reference.historyEnd + SEQUENCE_HISTORY - count) % SEQUENCE_HISTORY].position != position))
+    {
+        count ++;
     }
+    if (count > reference.historyCount) return;
+    int first = (reference.historyEnd + SEQUENCE_HISTORY - count) % SEQUENCE_HISTORY;
+
+    const SequenceRecord &record = reference.history[first];
+    isBeginning = (record.offset < 0);
+    skipFract = record.skipFract;
+    maxnorm = reference.maxnorm;
+    maxnormf = reference.maxnormf;
+    overlapDividerBitsNorm = reference.overlapDividerBitsNorm;
+
+    for (int i = 0; i < count; i ++)
+    {
+        replayOffsets[replayCount ++] = reference.history[(first + i) % SEQUENCE_HISTORY].offset;
+    }
+    replayPosition = position;
+    replayHold = true;
+}
+
+
+bool TDStretch::replayAlignment(const TDStretch &reference, long delay)
+{
+    replaySkip = getInputPosition() + delay - (reference.getInputPosition() - replayPosition);
+    if (replaySkip < 0) return false;
+    replayHold = false;
+    processSamples();
+    return true;
+}
+
+
+void TDStretch::endAlignment()
+{
+    replayCount = 0;
+    replayNext = 0;
+    replayHold = false;
+    processSamples();
 }
 
 
@@ -727,11 +909,17 @@ void TDStretch::acceptNewOverlapLength(int newOverlapLength)
 
     if (overlapLength > prevOvl)
     {
-        delete[] pMidBufferUnaligned;
+        // keep the buffer of a longer overlap used before, so that switching back
+        // to it doesn't allocate
+        if (overlapLength * channels > midBufferSize)
+        {
+            delete[] pMidBufferUnaligned;
 
-        pMidBufferUnaligned = new SAMPLETYPE[overlapLength * channels + 16 / sizeof(SAMPLETYPE)];
-        // ensure that 'pMidBuffer' is aligned to 16 byte boundary for efficiency
-        pMidBuffer = (SAMPLETYPE *)SOUNDTOUCH_ALIGN_POINTER_16(pMidBufferUnaligned);
+            midBufferSize = overlapLength * channels;
+            pMidBufferUnaligned = new SAMPLETYPE[midBufferSize + 16 / sizeof(SAMPLETYPE)];
+            // ensure that 'pMidBuffer' is aligned to 16 byte boundary for efficiency
+            pMidBuffer = (SAMPLETYPE *)SOUNDTOUCH_ALIGN_POINTER_16(pMidBufferUnaligned);
+        }
 
         clearMidBuffer();
     }
@@ -755,7 +943,7 @@ TDStretch * TDStretch::newInstance()
     uExtensions = detectCPUextensions();
     (void)uExtensions;
 
-    // Check if MMX/SSE instruction set extensions supported by CPU
+    // Check if MMX/SSE/AVX2/NEON instruction set extensions supported by CPU
 
 #ifdef SOUNDTOUCH_ALLOW_MMX
     // MMX routines available only with integer sample types
@@ -767,6 +955,15 @@ TDStretch * TDStretch::newInstance()
 #endif // SOUNDTOUCH_ALLOW_MMX
 
 
+#ifdef SOUNDTOUCH_ALLOW_AVX2
+    if (uExtensions & SUPPORT_AVX2)
+    {
+        // AVX2 & FMA support
+        return ::new TDStretchAVX2;
+    }
+    else
+#endif // SOUNDTOUCH_ALLOW_AVX2
+
 #ifdef SOUNDTOUCH_ALLOW_SSE
     if (uExtensions & SUPPORT_SSE)
     {
@@ -776,6 +973,15 @@ TDStretch * TDStretch::newInstance()
     else
 #endif // SOUNDTOUCH_ALLOW_SSE
 
+#ifdef SOUNDTOUCH_ALLOW_NEON
+    if (uExtensions & SUPPORT_NEON)
+    {
+        // ARM NEON support
+        return ::new TDStretchNEON;
+    }
+    else
+#endif // SOUNDTOUCH_ALLOW_NEON
+
     {
         // ISA optimizations not supported, use plain C version
         return ::new TDStretch;
@@ -1085,4 +1291,121 @@ double TDStretch::calcCrossCorrAccumulate(const float *mixingPos, const float *c
 }
 
 
+
+// Returns true if the full seek should use the FFT correlation: it is enabled, the
+// seek geometry is large enough for it to pay off and setParameters() has sized the
+// work space for it
+bool TDStretch::useFFTCorrelation() const
+{
+    if (!bFFTCorrelation) return false;
+    if (seekLength * overlapLength < FFT_CORRELATION_MIN_FRAMES) return false;
+
+    const int fftSize = CorrelationFFT::sizeFor(seekLength - 1 + overlapLength);
+    return corrBuffer.size() >= (size_t)(6 * fftSize) && corrFFT.getCapacity() >= fftSize;
+}
+
+
+// Sizes the FFT correlation for the longest seek window of the current settings,
+// the automatic seek window is longest at the lowest tempo
+void TDStretch::reserveFFTCorrelation()
+{
+    int maxSeekMs = bAutoSeekSetting ? max(seekWindowMs, (int)(AUTOSEEK_AT_MIN + 0.5)) : seekWindowMs;
+    int maxSeekLength = (sampleRate * maxSeekMs) / 1000;
+    const int fftSize = CorrelationFFT::sizeFor(maxSeekLength - 1 + overlapLength);
+
+    corrFFT.reserve(fftSize);
+    if (corrBuffer.size() < (size_t)(6 * fftSize))
+    {
+        corrBuffer.resize(6 * fftSize);
+    }
+}
+
+
+// Seeks for the optimal overlap-mixing position like 'seekBestOverlapPositionFull',
+// but calculates the correlations of all the offsets at once as an FFT cross-
+// correlation of the seek window and 'pMidBuffer'. Channels are transformed in
+// pairs as the real & imaginary parts of a complex signal, the real part of the
+// correlation of such complex signals sums the correlations of both channels.
+// The normalizing energy of each offset is a running sum over the seek window.
+int TDStretch::seekBestOverlapPositionFFT(const float *refPos)
+{
+    // sample frames that the correlations of all the offsets span
+    const int refFrames = seekLength - 1 + overlapLength;
+    const int length = channels * overlapLength;
+    const int fftSize = CorrelationFFT::sizeFor(refFrames);
+    int bestOffs;
+    double bestCorr;
+    double norm;
+    int i;
+
+    assert(corrBuffer.size() >= (size_t)(6 * fftSize));
+    corrFFT.setSize(fftSize);
+    float *refRe = corrBuffer.data();
+    float *refIm = refRe + fftSize;
+    float *midRe = refIm + fftSize;
+    float *midIm = midRe + fftSize;
+    float *corrRe = midIm + fftSize;
+    float *corrIm = corrRe + fftSize;
+
+    memset(corrRe, 0, 2 * fftSize * sizeof(float));
+    for (int c = 0; c < channels; c += 2)
+    {
+        // an odd channel count leaves the last channel without a pair
+        const bool pair = (c + 1 < channels);
+
+        // zero padding to the transform size keeps the correlation from wrapping around
+        memset(refRe, 0, 4 * fftSize * sizeof(float));
+        for (i = 0; i < refFrames; i ++)
+        {
+            refRe[i] = refPos[channels * i + c];
+            if (pair) refIm[i] = refPos[channels * i + c + 1];
+        }
+        for (i = 0; i < overlapLength; i ++)
+        {
+            midRe[i] = pMidBuffer[channels * i + c];
+            if (pair) midIm[i] = pMidBuffer[channels * i + c + 1];
+        }
+
+        corrFFT.forward(refRe, refIm);
+        corrFFT.forward(midRe, midIm);
+        corrFFT.accumulateCorrelation(refRe, refIm, midRe, midIm, corrRe, corrIm);
+    }
+    // correlation of offset 'i' at index 'i', scaled by 'fftSize'
+    corrFFT.inverse(corrRe, corrIm);
+
+    norm = 0;
+    for (i = 0; i < length; i ++)
+    {
+        norm += refPos[i] * refPos[i];
+    }
+
+    bestCorr = -FLT_MAX;
+    bestOffs = 0;
+    for (i = 0; i < seekLength; i ++)
+    {
+        if (i > 0)
+        {
+            // slide the energy window by one sample frame
+            const float *prev = refPos + channels * (i - 1);
+            for (int c = 0; c < channels; c ++)
+            {
+                norm += prev[length + c] * prev[length + c] - prev[c] * prev[c];
+            }
+        }
+        double corr = corrRe[i] / ((double)fftSize * sqrt((norm < 1e-9 ? 1.0 : norm)));
+
+        // heuristic rule to slightly favour values close to mid of the range
+        double tmp = (double)(2 * i - seekLength) / (double)seekLength;
+        corr = ((corr + 0.1) * (1.0 - 0.25 * tmp * tmp));
+
+        if (corr > bestCorr)
+        {
+            bestCorr = corr;
+            bestOffs = i;
+        }
+    }
+
+    return bestOffs;
+}
+
 #endif // SOUNDTOUCH_FLOAT_SAMPLES
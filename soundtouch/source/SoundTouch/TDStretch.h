@@ -4,7 +4,7 @@
 /// while maintaining the original pitch by using a time domain WSOLA-like method
 /// with several performance-increasing tweaks.
 ///
-/// Note : MMX/SSE optimized functions reside in separate, platform-specific files
+/// Note : MMX/SSE/AVX2/NEON optimized functions reside in separate, platform-specific files
 /// 'mmx_optimized.cpp' and 'sse_optimized.cpp'
 ///
 /// Author        : Copyright (c) Olli Parviainen
@@ -38,9 +38,11 @@
 #define TDStretch_H
 
 #include <stddef.h>
+#include <vector>
 #include "STTypes.h"
 #include "RateTransposer.h"
 #include "FIFOSamplePipe.h"
+#include "CorrelationFFT.h"
 
 namespace soundtouch
 {
@@ -98,6 +100,11 @@ namespace soundtouch
 #define DEFAULT_OVERLAP_MS      8
 
 
+/// Number of latest processing sequences remembered for aligning another instance
+/// to this one, see 'alignTo'. Has to cover the output kept buffered.
+#define SEQUENCE_HISTORY        16
+
+
 /// Class that does the time-stretch (tempo change) effect for the processed
 /// sound.
 class TDStretch : public FIFOProcessor
@@ -125,12 +132,50 @@ protected:
     double skipFract;
 
     bool bQuickSeek;
+    bool bFFTCorrelation;
     bool bAutoSeqSetting;
     bool bAutoSeekSetting;
     bool isBeginning;
 
     SAMPLETYPE *pMidBuffer;
     SAMPLETYPE *pMidBufferUnaligned;
+    int midBufferSize;      ///< samples allocated for 'pMidBuffer', it only grows
+
+    // FFT correlation: transform and work space for the spectra of the seek
+    // window, the mid buffer and their correlation. Sized by setParameters() for
+    // the longest seek window the settings lead to, so that seeking doesn't allocate
+    CorrelationFFT corrFFT;
+    std::vector<float> corrBuffer;
+
+    /// A processed sequence, see 'history'
+    struct SequenceRecord
+    {
+        long position;          ///< input position of the sequence, counted from clear()
+        int offset;             ///< overlap position used, -1 at the beginning of the stream
+        double skipFract;       ///< 'skipFract' before the sequence
+    };
+
+    /// The latest processed sequences, a ring ending before 'historyEnd', and the
+    /// geometry they were processed with
+    SequenceRecord history[SEQUENCE_HISTORY];
+    int historyCount;
+    int historyEnd;
+    double historyNominalSkip;
+    int historySeekWindowLength;
+    int historyOverlapLength;
+
+    /// Input samples removed from 'inputBuffer' since clear()
+    long inputPosition;
+
+    /// Overlap positions taken from another instance by alignTo(), used instead of
+    /// seeking for the next 'replayCount - replayNext' sequences, after dropping
+    /// 'replaySkip' input samples. Processing holds while 'replayHold' is set.
+    int replayOffsets[SEQUENCE_HISTORY];
+    int replayCount;
+    int replayNext;
+    long replayPosition;
+    long replaySkip;
+    bool replayHold;
 
     FIFOSampleBuffer outputBuffer;
     FIFOSampleBuffer inputBuffer;
@@ -144,8 +189,14 @@ protected:
     virtual double calcCrossCorrAccumulate(const SAMPLETYPE *mixingPos, const SAMPLETYPE *compare, double &norm);
 
     virtual int seekBestOverlapPositionFull(const SAMPLETYPE *refPos);
+    int seekBestOverlapPositionDirect(const SAMPLETYPE *refPos);
     virtual int seekBestOverlapPositionQuick(const SAMPLETYPE *refPos);
     virtual int seekBestOverlapPosition(const SAMPLETYPE *refPos);
+#ifdef SOUNDTOUCH_FLOAT_SAMPLES
+    int seekBestOverlapPositionFFT(const float *refPos);
+    bool useFFTCorrelation() const;
+    void reserveFFTCorrelation();
+#endif
 
     virtual void overlapStereo(SAMPLETYPE *output, const SAMPLETYPE *input) const;
     virtual void overlapMono(SAMPLETYPE *output, const SAMPLETYPE *input) const;
@@ -156,6 +207,8 @@ protected:
 
     void calcSeqParameters();
     void adaptNormalizer();
+    void recordSequence(int offset);
+    int getOutputLength(const SequenceRecord &record) const;
 
     /// Changes the tempo of the given sound samples.
     /// Returns amount of samples returned in the "output" buffer.
@@ -202,6 +255,16 @@ public:
     /// Returns nonzero if the quick seeking algorithm is enabled.
     bool isQuickSeekEnabled() const;
 
+    /// Enables/disables computing the correlations of the full (non-quick) seek
+    /// with FFTs, which is used where the seek window & overlap are long enough for
+    /// it to be faster than the direct search. Same result as the direct search
+    /// within float rounding. Enabled by default, has effect with floating point
+    /// samples only.
+    void enableFFTCorrelation(bool enable);
+
+    /// Returns nonzero if the FFT correlation is enabled.
+    bool isFFTCorrelationEnabled() const;
+
     /// Sets routine control parameters. These control are certain time constants
     /// defining how the sound is stretched to the desired duration.
     //
@@ -246,6 +309,36 @@ public:
 	{
 		return sampleReq;
 	}
+
+    /// Returns nonzero if this instance processes with the same settings as 'other',
+    /// so that it can be aligned to it with alignTo().
+    bool isAlignableTo(const TDStretch &other) const;
+
+    /// Returns the input position (counted from clear()) of the earliest remembered
+    /// sequence another instance has to repeat to recreate the last 'numOutput'
+    /// samples of output, or -1 if that is further back than remembered.
+    long getAlignmentPosition(uint numOutput) const;
+
+    /// Clears this instance and sets it up to repeat the sequences of 'reference'
+    /// from the one at 'position' (see getAlignmentPosition()) on, with the same
+    /// overlap positions. From then on this instance splices its own stream where
+    /// 'reference' splices its stream. Only collects input until replayAlignment().
+    void alignTo(const TDStretch &reference, long position);
+
+    /// Drops the input collected since alignTo() that comes before 'position' of
+    /// 'reference', given that this input ends 'delay' samples before the input of
+    /// 'reference' does, and processes the repeated sequences. Holds after the last
+    /// one until endAlignment(). Returns false if there wasn't enough input.
+    bool replayAlignment(const TDStretch &reference, long delay);
+
+    /// Resumes processing after replayAlignment()
+    void endAlignment();
+
+    /// Input samples put since clear()
+    long getInputPosition() const
+    {
+        return inputPosition + (long)inputBuffer.numSamples();
+    }
 };
 
 
@@ -271,9 +364,53 @@ public:
     protected:
         double calcCrossCorr(const float *mixingPos, const float *compare, double &norm) override;
         double calcCrossCorrAccumulate(const float *mixingPos, const float *compare, double &norm) override;
+        virtual void overlapStereo(float *output, const float *input) const override;
     };
 
 #endif /// SOUNDTOUCH_ALLOW_SSE
 
+
+#ifdef SOUNDTOUCH_ALLOW_AVX2
+    // AVX2/FMA routines, see 'avx2_optimized.cpp'
+    double calcCrossCorrAVX2(const float *mixingPos, const float *compare, int count, double &norm);
+    double calcCrossCorrAccumulateAVX2(const float *mixingPos, const float *compare, int count, int channels, double &norm);
+    void overlapStereoAVX2(float *output, const float *input, const float *midBuffer, int overlapLength);
+
+    /// Class that implements AVX2/FMA optimized routines for floating point samples type.
+    /// Defined inline so that no code of the class is compiled with AVX2 enabled.
+    class TDStretchAVX2 : public TDStretch
+    {
+    protected:
+        double calcCrossCorr(const float *mixingPos, const float *compare, double &norm) override
+        {
+            return calcCrossCorrAVX2(mixingPos, compare, channels * overlapLength, norm);
+        }
+
+        double calcCrossCorrAccumulate(const float *mixingPos, const float *compare, double &norm) override
+        {
+            return calcCrossCorrAccumulateAVX2(mixingPos, compare, channels * overlapLength, channels, norm);
+        }
+
+        virtual void overlapStereo(float *output, const float *input) const override
+        {
+            overlapStereoAVX2(output, input, pMidBuffer, overlapLength);
+        }
+    };
+
+#endif /// SOUNDTOUCH_ALLOW_AVX2
+
+
+#ifdef SOUNDTOUCH_ALLOW_NEON
+    /// Class that implements ARM NEON optimized routines for floating point samples type.
+    class TDStretchNEON : public TDStretch
+    {
+    protected:
+        double calcCrossCorr(const float *mixingPos, const float *compare, double &norm) override;
+        double calcCrossCorrAccumulate(const float *mixingPos, const float *compare, double &norm) override;
+        virtual void overlapStereo(float *output, const float *input) const override;
+    };
+
+#endif /// SOUNDTOUCH_ALLOW_NEON
+
 }
 #endif  /// TDStretch_H
@@ -0,0 +1,125 @@
+////////////////////////////////////////////////////////////////////////////////
+///
+/// AVX2/FMA optimized routines for Haswell, Excavator and later x86 CPUs.
+///
+/// The routines are the portable kernels of 'simd_vector.h' instantiated with
+/// 8-float vectors. This file must be compiled with '-mavx2 -mfma' and is used
+/// only if 'detectCPUextensions' finds the CPU supports both, so the rest of
+/// the library keeps running on older x86 CPUs. The build system compiles it
+/// so and defines SOUNDTOUCH_ALLOW_AVX2 for the library, see CMakeLists.txt.
+///
+/// Unlike the SSE and NEON files this one has plain functions only. The
+/// classes 'TDStretchAVX2' and 'FIRFilterAVX2' that call them are defined
+/// inline in the headers, so that their vtables and the inline functions they
+/// inherit are compiled with the baseline instruction set elsewhere; if the
+/// linker picked an AVX2 compiled copy of e.g. 'FIFOProcessor::numSamples',
+/// older CPUs would fail on it.
+///
+////////////////////////////////////////////////////////////////////////////////
+//
+// License :
+//
+//  SoundTouch audio processing library
+//  Copyright (c) Olli Parviainen
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU Lesser General Public
+//  License as published by the Free Software Foundation; either
+//  version 2.1 of the License, or (at your option) any later version.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "STTypes.h"
+
+#ifdef SOUNDTOUCH_ALLOW_AVX2
+
+// AVX2 routines available only with float sample type
+
+#if !defined(__AVX2__) || !defined(__FMA__)
+    #error "avx2_optimized.cpp must be compiled with -mavx2 -mfma"
+#endif
+
+#include "simd_vector.h"
+#include "TDStretch.h"
+#include "FIRFilter.h"
+
+namespace soundtouch
+{
+
+//////////////////////////////////////////////////////////////////////////////
+//
+// AVX2 optimized routines of class 'TDStretchAVX2'
+//
+//////////////////////////////////////////////////////////////////////////////
+
+// Calculates cross correlation of two buffers
+double calcCrossCorrAVX2(const float *pV1, const float *pV2, int count, double &anorm)
+{
+#ifdef ST_SIMD_AVOID_UNALIGNED
+    if (((ulongptr)pV1) & 15) return -1e50;    // skip unaligned locations
+#endif
+
+    // ensure overlap length is divisible by 8
+    assert((count % 8) == 0);
+
+    return calcCrossCorrNorm<Float8>(pV1, pV2, count, anorm);
+}
+
+
+// Calculates cross correlation of two buffers, updating 'norm' incrementally
+double calcCrossCorrAccumulateAVX2(const float *pV1, const float *pV2, int count, int channels, double &norm)
+{
+    return calcCrossCorrRolling<Float8>(pV1, pV2, count, channels, norm);
+}
+
+
+// Overlaps samples in 'midBuffer' with the samples in 'pInput'
+void overlapStereoAVX2(float *pOutput, const float *pInput, const float *pMidBuffer, int overlapLength)
+{
+    overlapStereo<Float8>(pOutput, pInput, pMidBuffer, overlapLength);
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+//
+// AVX2 optimized routines of class 'FIRFilterAVX2'
+//
+//////////////////////////////////////////////////////////////////////////////
+
+// AVX2-optimized version of the filter routine for stereo sound
+uint evaluateFilterStereoAVX2(float *dest, const float *source, uint numSamples, const float *coeffs, uint length)
+{
+    assert(source != nullptr);
+    assert(dest != nullptr);
+    assert((length % 8) == 0);
+    assert(numSamples > length);
+    assert(coeffs != nullptr);
+
+    return filterStereo<Float8>(dest, source, numSamples, coeffs, length);
+}
+
+
+// AVX2-optimized version of the symmetric filter routine, any number of channels
+uint evaluateFoldedAVX2(float *dest, const float *source, uint numSamples, uint numChannels, uint length,
+                        const uint *pairs, const float *coeffs, uint numPairs)
+{
+    assert(source != nullptr);
+    assert(dest != nullptr);
+    assert(numSamples > length);
+    assert(numPairs > 0);
+
+    return filterFolded<Float8>(dest, source, numSamples, numChannels, length, pairs, coeffs, numPairs);
+}
+
+}
+
+#endif  // SOUNDTOUCH_ALLOW_AVX2
@@ -68,16 +68,30 @@ void disableExtensions(uint dwDisableMask)
 }
 
 
+#ifdef SOUNDTOUCH_ALLOW_X86_OPTIMIZATIONS
+/// Returns SUPPORT_AVX2 if the CPU and the OS support AVX2 and FMA instructions.
+static uint detectAVX2(void)
+{
+#ifdef SOUNDTOUCH_ALLOW_AVX2
+    // also checks that the OS saves the AVX registers
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) return SUPPORT_AVX2;
+#endif
+    return 0;
+}
+#endif
+
+
 /// Checks which instruction set extensions are supported by the CPU.
 uint detectCPUextensions(void)
 {
 /// If building for a 64bit system (no Itanium) and the user wants optimizations.
-/// Return the OR of SUPPORT_{MMX,SSE,SSE2}. 11001 or 0x19.
+/// Return the OR of SUPPORT_{MMX,SSE,SSE2}, 11001 or 0x19, and SUPPORT_AVX2.
 /// Keep the _dwDisabledISA test (2 more operations, could be eliminated).
 #if ((defined(__GNUC__) && defined(__x86_64__)) \
     || defined(_M_X64))  \
     && defined(SOUNDTOUCH_ALLOW_X86_OPTIMIZATIONS)
-    return 0x19 & ~_dwDisabledISA;
+    return (0x19 | detectAVX2()) & ~_dwDisabledISA;
 
 /// If building for a 32bit system and the user wants optimizations.
 /// Keep the _dwDisabledISA test (2 more operations, could be eliminated).
@@ -99,6 +113,7 @@ uint detectCPUextensions(void)
     if (edx & bit_MMX)  res = res | SUPPORT_MMX;
     if (edx & bit_SSE)  res = res | SUPPORT_SSE;
     if (edx & bit_SSE2) res = res | SUPPORT_SSE2;
+    res = res | detectAVX2();
 
 #else
     // Window / VS version of cpuid. Notice that Visual Studio 2005 or later required
@@ -118,6 +133,11 @@ uint detectCPUextensions(void)
 
     return res & ~_dwDisabledISA;
 
+#elif defined(SOUNDTOUCH_ALLOW_NEON)
+
+/// NEON was enabled at build time for an ARM CPU that has it.
+    return SUPPORT_NEON & ~_dwDisabledISA;
+
 #else
 
 /// One of these is true:
@@ -0,0 +1,101 @@
+////////////////////////////////////////////////////////////////////////////////
+///
+/// ARM NEON optimized routines for ARMv7-A and AArch64 CPUs.
+///
+/// The routines are the portable kernels of 'simd_vector.h' instantiated with
+/// 4-float vectors, which GCC and Clang compile to NEON instructions. NEON is
+/// mandatory on AArch64 and enabled with SOUNDTOUCH_USE_NEON and '-mfpu=neon'
+/// on 32bit ARM; see CMakeLists.txt.
+///
+////////////////////////////////////////////////////////////////////////////////
+//
+// License :
+//
+//  SoundTouch audio processing library
+//  Copyright (c) Olli Parviainen
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU Lesser General Public
+//  License as published by the Free Software Foundation; either
+//  version 2.1 of the License, or (at your option) any later version.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "cpu_detect.h"
+#include "STTypes.h"
+
+using namespace soundtouch;
+
+#ifdef SOUNDTOUCH_ALLOW_NEON
+
+// NEON routines available only with float sample type
+
+#include "simd_vector.h"
+
+//////////////////////////////////////////////////////////////////////////////
+//
+// implementation of NEON optimized functions of class 'TDStretchNEON'
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#include "TDStretch.h"
+
+// Calculates cross correlation of two buffers
+double TDStretchNEON::calcCrossCorr(const float *pV1, const float *pV2, double &anorm)
+{
+#ifdef ST_SIMD_AVOID_UNALIGNED
+    if (((ulongptr)pV1) & 15) return -1e50;    // skip unaligned locations
+#endif
+
+    // ensure overlapLength is divisible by 8
+    assert((overlapLength % 8) == 0);
+
+    return calcCrossCorrNorm<Float4>(pV1, pV2, channels * overlapLength, anorm);
+}
+
+
+// Calculates cross correlation of two buffers, updating 'norm' incrementally
+double TDStretchNEON::calcCrossCorrAccumulate(const float *pV1, const float *pV2, double &norm)
+{
+    return calcCrossCorrRolling<Float4>(pV1, pV2, channels * overlapLength, channels, norm);
+}
+
+
+// Overlaps samples in 'midBuffer' with the samples in 'pInput'
+void TDStretchNEON::overlapStereo(float *pOutput, const float *pInput) const
+{
+    soundtouch::overlapStereo<Float4>(pOutput, pInput, pMidBuffer, overlapLength);
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+//
+// implementation of NEON optimized functions of class 'FIRFilter'
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#include "FIRFilter.h"
+
+// NEON-optimized version of the filter routine for stereo sound
+uint FIRFilterNEON::evaluateFilterStereo(float *dest, const float *source, uint numSamples) const
+{
+    assert(source != nullptr);
+    assert(dest != nullptr);
+    assert((length % 8) == 0);
+    assert(numSamples > length);
+    assert(filterCoeffs != nullptr);
+
+    // 'filterCoeffs' are scaled by the result divider already
+    return filterStereo<Float4>(dest, source, numSamples, filterCoeffs, length);
+}
+
+#endif  // SOUNDTOUCH_ALLOW_NEON
@@ -0,0 +1,411 @@
+////////////////////////////////////////////////////////////////////////////////
+///
+/// Portable SIMD vector layer for the floating point sample routines.
+///
+/// The TDStretch cross-correlation & overlap and the FIRFilter kernels
+/// are written once here as templates over a vector type, and each of
+/// 'sse_optimized.cpp', 'avx2_optimized.cpp' and 'neon_optimized.cpp'
+/// instantiates them with its own vector width and compiler flags. The vectors
+/// are GCC/Clang vector extensions, so the same source compiles to SSE, AVX2
+/// (with FMA) or NEON code; with Visual C++ the 4-lane vector is a wrapper
+/// around the SSE intrinsics type. SIMD_HAVE_FLOAT4 tells if the 4-lane vector
+/// exists, the kernels also work with plain 'float' as a single lane vector.
+///
+/// Everything here is in an unnamed namespace: a kernel instantiated in the
+/// AVX2 file must not be merged at link time with the same instantiation in a
+/// file compiled for a lesser instruction set.
+///
+////////////////////////////////////////////////////////////////////////////////
+//
+// License :
+//
+//  SoundTouch audio processing library
+//  Copyright (c) Olli Parviainen
+//
+//  This library is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU Lesser General Public
+//  License as published by the Free Software Foundation; either
+//  version 2.1 of the License, or (at your option) any later version.
+//
+//  This library is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//  Lesser General Public License for more details.
+//
+//  You should have received a copy of the GNU Lesser General Public
+//  License along with this library; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef SIMD_VECTOR_H
+#define SIMD_VECTOR_H
+
+#include <string.h>
+#include <math.h>
+#include "STTypes.h"
+
+#if !defined(__GNUC__) && (defined(_M_IX86) || defined(_M_X64))
+    #include <xmmintrin.h>
+#endif
+
+namespace soundtouch
+{
+namespace
+{
+
+#if defined(__GNUC__)
+
+    // 4 floats: SSE or NEON register
+    typedef float Float4 __attribute__((vector_size(16)));
+    #define SIMD_HAVE_FLOAT4
+
+    #ifdef __AVX__
+        // 8 floats: AVX register
+        typedef float Float8 __attribute__((vector_size(32)));
+    #endif
+
+    template <class V> inline V splat(float value)
+    {
+        return V{} + value;
+    }
+
+#else
+
+    // Plain float as a vector of one lane, for kernels that have no other vector type
+    template <class V> inline V splat(float value)
+    {
+        return value;
+    }
+
+    #if defined(_M_IX86) || defined(_M_X64)
+
+    // Visual C++ has no vector extensions, give __m128 the operators needed below
+    struct Float4
+    {
+        __m128 v;
+    };
+    #define SIMD_HAVE_FLOAT4
+
+    inline Float4 operator+(const Float4 &a, const Float4 &b) { Float4 r = { _mm_add_ps(a.v, b.v) }; return r; }
+    inline Float4 operator-(const Float4 &a, const Float4 &b) { Float4 r = { _mm_sub_ps(a.v, b.v) }; return r; }
+    inline Float4 operator*(const Float4 &a, const Float4 &b) { Float4 r = { _mm_mul_ps(a.v, b.v) }; return r; }
+    inline Float4 &operator+=(Float4 &a, const Float4 &b) { a.v = _mm_add_ps(a.v, b.v); return a; }
+
+    template <> inline Float4 splat<Float4>(float value)
+    {
+        Float4 r = { _mm_set1_ps(value) };
+        return r;
+    }
+
+    #endif
+
+#endif
+
+    template <class V> struct Lanes
+    {
+        enum { count = sizeof(V) / sizeof(float) };
+    };
+
+    // Unaligned load & store. The memcpy compiles to a single vector move.
+    template <class V> inline V load(const float *src)
+    {
+        V v;
+        memcpy(&v, src, sizeof(V));
+        return v;
+    }
+
+    template <class V> inline void store(float *dest, const V &v)
+    {
+        memcpy(dest, &v, sizeof(V));
+    }
+
+    template <class V> inline float sumLanes(const V &v)
+    {
+        float lanes[Lanes<V>::count];
+        float sum = 0;
+
+        memcpy(lanes, &v, sizeof(V));
+        for (int i = 0; i < Lanes<V>::count; i ++)
+        {
+            sum += lanes[i];
+        }
+        return sum;
+    }
+
+
+    // Returns sum of v1[i] * v2[i] and, in 'norm', sum of v1[i] * v1[i].
+    // 'count' must be divisible by 8.
+    template <class V>
+    inline float crossCorr(const float *v1, const float *v2, int count, float &norm)
+    {
+        const int N = Lanes<V>::count;
+        V corr1 = splat<V>(0);
+        V corr2 = corr1;
+        V norm1 = corr1;
+        V norm2 = corr1;
+        int i;
+
+        // two sets of accumulators to hide the add latency
+        for (i = 0; i + 2 * N <= count; i += 2 * N)
+        {
+            V a = load<V>(v1 + i);
+            V b = load<V>(v1 + i + N);
+            corr1 += a * load<V>(v2 + i);
+            norm1 += a * a;
+            corr2 += b * load<V>(v2 + i + N);
+            norm2 += b * b;
+        }
+        for (; i < count; i += N)
+        {
+            V a = load<V>(v1 + i);
+            corr1 += a * load<V>(v2 + i);
+            norm1 += a * a;
+        }
+
+        norm = sumLanes(norm1 + norm2);
+        return sumLanes(corr1 + corr2);
+    }
+
+
+    // Returns sum of v1[i] * v2[i]. 'count' must be divisible by 8.
+    template <class V>
+    inline float dotProduct(const float *v1, const float *v2, int count)
+    {
+        const int N = Lanes<V>::count;
+        V sum1 = splat<V>(0);
+        V sum2 = sum1;
+        int i;
+
+        for (i = 0; i + 2 * N <= count; i += 2 * N)
+        {
+            sum1 += load<V>(v1 + i) * load<V>(v2 + i);
+            sum2 += load<V>(v1 + i + N) * load<V>(v2 + i + N);
+        }
+        for (; i < count; i += N)
+        {
+            sum1 += load<V>(v1 + i) * load<V>(v2 + i);
+        }
+
+        return sumLanes(sum1 + sum2);
+    }
+
+
+    // Normalized cross-correlation, as TDStretch::calcCrossCorr
+    template <class V>
+    inline double calcCrossCorrNorm(const float *mixingPos, const float *compare, int count, double &anorm)
+    {
+        float norm;
+        float corr = crossCorr<V>(mixingPos, compare, count & -8, norm);
+
+        anorm = norm;
+        return corr / sqrt((norm < 1e-9 ? 1.0 : norm));
+    }
+
+
+    // Cross-correlation with rolling 'norm', as TDStretch::calcCrossCorrAccumulate
+    template <class V>
+    inline double calcCrossCorrRolling(const float *mixingPos, const float *compare, int count,
+                                       int channels, double &norm)
+    {
+        int i;
+        float corr;
+
+        // cancel first normalizer tap from previous round
+        for (i = 1; i <= channels; i ++)
+        {
+            norm -= mixingPos[-i] * mixingPos[-i];
+        }
+
+        count &= -8;
+        corr = dotProduct<V>(mixingPos, compare, count);
+
+        // update normalizer with last samples of this round
+        for (i = count - channels; i < count; i ++)
+        {
+            norm += mixingPos[i] * mixingPos[i];
+        }
+
+        return corr / sqrt((norm < 1e-9 ? 1.0 : norm));
+    }
+
+
+    // Cross-fades 'numFrames' stereo frames from 'midBuffer' to 'input', as
+    // TDStretch::overlapStereo. Each vector holds N/2 consecutive frames, so the
+    // fade-in weights of a vector are (k, k, k+1, k+1, ...) / numFrames.
+    // 'numFrames' must be divisible by 8.
+    template <class V>
+    inline void overlapStereo(float *output, const float *input, const float *midBuffer, int numFrames)
+    {
+        const int N = Lanes<V>::count;
+        const float scale = 1.0f / (float)numFrames;
+        const V one = splat<V>(1.0f);
+        const V step = splat<V>(scale * (float)(N / 2));
+        float ramp[N];
+        int i;
+
+        for (i = 0; i < N; i ++)
+        {
+            ramp[i] = (float)(i / 2) * scale;
+        }
+        V fadeIn = load<V>(ramp);
+
+        for (i = 0; i < 2 * numFrames; i += N)
+        {
+            store(output + i, load<V>(input + i) * fadeIn + load<V>(midBuffer + i) * (one - fadeIn));
+            fadeIn += step;
+        }
+    }
+
+
+    // Stereo FIR filter, as FIRFilter::evaluateFilterStereo. The vectors hold
+    // consecutive interleaved output samples, i.e. N/2 stereo frames, and each
+    // filter tap multiplies them with one broadcast coefficient. Returns the
+    // number of frames written, 'numFrames - length'.
+    template <class V>
+    inline uint filterStereo(float *dest, const float *src, uint numFrames,
+                             const float *coeffs, uint length)
+    {
+        const int N = Lanes<V>::count;
+        const int end = 2 * (int)(numFrames - length);
+        const int blocks = end / (4 * N);
+        int b, j;
+
+        // four vectors per pass to keep enough multiply-adds in flight
+        #pragma omp parallel for
+        for (b = 0; b < blocks; b ++)
+        {
+            const float *ptr = src + b * 4 * N;
+            V sum1 = splat<V>(0);
+            V sum2 = sum1;
+            V sum3 = sum1;
+            V sum4 = sum1;
+
+            for (uint i = 0; i < length; i ++)
+            {
+                const V c = splat<V>(coeffs[i]);
+                sum1 += load<V>(ptr) * c;
+                sum2 += load<V>(ptr + N) * c;
+                sum3 += load<V>(ptr + 2 * N) * c;
+                sum4 += load<V>(ptr + 3 * N) * c;
+                ptr += 2;
+            }
+
+            float *pDest = dest + b * 4 * N;
+            store(pDest, sum1);
+            store(pDest + N, sum2);
+            store(pDest + 2 * N, sum3);
+            store(pDest + 3 * N, sum4);
+        }
+
+        j = blocks * 4 * N;
+        for (; j + N <= end; j += N)
+        {
+            const float *ptr = src + j;
+            V sum = splat<V>(0);
+
+            for (uint i = 0; i < length; i ++)
+            {
+                sum += load<V>(ptr + 2 * i) * splat<V>(coeffs[i]);
+            }
+            store(dest + j, sum);
+        }
+
+        // remaining frames, fewer than fill a vector
+        for (; j < end; j += 2)
+        {
+            const float *ptr = src + j;
+            float suml = 0;
+            float sumr = 0;
+
+            for (uint i = 0; i < length; i ++)
+            {
+                suml += ptr[2 * i] * coeffs[i];
+                sumr += ptr[2 * i + 1] * coeffs[i];
+            }
+            dest[j] = suml;
+            dest[j + 1] = sumr;
+        }
+
+        return numFrames - length;
+    }
+
+
+    // FIR filter with a symmetric kernel. The taps are folded to 'numPairs'
+    // pairs of frame offsets 'pairs[2k]', 'pairs[2k+1]' that share the
+    // coefficient 'coeffs[k]', so the two samples are added before the multiply.
+    // Output sample 'j' is the sum over the pairs of the input samples 'j +
+    // numChannels * offset', so the vectors hold consecutive interleaved output
+    // samples of any number of channels. 'length' is the unfolded filter
+    // length. Returns the number of frames written, 'numFrames - length'.
+    template <class V>
+    inline uint filterFolded(float *dest, const float *src, uint numFrames, uint numChannels,
+                             uint length, const uint *pairs, const float *coeffs, uint numPairs)
+    {
+        const int N = Lanes<V>::count;
+        const int end = (int)(numChannels * (numFrames - length));
+        const int blocks = end / (4 * N);
+        int b, j;
+
+        // four vectors per pass to keep enough multiply-adds in flight
+        #pragma omp parallel for
+        for (b = 0; b < blocks; b ++)
+        {
+            const float *ptr = src + b * 4 * N;
+            V sum1 = splat<V>(0);
+            V sum2 = sum1;
+            V sum3 = sum1;
+            V sum4 = sum1;
+
+            for (uint k = 0; k < numPairs; k ++)
+            {
+                const float *p1 = ptr + numChannels * pairs[2 * k];
+                const float *p2 = ptr + numChannels * pairs[2 * k + 1];
+                const V c = splat<V>(coeffs[k]);
+                sum1 += (load<V>(p1) + load<V>(p2)) * c;
+                sum2 += (load<V>(p1 + N) + load<V>(p2 + N)) * c;
+                sum3 += (load<V>(p1 + 2 * N) + load<V>(p2 + 2 * N)) * c;
+                sum4 += (load<V>(p1 + 3 * N) + load<V>(p2 + 3 * N)) * c;
+            }
+
+            float *pDest = dest + b * 4 * N;
+            store(pDest, sum1);
+            store(pDest + N, sum2);
+            store(pDest + 2 * N, sum3);
+            store(pDest + 3 * N, sum4);
+        }
+
+        j = blocks * 4 * N;
+        for (; j + N <= end; j += N)
+        {
+            const float *ptr = src + j;
+            V sum = splat<V>(0);
+
+            for (uint k = 0; k < numPairs; k ++)
+            {
+                sum += (load<V>(ptr + numChannels * pairs[2 * k]) + load<V>(ptr + numChannels * pairs[2 * k + 1]))
+                     * splat<V>(coeffs[k]);
+            }
+            store(dest + j, sum);
+        }
+
+        // remaining samples, fewer than fill a vector
+        for (; j < end; j ++)
+        {
+            const float *ptr = src + j;
+            float sum = 0;
+
+            for (uint k = 0; k < numPairs; k ++)
+            {
+                sum += (ptr[numChannels * pairs[2 * k]] + ptr[numChannels * pairs[2 * k + 1]]) * coeffs[k];
+            }
+            dest[j] = sum;
+        }
+
+        return numFrames - length;
+    }
+
+}
+}
+
+#endif // SIMD_VECTOR_H